@@ -38,6 +38,8 @@ namespace APP
 
 		// If we get a close window event, emplace a WindowClosed component
 		auto& win = registry.get<GW::SYSTEM::GWindow>(entity);
+		// Gateware may rebuild the swapchain inside these events, never under a frame being presented
+		DRAW::WaitForRenderThread(registry, entity);
 		if (-win.ProcessWindowEvents()) {
 			registry.emplace_or_replace<WindowClosed>(entity);
 		}
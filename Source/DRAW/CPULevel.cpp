@@ -14,6 +14,11 @@ namespace DRAW {
 			return;
 		}
 
+		// Already populated (copied from a level loaded once and shared between registries)
+		if (!cpuLevel->levelData.blenderObjects.empty()) {
+			return;
+		}
+
 		if (!cpuLevel->levelData.LoadLevel(cpuLevel->levelFile.c_str(), cpuLevel->modelPath.c_str(), log)) {
 			log.Log(("Could not load level from " + cpuLevel->levelFile).c_str());
 		}
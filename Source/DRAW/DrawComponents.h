@@ -4,12 +4,90 @@
 #include "./Utility/load_data_oriented.h"
 #include "./Utility/FontData.h"
 #include "./Utility/FontLoader.h"
+#include "../UTIL/JobSystem.h"
+#include "../UTIL/RadixSort.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <thread>
 
 namespace DRAW
 {
 	//*** TAGS ***//
 
 	//*** COMPONENTS ***//
+	enum class GPUMemoryPool
+	{
+		General, // size-class slabs, freed one by one
+		Level    // bump allocated, a block starts over once everything in it is freed (level reload)
+	};
+
+	// A buffer's slice of a shared VkDeviceMemory
+	struct GPUAllocation
+	{
+		static constexpr int dedicated = -1;
+		static constexpr int linear = -2;
+
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkDeviceSize offset = 0;
+		VkDeviceSize size = 0;
+		unsigned char* mapped = nullptr; // host-visible memory stays mapped for its whole life
+		uint32_t memoryType = 0;
+		int sizeClass = dedicated;       // or linear, or the slab size class
+		uint32_t block = 0;
+		GPUMemoryPool pool = GPUMemoryPool::General;
+	};
+
+	struct GPUMemoryStats
+	{
+		unsigned long long deviceAllocations = 0; // live vkAllocateMemory blocks
+		unsigned long long peakDeviceAllocations = 0;
+		unsigned long long liveAllocations = 0;   // live sub-allocations
+		unsigned long long totalAllocations = 0;
+		VkDeviceSize bytesInUse = 0;
+		VkDeviceSize bytesReserved = 0;
+	};
+
+	// Sub-allocates every DRAW buffer out of a few large blocks per memory type: power of two size classes
+	// (256 B to 4 MB) carved from slabs, linear blocks for level data, dedicated blocks for anything bigger.
+	// Lives on the renderer entity, created before and destroyed after every buffer.
+	struct GPUMemoryAllocator
+	{
+		static constexpr VkDeviceSize minClassSize = 256;
+		static constexpr int classCount = 15;
+		static constexpr VkDeviceSize minSlabSize = 2ull << 20;
+		static constexpr VkDeviceSize linearBlockSize = 32ull << 20;
+
+		struct Block
+		{
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+			VkDeviceSize size = 0;
+			VkDeviceSize head = 0; // linear blocks only
+			unsigned char* mapped = nullptr;
+			uint32_t live = 0;
+		};
+		struct TypeHeap
+		{
+			std::vector<Block> slabs[classCount];
+			std::vector<std::pair<uint32_t, VkDeviceSize>> freeSlots[classCount]; // slab, offset
+			std::vector<Block> linearBlocks;
+			std::vector<Block> dedicated;
+		};
+
+		VkDevice device = nullptr;
+		VkPhysicalDeviceMemoryProperties memoryProperties = {};
+		uint32_t maxAllocationCount = 4096;
+		bool allocationWarningShown = false; // the half-limit warning is printed once
+		std::vector<TypeHeap> heaps; // per memory type
+		GPUMemoryStats stats;
+	};
+
 	struct VulkanRendererInitialization
 	{
 		std::string vertexShaderName;
@@ -21,12 +99,64 @@ namespace DRAW
 		float farPlane;
 	};
 
+	// Stands in for the GWindow and Gateware's swapchain when the renderer runs headless, for render benchmarks
+	// and CI machines with only a software ICD (lavapipe). Emplaced before the VulkanRenderer, which then creates
+	// its own instance and device and draws into these images; Update_VulkanRenderer is otherwise unchanged.
+	// Images and readback buffers live outside the GPUMemoryAllocator, there are only a handful of them.
+	struct VulkanOffscreenTarget
+	{
+		struct Frame
+		{
+			VkImage color = VK_NULL_HANDLE, depth = VK_NULL_HANDLE;
+			VkDeviceMemory colorMemory = VK_NULL_HANDLE, depthMemory = VK_NULL_HANDLE;
+			VkImageView colorView = VK_NULL_HANDLE, depthView = VK_NULL_HANDLE;
+			VkFramebuffer framebuffer = VK_NULL_HANDLE;
+			VkCommandPool commandPool = VK_NULL_HANDLE;
+			VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+			VkFence fence = VK_NULL_HANDLE;
+			VkBuffer readback = VK_NULL_HANDLE; // host-visible copy of color, only with a dumpFolder
+			VkDeviceMemory readbackMemory = VK_NULL_HANDLE;
+			void* readbackMapped = nullptr;
+			unsigned long long frameNumber = 0; // last frame submitted from here, 0 = none yet
+			bool dump = false;                  // that frame copied its image out
+			double recordSeconds = 0.0;
+		};
+		// One per frame the GPU has finished, in order
+		struct FrameTiming
+		{
+			unsigned long long frameNumber;
+			double recordMilliseconds; // CPU, recording and executing the passes
+			double gpuMilliseconds;    // first to last command of the frame, 0 when the queue has no timestamps
+		};
+
+		unsigned int width = 1280, height = 720;
+		unsigned int frameCount = 2;
+		std::string dumpFolder; // finished frames are written there as frame_<n>.ppm, empty = no dumps
+
+		VkFormat colorFormat = VK_FORMAT_B8G8R8A8_UNORM; // what Gateware's swapchain uses, the pipelines are identical
+		VkFormat depthFormat = VK_FORMAT_D32_SFLOAT;
+		VkRenderPass renderPass = VK_NULL_HANDLE;
+		VkQueryPool timestamps = VK_NULL_HANDLE; // two per frame
+		double timestampPeriod = 0.0;            // nanoseconds per tick
+		uint64_t timestampMask = 0;
+		std::vector<Frame> frames;
+		unsigned int current = 0;
+		unsigned long long submittedFrames = 0;
+		std::vector<FrameTiming> timings;
+	};
+
 	struct VulkanRenderer
 	{
-		GW::GRAPHICS::GVulkanSurface vlkSurface;
+		GW::GRAPHICS::GVulkanSurface vlkSurface; // not created when running headless
+		VkInstance instance = VK_NULL_HANDLE;
 		VkDevice device = nullptr;
 		VkPhysicalDevice physicalDevice = nullptr;
 		VkRenderPass renderPass;
+		VkQueue graphicsQueue = VK_NULL_HANDLE;
+		unsigned int graphicsFamily = 0;
+		unsigned int frameCount = 1;   // frame contexts, one per swapchain image or offscreen frame
+		unsigned int currentFrame = 0; // context of the frame being built, set once it has started
+		bool headless = false;         // the instance and device are the renderer's own, not Gateware's
 		VkShaderModule vertexShader = nullptr;
 		VkShaderModule fragmentShader = nullptr;
 		VkPipeline pipeline = nullptr;
@@ -35,7 +165,13 @@ namespace DRAW
 		VkDescriptorSetLayout descriptorLayout = nullptr;
 		VkDescriptorPool descriptorPool = nullptr;
 		std::vector<VkDescriptorSet> descriptorSets;
+		std::vector<VkDescriptorSet> staticDescriptorSets; // same layout, binding 1 is the static instance region
+		std::vector<VkDescriptorSet> anchoredDescriptorSets; // same layout, binding 1 is this frame's anchored region
 		VkClearValue clrAndDepth[2];
+		bool packedVertices = false; // the level's vertex format, the scene pipeline is built for one or the other
+		// multiDrawIndirect + drawIndirectFirstInstance, the whole opaque scene goes out in one call
+		bool multiDrawIndirect = false;
+		unsigned int maxDrawIndirectCount = 1;
 
 		// NEW: text rendering stuff
 		VkShaderModule textVertexShader = VK_NULL_HANDLE;
@@ -43,21 +179,119 @@ namespace DRAW
 		VkPipeline     textPipeline = VK_NULL_HANDLE;
 		VkPipelineLayout textPipelineLayout = VK_NULL_HANDLE;
 
-		VkBuffer        textVertexBuffer = VK_NULL_HANDLE;
-		VkDeviceMemory  textVertexMemory = VK_NULL_HANDLE;
-		size_t          textVertexCapacity = 0;
+		// one per frame context like the instance buffers, the CPU writes this frame's while earlier ones are read
+		std::vector<VkBuffer>      textVertexBuffers;
+		std::vector<GPUAllocation> textVertexMemory;
+		std::vector<size_t>        textVertexCapacity;
+	};
+
+	// The renderer's pipelines are built on worker threads through this cache while the level loads.
+	// It is saved to disk on shutdown and only reloaded by the same device and driver, so a warm start
+	// skips most of the driver's compile. Update_VulkanRenderer clears but draws nothing until they arrive.
+	struct VulkanPipelineCache
+	{
+		VkPipelineCache cache = VK_NULL_HANDLE;
+		std::string path;
+		size_t loadedBytes = 0; // 0 = cold start
+		std::future<VkPipeline> scenePipeline;
+		std::future<VkPipeline> textPipeline;
+
+		std::chrono::steady_clock::time_point startupBegin = std::chrono::steady_clock::now();
+		double constructSeconds = 0.0;
+	};
+
+	// Recorded into their own secondary command buffers, executed from the swapchain's primary in this order
+	enum class RecordPass
+	{
+		StaticScene,  // level geometry in the static instance region
+		AnchoredScene, // straight-line movers, from this frame's copy of the anchored region
+		DynamicScene, // everything that moves, from this frame's instance buffer
+		HUD,
+		Count
+	};
+
+	// Headless, every pass is recorded on the renderer's job pool at once and the primary only executes them.
+	// Pools are per frame context and pass so no two threads ever share one.
+	struct VulkanCommandRecorder
+	{
+		static constexpr unsigned int passCount = static_cast<unsigned int>(RecordPass::Count);
+
+		// set on the main thread from the registry each frame, run on the pool with only what they captured
+		std::function<void(VkCommandBuffer)> passes[passCount];
+
+		std::unique_ptr<UTIL::JobSystem> jobs;
+		std::vector<VkCommandPool> pools;     // [context * passCount + pass]
+		std::vector<VkCommandBuffer> buffers; // same layout, one secondary per pool
+	};
+
+	// 20 bytes in place of H2B::VERTEX's 36, for levels that set packedVertices. The unused third texture
+	// coordinate is dropped, the uv goes to half floats and the normal is octahedral encoded into two snorm16s.
+	// HLSL (vertex shader compiled with PACKED_VERTEX): float3 pos : POSITION; float2 uv : TEXCOORD; float2 oct : NORMAL;
+	//       float3 nrm = float3(oct, 1 - abs(oct.x) - abs(oct.y));
+	//       nrm.xy += (nrm.xy >= 0 ? -1 : 1) * saturate(-nrm.z); nrm = normalize(nrm);
+	struct PackedVertex
+	{
+		float pos[3];
+		uint16_t uv[2];    // IEEE half, VK_FORMAT_R16G16_SFLOAT
+		int16_t normal[2]; // octahedral, VK_FORMAT_R16G16_SNORM
 	};
+	static_assert(sizeof(PackedVertex) == 20, "PackedVertex must match the packed vertex input layout");
 
+	// Device-local, filled through the transfer queue. Not drawn from until uploadId completes.
 	struct VulkanVertexBuffer
 	{
 		VkBuffer buffer = VK_NULL_HANDLE;
-		VkDeviceMemory memory = VK_NULL_HANDLE;
+		GPUAllocation memory;
+		unsigned long long uploadId = 0;
 	};
 
 	struct VulkanIndexBuffer
 	{
 		VkBuffer buffer = VK_NULL_HANDLE;
-		VkDeviceMemory memory = VK_NULL_HANDLE;
+		GPUAllocation memory;
+		VkIndexType indexType = VK_INDEX_TYPE_UINT32; // 16-bit when every model has fewer than 65536 vertices
+		unsigned long long uploadId = 0;
+	};
+
+	// Streams data into device-local buffers through a persistently mapped staging ring.
+	// Uploads are queued, PumpTransfers copies whatever fits into the ring once per frame and submits it
+	// as one batch with its own fence, so a big level streams in over a few frames instead of stalling one.
+	// Gateware only exposes its graphics queue, so the batches go there, ahead of the frame's own submit.
+	struct VulkanTransferQueue
+	{
+		struct PendingUpload
+		{
+			VkBuffer destination;
+			VkDeviceSize destinationOffset;
+			std::vector<unsigned char> data;
+			VkDeviceSize copied = 0;
+			unsigned long long uploadId;
+		};
+		struct Batch
+		{
+			VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+			VkFence fence = VK_NULL_HANDLE;
+			VkDeviceSize ringEnd = 0;        // head of the ring once this batch was recorded
+			VkDeviceSize ringBytes = 0;      // bytes of the ring it holds, wrap padding included
+			unsigned long long lastUploadId = 0; // newest upload this batch finished
+			bool inFlight = false;
+		};
+
+		VkDeviceSize stagingSize = 8ull << 20;
+		VkQueue queue = VK_NULL_HANDLE;
+		VkCommandPool commandPool = VK_NULL_HANDLE;
+		VkBuffer stagingBuffer = VK_NULL_HANDLE;
+		GPUAllocation stagingMemory;
+		unsigned char* staging = nullptr;
+		VkDeviceSize head = 0;  // next free byte
+		VkDeviceSize tail = 0;  // oldest byte still read by a batch in flight
+		VkDeviceSize used = 0;
+
+		std::vector<Batch> batches; // used round robin, so they complete in order
+		unsigned int nextBatch = 0;
+		std::deque<PendingUpload> pending;
+		unsigned long long lastUploadId = 0;
+		unsigned long long completedUploadId = 0;
 	};
 
 	struct GeometryData
@@ -68,29 +302,138 @@ namespace DRAW
 		}
 	};
 	
+	// What gameplay writes per mesh entity. The renderer packs it into a GPUInstanceData every frame.
 	struct GPUInstance
 	{
 		GW::MATH::GMATRIXF	transform;
-		H2B::ATTRIBUTES		matData;
+		unsigned int		materialIndex = 0; // into the MaterialTable
+		unsigned int		tint = 0;          // RGBA8 replacing the material's Kd, alpha 0 = no override
+		float				velocity[2] = { 0.0f, 0.0f }; // xz units/s, when set transform is the position at MotionClock 0
+	};
+
+	// The per-instance record in the storage buffer (binding 1), 64 bytes instead of a matrix plus a whole material.
+	// HLSL: struct INSTANCE { float4 world[3]; uint material; uint tint; float2 velocity; };
+	//       worldPos = float3(dot(world[0], float4(pos, 1)), dot(world[1], ...), dot(world[2], ...))
+	//       worldPos.xz += velocity * motionTime;
+	struct GPUInstanceData
+	{
+		GW::MATH::GVECTORF world[3]; // transposed 4x3, the matrix's last column is always (0, 0, 0, 1)
+		unsigned int materialIndex;
+		unsigned int tint;
+		float velocity[2];
+	};
+	static_assert(sizeof(GPUInstanceData) == 64, "GPUInstanceData must match the shader's std430 layout");
+
+	// Every unique material of the level, uploaded once into the storage buffer at binding 2
+	struct MaterialTable
+	{
+		std::vector<H2B::ATTRIBUTES> materials;
+	};
+
+	struct VulkanMaterialBuffer
+	{
+		VkBuffer buffer = VK_NULL_HANDLE;
+		GPUAllocation memory;
+	};
+
+	// Level meshes that are not isDynamic: packed once at load into device-local memory together with
+	// their draw commands, so per-frame uploads only scale with things that move
+	struct VulkanStaticInstanceBuffer
+	{
+		VkBuffer instances = VK_NULL_HANDLE;
+		GPUAllocation instanceMemory;
+		VkBuffer commands = VK_NULL_HANDLE;
+		GPUAllocation commandMemory;
+		unsigned int drawCount = 0;
+		unsigned long long uploadId = 0; // the commands, queued after the instances
 	};
 
+	// One persistently mapped storage buffer per swapchain image. StartFrame has already waited on the
+	// current image's fence, so its buffer can be written (or regrown) without stalling the GPU.
+	// Set required_count and patch before writing this frame's instances into mapped[frame].
 	struct VulkanGPUInstanceBuffer
 	{
-		unsigned long long element_count = 1;
+		unsigned long long element_count = 1; // starting capacity of every frame's buffer
+		unsigned long long required_count = 0;
 		std::vector<VkBuffer> buffer;
-		std::vector<VkDeviceMemory> memory;
+		std::vector<GPUAllocation> memory;
+		std::vector<GPUInstanceData*> mapped;
+		std::vector<unsigned long long> capacity;
+	};
+
+	// One persistently mapped VkDrawIndexedIndirectCommand array per swapchain image, one command per DrawSlot.
+	// Same rules as the instance buffer: set required_count and patch before writing into mapped[frame].
+	struct VulkanIndirectBuffer
+	{
+		unsigned long long required_count = 0;
+		std::vector<VkBuffer> buffer;
+		std::vector<GPUAllocation> memory;
+		std::vector<VkDrawIndexedIndirectCommand*> mapped;
+		std::vector<unsigned long long> capacity;
 	};
 
 	struct SceneData
 	{
 		GW::MATH::GVECTORF sunDirection, sunColor, sunAmbient, camPos;
 		GW::MATH::GMATRIXF viewMatrix, projectionMatrix;
+		float motionTime = 0.0f; // MotionClock seconds, drives GPUInstance::velocity
+		float padding[3] = {};
+	};
+
+	// Gameplay time that straight-line movers are evaluated at, on the CPU for collision and in the
+	// vertex shader for drawing. Advances with the game, so it stops when the game does. The shader sees
+	// it as a float, so it is rebased to 0 (and every anchor moved with it) before it loses precision.
+	struct MotionClock
+	{
+		static constexpr double rebaseSeconds = 256.0;
+
+		double seconds = 0.0;
+		unsigned long long anchorVersion = 0; // bumped whenever an AnchoredInstance is added, replaced or removed
 	};
 
 	struct VulkanUniformBuffer
 	{
 		std::vector<VkBuffer> buffer;
-		std::vector<VkDeviceMemory> memory;
+		std::vector<GPUAllocation> memory;
+	};
+
+	// One per swapchain image. Gateware owns the fence and command buffer of each image and StartFrame
+	// waits on that fence before handing the command buffer back, so when a context comes around again
+	// the frame it recorded last time has finished on the GPU.
+	struct FrameContext
+	{
+		unsigned long long submittedFrame = 0; // 0 = never used
+	};
+
+	// A buffer nothing references any more, but that a frame still in flight may read
+	struct RetiredBuffer
+	{
+		VkBuffer buffer = VK_NULL_HANDLE;
+		GPUAllocation memory;
+		unsigned long long lastUsedFrame = 0;
+	};
+
+	// Frame numbering shared by everything that hands resources to the GPU. The CPU records frame N+1
+	// while the GPU still works on N, resources only need to outlive completedFrame.
+	struct FrameTimeline
+	{
+		std::vector<FrameContext> contexts;
+		unsigned long long currentFrame = 0;   // frame being recorded
+		unsigned long long completedFrame = 0; // this frame and everything before it is done on the GPU
+		unsigned int currentContext = 0;
+
+		// freed once completedFrame reaches their lastUsedFrame, see RetireBuffer
+		std::vector<RetiredBuffer> retired;
+
+		// CPU/GPU overlap, accumulated and printed every reportInterval seconds
+		std::chrono::steady_clock::time_point lastFrameStart;
+		std::chrono::steady_clock::time_point lastReport;
+		double frameSeconds = 0.0; // wall time between frame starts
+		double waitSeconds = 0.0;  // time the CPU sat blocked in StartFrame/EndFrame
+		double recordSeconds = 0.0; // time spent recording and executing the passes
+		unsigned long long culledInstances = 0; // dynamic instances left out by frustum culling
+		unsigned int reportFrames = 0;
+		double reportInterval = 5.0;
 	};
 
 
@@ -103,6 +446,7 @@ namespace DRAW
 	{
 		std::string levelFile;
 		std::string modelPath;
+		bool packedVertices = false; // upload PackedVertex instead of H2B::VERTEX
 		Level_Data levelData;
 	};
 
@@ -110,6 +454,165 @@ namespace DRAW
 
 	struct DoNotRender{};
 
+	// Never moves after level load, drawn from the static instance region
+	struct StaticInstance{};
+
+	// A straight-line mover's mesh, anchored at MotionClock 0 with GPUInstance::velocity set. Its record only
+	// changes when it is re-anchored, so it is drawn from the anchored region instead of the per-frame stream.
+	// Re-anchoring has to emplace_or_replace the tag, that is what tells the renderer to repack.
+	struct AnchoredInstance{};
+
+	// One slot per unique mesh batch in the level, the DRAW_INSTRUCTION load_data_oriented.h asks for.
+	// Built once at level load; each frame's draws reuse its geometry with their own counts and offsets.
+	struct DrawSlot
+	{
+		GeometryData geometry;
+		unsigned int instanceCount = 0;
+		unsigned int firstInstance = 0;
+	};
+
+	// Which DrawSlot a mesh entity is drawn with
+	struct DrawSlotIndex
+	{
+		unsigned int slot;
+	};
+
+	// Every AnchoredInstance record, bucketed by slot like the static region. Packed on the main thread only
+	// when MotionClock::anchorVersion moves, then shared read-only with every snapshot until the next change.
+	struct AnchoredRegion
+	{
+		unsigned long long version = 0;
+		std::vector<DrawSlot> slots;
+		std::vector<GPUInstanceData> instances;
+	};
+
+	// One persistently mapped copy of the anchored region and its draw commands per frame context.
+	// Set region and patch: the current frame's copy is rewritten only when it holds a different region,
+	// so while nothing is re-anchored no anchored record is uploaded at all.
+	struct VulkanAnchoredInstanceBuffer
+	{
+		std::shared_ptr<const AnchoredRegion> region;
+		std::vector<std::shared_ptr<const AnchoredRegion>> written; // per frame, what its copy holds
+		std::vector<VkBuffer> instances;
+		std::vector<GPUAllocation> instanceMemory;
+		std::vector<unsigned long long> instanceCapacity;
+		std::vector<VkBuffer> commands;
+		std::vector<GPUAllocation> commandMemory;
+		std::vector<unsigned long long> commandCapacity;
+	};
+
+	// Pipelines a draw key can ask for, in the order they are bound
+	enum class DrawPipeline
+	{
+		Scene,
+		Text,
+	};
+
+	// 64-bit sort key of one drawn instance, from the top: pass (2 bits), pipeline (6), material (16),
+	// depth bucket (16), mesh (24). Sorted as plain integers every pass and pipeline switch happens
+	// once, each bucket draws front to back and the instances of one mesh in a bucket share a draw.
+	struct DrawKey
+	{
+		static constexpr unsigned int meshBits = 24, depthBits = 16, materialBits = 16, pipelineBits = 6;
+		static constexpr unsigned int depthBuckets = 16; // coarse, every bucket splits the draws of a mesh once more
+
+		static uint64_t Make(RecordPass pass, DrawPipeline pipeline, unsigned int material, unsigned int depthBucket, unsigned int mesh)
+		{
+			uint64_t key = static_cast<uint64_t>(pass);
+			key = (key << pipelineBits) | static_cast<uint64_t>(pipeline);
+			key = (key << materialBits) | (material & ((1u << materialBits) - 1));
+			key = (key << depthBits) | (depthBucket & ((1u << depthBits) - 1));
+			key = (key << meshBits) | (mesh & ((1u << meshBits) - 1));
+			return key;
+		}
+
+		// the mesh field holds slot * MeshLODs::maxLevels + lod, an index into DrawTable::lodGeometry
+		static unsigned int Mesh(uint64_t key) { return static_cast<unsigned int>(key & ((1u << meshBits) - 1)); }
+
+		// depth is the distance in front of the near plane, depthRange the distance from near to far
+		static unsigned int DepthBucket(float depth, float depthRange)
+		{
+			if (!(depth > 0.0f) || !(depthRange > 0.0f))
+				return 0;
+			unsigned int bucket = static_cast<unsigned int>(depth / depthRange * depthBuckets);
+			return (std::min)(bucket, depthBuckets - 1);
+		}
+	};
+
+	// Lives in the registry context next to the ModelManager
+	struct DrawTable
+	{
+		std::vector<DrawSlot> slots;           // ordered by indexStart, the order meshes sit in the index buffer
+		std::vector<unsigned int> writeCursor; // per slot, scratch for the static region's counting sort
+		std::vector<GW::MATH::GVECTORF> slotBounds; // per slot, model space bounding sphere (xyz center, w radius)
+
+		// per slot, the simplified copies of its mesh. Level lod of slot s is lodGeometry[s * MeshLODs::maxLevels + lod],
+		// level 0 is the slot's own geometry. lodError is how far (model space) a level strays from level 0.
+		std::vector<GeometryData> lodGeometry;
+		std::vector<float> lodError;
+		std::vector<unsigned int> lodCount;
+		float lodPixelThreshold = 1.0f; // a coarser level is drawn while its error projects to no more pixels than this
+
+		// per dynamic instance, scratch for frustum culling
+		std::vector<const GPUInstance*> cullInstances;
+		std::vector<unsigned int> cullSlots;
+		std::vector<unsigned char> cullVisible;
+		std::vector<float> cullDepth; // in front of the near plane, for the depth bucket
+		std::vector<unsigned char> cullLod;
+		std::vector<UTIL::SortEntry> sortEntries, sortScratch;
+
+		std::vector<DrawSlot> staticSlots;              // non-empty slots of the static region, filled at load
+		std::vector<GPUInstanceData> staticInstances;   // CPU copy of the static region until it is uploaded
+
+		std::shared_ptr<const AnchoredRegion> anchored; // repacked when MotionClock::anchorVersion moves
+	};
+
+	// What one frame draws, copied out of the registry at the end of a simulation tick.
+	// Drawing it only touches the renderer entity, never live gameplay components.
+	struct RenderSnapshot
+	{
+		GW::MATH::GMATRIXF camera;
+		double motionTime = 0.0;
+		unsigned int windowWidth = 0, windowHeight = 0;
+		std::vector<DrawSlot> slots;            // one draw per run of equal draw keys, in key order
+		std::vector<GPUInstanceData> instances; // packed in key order, only what survived frustum culling
+		std::shared_ptr<const AnchoredRegion> anchored; // shared with the draw table, not copied per frame
+		unsigned int culledInstances = 0;
+		std::vector<TextVertex> hudText;
+	};
+
+	// Hands snapshots from the simulation to the renderer. With --render-thread a dedicated thread draws them,
+	// otherwise Update_VulkanRenderer draws each one straight away. Snapshot n lives in snapshots[n % 2], the
+	// main thread fills one while the other is recorded and presented; only the two counters change hands.
+	struct RenderHandoff
+	{
+		struct Shared
+		{
+			RenderSnapshot snapshots[2];
+			std::atomic<unsigned long long> published = 0; // snapshots handed to the render thread
+			std::atomic<unsigned long long> released = 0;  // of those, the ones it no longer needs the registry for
+			std::atomic<unsigned long long> presented = 0; // of those, the ones it has finished with entirely
+			std::atomic<bool> stopping = false;
+		};
+
+		std::unique_ptr<Shared> shared = std::make_unique<Shared>();
+		std::thread thread; // joinable only while the render thread runs
+	};
+
+	// What the second half of a frame needs, so recording and presenting never look at the registry
+	struct FrameSubmission
+	{
+		VulkanRenderer* renderer = nullptr;
+		VulkanCommandRecorder* recorder = nullptr;
+		FrameTimeline* timeline = nullptr;
+		VulkanOffscreenTarget* offscreen = nullptr; // headless, submitted without presenting
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		VkFramebuffer framebuffer = VK_NULL_HANDLE;
+		unsigned int image = 0;
+		VkViewport viewport = {};
+		VkRect2D scissor = {};
+	};
+
 	struct MeshCollection
 	{
 		std::vector<entt::entity> entities;
@@ -122,6 +625,159 @@ namespace DRAW
 	};
 
 	//*** HELPER FUNCTIONS ***//
+	// Creates a buffer bound to a sub-allocation, host-visible ones come back already mapped
+	void CreateAllocatedBuffer(entt::registry& registry, entt::entity rendererEntity, VkDeviceSize size,
+		VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer* buffer, GPUAllocation* allocation,
+		GPUMemoryPool pool = GPUMemoryPool::General);
+	// Destroys it right away, only for buffers no frame in flight can be using
+	void DestroyAllocatedBuffer(entt::registry& registry, entt::entity rendererEntity, VkBuffer buffer, const GPUAllocation& allocation);
+	void FreeGPUAllocation(GPUMemoryAllocator& allocator, const GPUAllocation& allocation);
+	void ReportGPUMemory(const GPUMemoryAllocator& allocator);
+
+	// Queues a copy into a TRANSFER_DST buffer, returns the id to check with IsUploadComplete
+	unsigned long long QueueBufferUpload(entt::registry& registry, entt::entity rendererEntity,
+		VkBuffer destination, VkDeviceSize destinationOffset, const void* data, VkDeviceSize size);
+	bool IsUploadComplete(entt::registry& registry, entt::entity rendererEntity, unsigned long long uploadId);
+	// Drops queued uploads into a buffer that is going away
+	void CancelBufferUploads(entt::registry& registry, entt::entity rendererEntity, VkBuffer destination);
+	// Retires finished batches and submits the next one, once per frame
+	void PumpTransfers(entt::registry& registry, entt::entity rendererEntity);
+
+	// Records the passes set this frame and clears them. With secondary contents they are recorded in parallel
+	// and executed from the primary, with inline contents (Gateware's pass) they are recorded into the primary in order.
+	void ExecuteRecordedPasses(VulkanRenderer& renderer, VulkanCommandRecorder& recorder, VkCommandBuffer primary,
+		VkSubpassContents contents, unsigned int image, VkFramebuffer framebuffer, const VkViewport& viewport, const VkRect2D& scissor);
+
+	// Size of what the renderer draws into, the offscreen target's when headless and the window's otherwise
+	void GetRenderTargetSize(entt::registry& registry, entt::entity rendererEntity, unsigned int& width, unsigned int& height);
+
+	// Headless rendering, in place of Gateware's surface. Picks the first device with a graphics queue, preferring
+	// real GPUs over CPU implementations, and enables every feature it supports like Gateware does.
+	bool CreateOffscreenDevice(VulkanRenderer& renderer, VulkanOffscreenTarget& target, bool validation);
+	// Render pass, images, command buffers and timestamp queries, once the device is there.
+	// Returns false when the images cannot be allocated.
+	bool CreateOffscreenFrames(VulkanRenderer& renderer, VulkanOffscreenTarget& target);
+	// Waits for the next frame's previous submit and collects it, then begins its command buffer and render pass
+	// (with secondary contents). Returns the frame's primary, like Gateware's StartFrame.
+	VkCommandBuffer BeginOffscreenFrame(VulkanRenderer& renderer, VulkanOffscreenTarget& target);
+	// Ends the render pass, copies the image out when dumping and submits. There is nothing to present.
+	void EndOffscreenFrame(VulkanRenderer& renderer, VulkanOffscreenTarget& target, double recordSeconds);
+	// Waits for every frame still in flight and collects its timings (and dumps)
+	void FinishOffscreenFrames(VulkanRenderer& renderer, VulkanOffscreenTarget& target);
+
+	// Main thread, end of a tick: copies the camera, the instances (sorted into draw slots) and the HUD text
+	void ExtractRenderSnapshot(entt::registry& registry, entt::entity rendererEntity, RenderSnapshot& snapshot);
+	// Starts the frame and sets up its passes, the only part of drawing that touches the registry.
+	// Returns false when there is no frame to finish.
+	bool BeginSnapshotFrame(entt::registry& registry, entt::entity rendererEntity, const RenderSnapshot& snapshot,
+		FrameSubmission& submission);
+	// Records the passes and presents
+	void EndSnapshotFrame(FrameSubmission& submission);
+
+	// --render-thread: draws on a dedicated thread, one tick behind the simulation
+	bool RenderThreadRequested(int argc, char** argv);
+	void StartRenderThread(entt::registry& registry, entt::entity rendererEntity);
+	// Lets the thread finish its frame and joins it, the renderer is drawn inline again afterwards
+	void StopRenderThread(entt::registry& registry, entt::entity rendererEntity);
+	// Extracts a snapshot, hands it over and waits until the render thread is done with the registry
+	void PublishRenderSnapshot(entt::registry& registry, entt::entity rendererEntity);
+	// Blocks until everything handed over has been presented, nothing to wait for without a render thread.
+	// Window events are pumped after this, Gateware rebuilds the swapchain from inside them.
+	void WaitForRenderThread(entt::registry& registry, entt::entity rendererEntity);
+
+	// Hands a buffer to the renderer's retirement queue instead of destroying it under a frame in flight.
+	// Without a FrameTimeline (renderer already gone) the caller must have idled the device, it is freed now.
+	void RetireBuffer(entt::registry& registry, entt::entity rendererEntity, VkBuffer buffer, const GPUAllocation& memory);
+	// Frees retired buffers whose frame has completed, or all of them once the device is idle.
+	// Without an allocator only the buffers are destroyed, their memory went with it.
+	void ReleaseRetiredBuffers(VkDevice device, GPUMemoryAllocator* allocator, FrameTimeline& timeline, bool deviceIdle);
+
+	static unsigned int PackTint(H2B::VECTOR color)
+	{
+		auto channel = [](float value) {
+			return static_cast<unsigned int>((std::min)((std::max)(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+		};
+		return channel(color.x) | (channel(color.y) << 8) | (channel(color.z) << 16) | (255u << 24);
+	}
+
+	// Round to nearest, overflow goes to infinity and anything below the smallest subnormal to zero
+	static uint16_t FloatToHalf(float value)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+		uint32_t mantissa = bits & 0x7FFFFF;
+		int exponent = static_cast<int>((bits >> 23) & 0xFF) - 127 + 15;
+
+		if (((bits >> 23) & 0xFF) == 0xFF)
+			return static_cast<uint16_t>(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+		if (exponent >= 31)
+			return static_cast<uint16_t>(sign | 0x7C00);
+		if (exponent <= 0)
+		{
+			if (exponent < -10)
+				return sign;
+			mantissa |= 0x800000;
+			unsigned int shift = static_cast<unsigned int>(14 - exponent);
+			uint32_t half = mantissa >> shift;
+			if ((mantissa >> (shift - 1)) & 1)
+				++half;
+			return static_cast<uint16_t>(sign | half);
+		}
+		// a rounding carry out of the mantissa bumps the exponent, which is the right answer
+		uint32_t half = sign | (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+		if (mantissa & 0x1000)
+			++half;
+		return static_cast<uint16_t>(half);
+	}
+
+	static PackedVertex PackVertex(const H2B::VERTEX& vertex)
+	{
+		PackedVertex packed;
+		packed.pos[0] = vertex.pos.x;
+		packed.pos[1] = vertex.pos.y;
+		packed.pos[2] = vertex.pos.z;
+		packed.uv[0] = FloatToHalf(vertex.uvw.x);
+		packed.uv[1] = FloatToHalf(vertex.uvw.y);
+
+		// onto the octahedron, then the lower half folds out over the corners
+		float x = vertex.nrm.x, y = vertex.nrm.y, z = vertex.nrm.z;
+		float length = std::fabs(x) + std::fabs(y) + std::fabs(z);
+		if (length > 0.0f)
+		{
+			x /= length;
+			y /= length;
+			z /= length;
+		}
+		if (z < 0.0f)
+		{
+			float foldedX = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+			float foldedY = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+			x = foldedX;
+			y = foldedY;
+		}
+		auto snorm = [](float value) {
+			return static_cast<int16_t>(std::lround((std::min)((std::max)(value, -1.0f), 1.0f) * 32767.0f));
+		};
+		packed.normal[0] = snorm(x);
+		packed.normal[1] = snorm(y);
+		return packed;
+	}
+
+	static GPUInstanceData PackInstance(const GPUInstance& instance)
+	{
+		const GW::MATH::GMATRIXF& m = instance.transform;
+		GPUInstanceData packed;
+		packed.world[0] = { m.row1.x, m.row2.x, m.row3.x, m.row4.x };
+		packed.world[1] = { m.row1.y, m.row2.y, m.row3.y, m.row4.y };
+		packed.world[2] = { m.row1.z, m.row2.z, m.row3.z, m.row4.z };
+		packed.materialIndex = instance.materialIndex;
+		packed.tint = instance.tint;
+		packed.velocity[0] = instance.velocity[0];
+		packed.velocity[1] = instance.velocity[1];
+		return packed;
+	}
+
 	static std::vector<entt::entity> GetRenderableEntities(entt::registry& registry, const std::string blenderName)
 	{
 		DRAW::ModelManager* modelManager = registry.ctx().find<DRAW::ModelManager>();
@@ -164,6 +820,9 @@ namespace DRAW
 			entt::entity newEntity = registry.create();
 			registry.emplace<DRAW::GPUInstance>(newEntity, *gpuInstance);
 			registry.emplace<DRAW::GeometryData>(newEntity, *geometryData);
+			if (DRAW::DrawSlotIndex* drawSlot = registry.try_get<DRAW::DrawSlotIndex>(entityToCopy)) {
+				registry.emplace<DRAW::DrawSlotIndex>(newEntity, *drawSlot);
+			}
 
 			meshCollection.entities.push_back(newEntity);
 		}
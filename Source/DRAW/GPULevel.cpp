@@ -1,6 +1,8 @@
 #include "DrawComponents.h"
 #include "../GAME/GameComponents.h"
 #include "../CCL.h"
+#include <cmath>
+#include <cstring>
 
 namespace DRAW
 {
@@ -16,23 +18,112 @@ namespace DRAW
 			return;
 		}
 
-		// Emplace buffers
-		VulkanVertexBuffer& vertexBuffer = registry.emplace<VulkanVertexBuffer>(entity);
-		VulkanIndexBuffer& indexBuffer = registry.emplace<VulkanIndexBuffer>(entity);
-
-		// Emplace respective data
-		registry.emplace<std::vector<H2B::VERTEX>>(entity, cpuLevel->levelData.levelVertices);
-		registry.emplace<std::vector<unsigned int>>(entity, cpuLevel->levelData.levelIndices);
+		// Headless registries (batch simulation) only need the mesh entities and colliders
+		if (registry.all_of<VulkanRenderer>(entity)) {
+			// Emplace buffers
+			VulkanVertexBuffer& vertexBuffer = registry.emplace<VulkanVertexBuffer>(entity);
+			VulkanIndexBuffer& indexBuffer = registry.emplace<VulkanIndexBuffer>(entity);
+
+			// Emplace respective data, vertices packed down to 20 bytes when the level asks for it
+			if (cpuLevel->packedVertices) {
+				std::vector<PackedVertex> packedVertices;
+				packedVertices.reserve(cpuLevel->levelData.levelVertices.size());
+				for (const H2B::VERTEX& vertex : cpuLevel->levelData.levelVertices) {
+					packedVertices.push_back(PackVertex(vertex));
+				}
+				log.Log(("Packed vertices: " + std::to_string(sizeof(H2B::VERTEX) * packedVertices.size() / 1024) + " KB -> " +
+					std::to_string(sizeof(PackedVertex) * packedVertices.size() / 1024) + " KB").c_str());
+				registry.emplace<std::vector<PackedVertex>>(entity, std::move(packedVertices));
+			}
+			else {
+				registry.emplace<std::vector<H2B::VERTEX>>(entity, cpuLevel->levelData.levelVertices);
+			}
+			registry.emplace<std::vector<unsigned int>>(entity, cpuLevel->levelData.levelIndices);
 
-		// Patch to entity (calls respective components' update method)
-		registry.patch<VulkanVertexBuffer>(entity);
-		registry.patch<VulkanIndexBuffer>(entity);
+			// Patch to entity (calls respective components' update method)
+			registry.patch<VulkanVertexBuffer>(entity);
+			registry.patch<VulkanIndexBuffer>(entity);
+		}
 
 		ModelManager* modelManager = registry.ctx().find<ModelManager>();
 		if (!modelManager) {
 			modelManager = &registry.ctx().emplace<ModelManager>();
 		}
 
+		// One draw slot per unique mesh batch, shared by every entity drawn with that batch
+		if (registry.ctx().find<DrawTable>()) {
+			registry.ctx().erase<DrawTable>();
+		}
+		DrawTable& drawTable = registry.ctx().emplace<DrawTable>();
+		std::map<unsigned int, unsigned int> slotByIndexStart;
+		for (const Level_Data::LEVEL_MODEL& levelModel : cpuLevel->levelData.levelModels) {
+			for (unsigned int meshIndex = levelModel.meshStart; meshIndex < levelModel.meshStart + levelModel.meshCount; ++meshIndex) {
+				const H2B::BATCH& drawInfo = cpuLevel->levelData.levelMeshes[meshIndex].drawInfo;
+				GeometryData geometry = { levelModel.indexStart + drawInfo.indexOffset, drawInfo.indexCount, levelModel.vertexStart };
+				if (slotByIndexStart.emplace(geometry.indexStart, 0).second) {
+					drawTable.slots.push_back(DrawSlot{ geometry });
+				}
+			}
+		}
+		std::sort(drawTable.slots.begin(), drawTable.slots.end(), [](const DrawSlot& a, const DrawSlot& b) {
+			return a.geometry < b.geometry;
+			});
+		for (unsigned int slot = 0; slot < drawTable.slots.size(); ++slot) {
+			slotByIndexStart[drawTable.slots[slot].geometry.indexStart] = slot;
+		}
+		drawTable.writeCursor.resize(drawTable.slots.size());
+
+		// Every mesh of a model is culled with the sphere around the model's collider
+		drawTable.slotBounds.resize(drawTable.slots.size());
+		for (const Level_Data::LEVEL_MODEL& levelModel : cpuLevel->levelData.levelModels) {
+			const GW::MATH::GOBBF& collider = cpuLevel->levelData.levelColliders[levelModel.colliderIndex];
+			GW::MATH::GVECTORF sphere = { collider.center.x, collider.center.y, collider.center.z,
+				std::sqrt(collider.extent.x * collider.extent.x + collider.extent.y * collider.extent.y + collider.extent.z * collider.extent.z) };
+			for (unsigned int meshIndex = levelModel.meshStart; meshIndex < levelModel.meshStart + levelModel.meshCount; ++meshIndex) {
+				const H2B::BATCH& drawInfo = cpuLevel->levelData.levelMeshes[meshIndex].drawInfo;
+				drawTable.slotBounds[slotByIndexStart[levelModel.indexStart + drawInfo.indexOffset]] = sphere;
+			}
+		}
+
+		// LOD levels built at import, a slot without any keeps drawing its own geometry at every distance
+		const unsigned int maxLods = MeshLODs::maxLevels;
+		drawTable.lodGeometry.resize(drawTable.slots.size() * maxLods);
+		drawTable.lodError.assign(drawTable.slots.size() * maxLods, 0.0f);
+		drawTable.lodCount.assign(drawTable.slots.size(), 1);
+		for (unsigned int slot = 0; slot < drawTable.slots.size(); ++slot) {
+			drawTable.lodGeometry[slot * maxLods] = drawTable.slots[slot].geometry;
+		}
+		const std::vector<MeshLODs>& meshLods = cpuLevel->levelData.levelMeshLods;
+		for (const Level_Data::LEVEL_MODEL& levelModel : cpuLevel->levelData.levelModels) {
+			for (unsigned int meshIndex = levelModel.meshStart; meshIndex < levelModel.meshStart + levelModel.meshCount && meshIndex < meshLods.size(); ++meshIndex) {
+				const MeshLODs& lods = meshLods[meshIndex];
+				unsigned int slot = slotByIndexStart[levelModel.indexStart + lods.levels[0].indexOffset];
+				for (unsigned int lod = 1; lod < lods.count; ++lod) {
+					drawTable.lodGeometry[slot * maxLods + lod] = { levelModel.indexStart + lods.levels[lod].indexOffset, lods.levels[lod].indexCount, levelModel.vertexStart };
+					drawTable.lodError[slot * maxLods + lod] = lods.error[lod];
+				}
+				drawTable.lodCount[slot] = lods.count;
+			}
+		}
+
+		// Deduplicate materials, every bullet and star ends up sharing one entry
+		if (registry.ctx().find<MaterialTable>()) {
+			registry.ctx().erase<MaterialTable>();
+		}
+		MaterialTable& materialTable = registry.ctx().emplace<MaterialTable>();
+		std::vector<unsigned int> materialRemap;
+		for (const H2B::MATERIAL& material : cpuLevel->levelData.levelMaterials) {
+			unsigned int index = 0;
+			while (index < materialTable.materials.size() &&
+				std::memcmp(&materialTable.materials[index], &material.attrib, sizeof(H2B::ATTRIBUTES)) != 0) {
+				++index;
+			}
+			if (index == materialTable.materials.size()) {
+				materialTable.materials.push_back(material.attrib);
+			}
+			materialRemap.push_back(index);
+		}
+
 		std::vector<Level_Data::BLENDER_OBJECT>& blenderObjects = cpuLevel->levelData.blenderObjects;
 		for (const Level_Data::BLENDER_OBJECT& blenderObject : blenderObjects) {
 			int modelIndex = blenderObject.modelIndex;
@@ -61,17 +152,20 @@ namespace DRAW
 				};
 
 				registry.emplace<GeometryData>(meshEntity, geometryData);
+				registry.emplace<DrawSlotIndex>(meshEntity, slotByIndexStart[geometryData.indexStart]);
 				
 				if (levelModel.isDynamic) {
 					registry.emplace<DoNotRender>(meshEntity);
 				}
+				else {
+					registry.emplace<StaticInstance>(meshEntity);
+				}
 
 				int materialIndex = levelModel.materialStart + mesh.materialIndex;
-				H2B::MATERIAL& material = cpuLevel->levelData.levelMaterials[materialIndex];
 
 				DRAW::GPUInstance gpuInstance = {
 					levelTransform,
-					material.attrib
+					materialRemap[materialIndex]
 				};
 				registry.emplace<GPUInstance>(meshEntity, gpuInstance);
 
@@ -97,6 +191,33 @@ namespace DRAW
 
 			modelManager->meshCollections[blenderObject.blendername] = meshCollection;
 		}
+
+		// Pack the static meshes once, bucketed by slot like the per-frame instances
+		auto staticView = registry.view<DrawSlotIndex, GPUInstance, StaticInstance>();
+		std::vector<unsigned int> staticCounts(drawTable.slots.size(), 0);
+		for (auto [meshEntity, drawSlot, gpuInstance] : staticView.each()) {
+			++staticCounts[drawSlot.slot];
+		}
+		unsigned int staticTotal = 0;
+		for (unsigned int slot = 0; slot < drawTable.slots.size(); ++slot) {
+			drawTable.writeCursor[slot] = staticTotal;
+			if (staticCounts[slot] > 0) {
+				drawTable.staticSlots.push_back(DrawSlot{ drawTable.slots[slot].geometry, staticCounts[slot], staticTotal });
+			}
+			staticTotal += staticCounts[slot];
+		}
+		drawTable.staticInstances.resize(staticTotal);
+		for (auto [meshEntity, drawSlot, gpuInstance] : staticView.each()) {
+			drawTable.staticInstances[drawTable.writeCursor[drawSlot.slot]++] = PackInstance(gpuInstance);
+		}
+
+		// Materials and static instances never change after load, one upload each for the whole level
+		if (registry.all_of<VulkanRenderer>(entity)) {
+			registry.emplace_or_replace<VulkanMaterialBuffer>(entity);
+			registry.patch<VulkanMaterialBuffer>(entity);
+			registry.emplace_or_replace<VulkanStaticInstanceBuffer>(entity);
+			registry.patch<VulkanStaticInstanceBuffer>(entity);
+		}
 	}
 
 	void Destroy_ModelManager(entt::registry& registry, entt::entity entity)
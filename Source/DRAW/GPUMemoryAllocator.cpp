@@ -0,0 +1,260 @@
+#include "DrawComponents.h"
+#include "../CCL.h"
+#include <iostream>
+
+namespace DRAW
+{
+	//*** HELPERS ***//
+	static uint32_t FindMemoryType(const VkPhysicalDeviceMemoryProperties& memoryProperties,
+		uint32_t typeFilter, VkMemoryPropertyFlags properties)
+	{
+		for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; ++i) {
+			if ((typeFilter & (1u << i)) &&
+				(memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+				return i;
+			}
+		}
+		throw std::runtime_error("Failed to find suitable Vulkan memory type.");
+	}
+
+	// Allocates and, for host-visible types, maps one VkDeviceMemory for good
+	static GPUMemoryAllocator::Block AllocateBlock(GPUMemoryAllocator& allocator, uint32_t memoryType, VkDeviceSize size)
+	{
+		VkMemoryAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = size;
+		allocInfo.memoryTypeIndex = memoryType;
+
+		GPUMemoryAllocator::Block block;
+		if (vkAllocateMemory(allocator.device, &allocInfo, nullptr, &block.memory) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to allocate Vulkan memory block.");
+		}
+		block.size = size;
+
+		if (allocator.memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+			vkMapMemory(allocator.device, block.memory, 0, VK_WHOLE_SIZE, 0, (void**)&block.mapped);
+		}
+
+		++allocator.stats.deviceAllocations;
+		allocator.stats.peakDeviceAllocations = (std::max)(allocator.stats.peakDeviceAllocations, allocator.stats.deviceAllocations);
+		allocator.stats.bytesReserved += size;
+		if (!allocator.allocationWarningShown && allocator.stats.deviceAllocations > allocator.maxAllocationCount / 2) {
+			allocator.allocationWarningShown = true;
+			std::cout << "GPU memory: " << allocator.stats.deviceAllocations << " device allocations, driver limit is "
+				<< allocator.maxAllocationCount << std::endl;
+		}
+		return block;
+	}
+
+	static void FreeBlock(GPUMemoryAllocator& allocator, GPUMemoryAllocator::Block& block)
+	{
+		if (block.memory == VK_NULL_HANDLE)
+			return;
+
+		// freeing mapped memory unmaps it
+		vkFreeMemory(allocator.device, block.memory, nullptr);
+		--allocator.stats.deviceAllocations;
+		allocator.stats.bytesReserved -= block.size;
+		block = GPUMemoryAllocator::Block{};
+	}
+
+	static int SizeClass(VkDeviceSize size)
+	{
+		VkDeviceSize classSize = GPUMemoryAllocator::minClassSize;
+		for (int sizeClass = 0; sizeClass < GPUMemoryAllocator::classCount; ++sizeClass, classSize <<= 1) {
+			if (size <= classSize)
+				return sizeClass;
+		}
+		return -1;
+	}
+
+	static GPUAllocation Allocate(GPUMemoryAllocator& allocator, const VkMemoryRequirements& requirements,
+		VkMemoryPropertyFlags properties, GPUMemoryPool pool)
+	{
+		GPUAllocation allocation;
+		allocation.memoryType = FindMemoryType(allocator.memoryProperties, requirements.memoryTypeBits, properties);
+		allocation.size = requirements.size;
+		allocation.pool = pool;
+		GPUMemoryAllocator::TypeHeap& heap = allocator.heaps[allocation.memoryType];
+
+		// Level data is bump allocated and only ever released all together
+		if (pool == GPUMemoryPool::Level && requirements.size <= GPUMemoryAllocator::linearBlockSize / 2) {
+			for (uint32_t i = 0; i <= heap.linearBlocks.size(); ++i) {
+				if (i == heap.linearBlocks.size()) {
+					heap.linearBlocks.push_back(AllocateBlock(allocator, allocation.memoryType, GPUMemoryAllocator::linearBlockSize));
+				}
+				GPUMemoryAllocator::Block& block = heap.linearBlocks[i];
+				VkDeviceSize offset = (block.head + requirements.alignment - 1) / requirements.alignment * requirements.alignment;
+				if (offset + requirements.size > block.size)
+					continue;
+
+				block.head = offset + requirements.size;
+				++block.live;
+				allocation.memory = block.memory;
+				allocation.offset = offset;
+				allocation.mapped = block.mapped ? block.mapped + offset : nullptr;
+				allocation.sizeClass = GPUAllocation::linear;
+				allocation.block = i;
+				break;
+			}
+		}
+		else {
+			// a slot's offset is a multiple of its class size, so any alignment up to it holds
+			int sizeClass = SizeClass((std::max)(requirements.size, requirements.alignment));
+			if (sizeClass < 0) {
+				heap.dedicated.push_back(AllocateBlock(allocator, allocation.memoryType, requirements.size));
+				GPUMemoryAllocator::Block& block = heap.dedicated.back();
+				allocation.memory = block.memory;
+				allocation.mapped = block.mapped;
+				allocation.sizeClass = GPUAllocation::dedicated;
+			}
+			else {
+				VkDeviceSize classSize = GPUMemoryAllocator::minClassSize << sizeClass;
+				auto& freeSlots = heap.freeSlots[sizeClass];
+				if (freeSlots.empty()) {
+					// carve a new slab into slots of this class
+					VkDeviceSize slabSize = (std::max)(classSize * 4, GPUMemoryAllocator::minSlabSize);
+					uint32_t slab = static_cast<uint32_t>(heap.slabs[sizeClass].size());
+					heap.slabs[sizeClass].push_back(AllocateBlock(allocator, allocation.memoryType, slabSize));
+					for (VkDeviceSize offset = slabSize; offset >= classSize; offset -= classSize) {
+						freeSlots.push_back({ slab, offset - classSize });
+					}
+				}
+
+				auto [slab, offset] = freeSlots.back();
+				freeSlots.pop_back();
+				GPUMemoryAllocator::Block& block = heap.slabs[sizeClass][slab];
+				++block.live;
+				allocation.memory = block.memory;
+				allocation.offset = offset;
+				allocation.mapped = block.mapped ? block.mapped + offset : nullptr;
+				allocation.sizeClass = sizeClass;
+				allocation.block = slab;
+			}
+		}
+
+		++allocator.stats.liveAllocations;
+		++allocator.stats.totalAllocations;
+		allocator.stats.bytesInUse += allocation.size;
+		return allocation;
+	}
+
+	void FreeGPUAllocation(GPUMemoryAllocator& allocator, const GPUAllocation& allocation)
+	{
+		if (allocation.memory == VK_NULL_HANDLE)
+			return;
+
+		GPUMemoryAllocator::TypeHeap& heap = allocator.heaps[allocation.memoryType];
+		if (allocation.sizeClass == GPUAllocation::dedicated) {
+			for (GPUMemoryAllocator::Block& block : heap.dedicated) {
+				if (block.memory == allocation.memory) {
+					FreeBlock(allocator, block);
+					std::swap(block, heap.dedicated.back());
+					heap.dedicated.pop_back();
+					break;
+				}
+			}
+		}
+		else if (allocation.sizeClass == GPUAllocation::linear) {
+			// the whole block starts over once the last thing in it is gone
+			GPUMemoryAllocator::Block& block = heap.linearBlocks[allocation.block];
+			if (--block.live == 0)
+				block.head = 0;
+		}
+		else {
+			--heap.slabs[allocation.sizeClass][allocation.block].live;
+			heap.freeSlots[allocation.sizeClass].push_back({ allocation.block, allocation.offset });
+		}
+
+		--allocator.stats.liveAllocations;
+		allocator.stats.bytesInUse -= allocation.size;
+	}
+
+	void CreateAllocatedBuffer(entt::registry& registry, entt::entity rendererEntity, VkDeviceSize size,
+		VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer* buffer, GPUAllocation* allocation, GPUMemoryPool pool)
+	{
+		auto& allocator = registry.get<GPUMemoryAllocator>(rendererEntity);
+
+		VkBufferCreateInfo bufInfo{};
+		bufInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufInfo.size = size;
+		bufInfo.usage = usage;
+		bufInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		if (vkCreateBuffer(allocator.device, &bufInfo, nullptr, buffer) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create buffer.");
+		}
+
+		VkMemoryRequirements memReq{};
+		vkGetBufferMemoryRequirements(allocator.device, *buffer, &memReq);
+		*allocation = Allocate(allocator, memReq, properties, pool);
+		vkBindBufferMemory(allocator.device, *buffer, allocation->memory, allocation->offset);
+	}
+
+	void DestroyAllocatedBuffer(entt::registry& registry, entt::entity rendererEntity, VkBuffer buffer, const GPUAllocation& allocation)
+	{
+		auto& renderer = registry.get<VulkanRenderer>(rendererEntity);
+		vkDestroyBuffer(renderer.device, buffer, nullptr);
+
+		// without the allocator its blocks, and this memory with them, are already gone
+		if (GPUMemoryAllocator* allocator = registry.try_get<GPUMemoryAllocator>(rendererEntity)) {
+			FreeGPUAllocation(*allocator, allocation);
+		}
+	}
+
+	void ReportGPUMemory(const GPUMemoryAllocator& allocator)
+	{
+		const GPUMemoryStats& stats = allocator.stats;
+		std::cout << "GPU memory: " << stats.liveAllocations << " buffers in " << stats.deviceAllocations
+			<< " device allocations (peak " << stats.peakDeviceAllocations << ", limit " << allocator.maxAllocationCount << "), "
+			<< (stats.bytesInUse >> 10) << " KB used of " << (stats.bytesReserved >> 10) << " KB reserved, "
+			<< stats.totalAllocations << " sub-allocations so far" << std::endl;
+	}
+
+	//*** SYSTEMS ***//
+	void Construct_GPUMemoryAllocator(entt::registry& registry, entt::entity entity)
+	{
+		auto& allocator = registry.get<GPUMemoryAllocator>(entity);
+		auto& renderer = registry.get<VulkanRenderer>(entity);
+
+		allocator.device = renderer.device;
+		vkGetPhysicalDeviceMemoryProperties(renderer.physicalDevice, &allocator.memoryProperties);
+		VkPhysicalDeviceProperties deviceProperties;
+		vkGetPhysicalDeviceProperties(renderer.physicalDevice, &deviceProperties);
+		allocator.maxAllocationCount = deviceProperties.limits.maxMemoryAllocationCount;
+		allocator.heaps.resize(allocator.memoryProperties.memoryTypeCount);
+	}
+
+	// Everything still sub-allocated goes with its block. registry.clear() may get here
+	// before the renderer's own teardown, so make sure nothing is still reading it.
+	void Destroy_GPUMemoryAllocator(entt::registry& registry, entt::entity entity)
+	{
+		auto& allocator = registry.get<GPUMemoryAllocator>(entity);
+		if (allocator.device == nullptr)
+			return;
+
+		vkDeviceWaitIdle(allocator.device);
+		ReportGPUMemory(allocator);
+		for (GPUMemoryAllocator::TypeHeap& heap : allocator.heaps) {
+			for (auto& slabs : heap.slabs) {
+				for (GPUMemoryAllocator::Block& block : slabs) {
+					FreeBlock(allocator, block);
+				}
+			}
+			for (GPUMemoryAllocator::Block& block : heap.linearBlocks) {
+				FreeBlock(allocator, block);
+			}
+			for (GPUMemoryAllocator::Block& block : heap.dedicated) {
+				FreeBlock(allocator, block);
+			}
+		}
+		allocator.heaps.clear();
+	}
+
+	// Use this MACRO to connect the EnTT Component Logic
+	CONNECT_COMPONENT_LOGIC() {
+		registry.on_construct<GPUMemoryAllocator>().connect<Construct_GPUMemoryAllocator>();
+		registry.on_destroy<GPUMemoryAllocator>().connect<Destroy_GPUMemoryAllocator>();
+	}
+
+} // namespace DRAW
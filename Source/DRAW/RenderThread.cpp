@@ -0,0 +1,352 @@
+#include "DrawComponents.h"
+#include "../CCL.h"
+// component dependencies
+#include "Utility/TextMeshBuilder.h"
+#include "../GAME/GameComponents.h"
+
+#include <algorithm>
+#include <cmath>
+#include <emmintrin.h>
+#include <string>
+
+namespace DRAW
+{
+	//*** HELPERS ***//
+	// Six planes laid out component by component, so one SSE register holds a coordinate of four spheres
+	// and every plane is tested against all four at once
+	struct FrustumPlanes
+	{
+		float x[6], y[6], z[6], w[6];
+	};
+
+	// Gribb/Hartmann: with row vectors clip = pos * viewProjection, each plane is a sum of its columns.
+	// Vulkan clip depth runs 0..w, so the near plane is the z column alone.
+	static FrustumPlanes ExtractFrustumPlanes(const GW::MATH::GMATRIXF& viewProjection)
+	{
+		const GW::MATH::GMATRIXF& m = viewProjection;
+		const GW::MATH::GVECTORF colX = { m.row1.x, m.row2.x, m.row3.x, m.row4.x };
+		const GW::MATH::GVECTORF colY = { m.row1.y, m.row2.y, m.row3.y, m.row4.y };
+		const GW::MATH::GVECTORF colZ = { m.row1.z, m.row2.z, m.row3.z, m.row4.z };
+		const GW::MATH::GVECTORF colW = { m.row1.w, m.row2.w, m.row3.w, m.row4.w };
+		const GW::MATH::GVECTORF planes[6] = {
+			{ colW.x + colX.x, colW.y + colX.y, colW.z + colX.z, colW.w + colX.w }, // left
+			{ colW.x - colX.x, colW.y - colX.y, colW.z - colX.z, colW.w - colX.w }, // right
+			{ colW.x + colY.x, colW.y + colY.y, colW.z + colY.z, colW.w + colY.w }, // top/bottom
+			{ colW.x - colY.x, colW.y - colY.y, colW.z - colY.z, colW.w - colY.w },
+			colZ,                                                                   // near
+			{ colW.x - colZ.x, colW.y - colZ.y, colW.z - colZ.z, colW.w - colZ.w }, // far
+		};
+
+		FrustumPlanes frustum;
+		for (int plane = 0; plane < 6; ++plane)
+		{
+			// normalized, so the distance compares against a world space radius
+			const GW::MATH::GVECTORF& p = planes[plane];
+			float length = std::sqrt(p.x * p.x + p.y * p.y + p.z * p.z);
+			float scale = length > 0.0f ? 1.0f / length : 0.0f;
+			frustum.x[plane] = p.x * scale;
+			frustum.y[plane] = p.y * scale;
+			frustum.z[plane] = p.z * scale;
+			frustum.w[plane] = p.w * scale;
+		}
+		return frustum;
+	}
+
+	// Tests cullInstances [begin, end) four at a time. Movers handed to the GPU are tested where
+	// the vertex shader will put them, their transform plus velocity * motionTime.
+	// The distance to the near plane comes out of the same test, it is what the draw keys sort by.
+	// lodScale is the pixels one unit covers at a distance of one unit, the LOD of a visible instance is the
+	// coarsest whose error projects to no more than lodPixelThreshold at the near side of its bounding sphere
+	static void CullInstances(DrawTable& drawTable, const FrustumPlanes& frustum, float motionTime, float lodScale, size_t begin, size_t end)
+	{
+		for (size_t first = begin; first < end; first += 4)
+		{
+			size_t lanes = (std::min)(end - first, size_t(4));
+			alignas(16) float centerX[4] = {}, centerY[4] = {}, centerZ[4] = {}, radius[4] = {}, nearDistance[4];
+			float axisScale[4] = {};
+			for (size_t lane = 0; lane < lanes; ++lane)
+			{
+				const GPUInstance& instance = *drawTable.cullInstances[first + lane];
+				const GW::MATH::GVECTORF& bounds = drawTable.slotBounds[drawTable.cullSlots[first + lane]];
+				const GW::MATH::GMATRIXF& m = instance.transform;
+				centerX[lane] = bounds.x * m.row1.x + bounds.y * m.row2.x + bounds.z * m.row3.x + m.row4.x + instance.velocity[0] * motionTime;
+				centerY[lane] = bounds.x * m.row1.y + bounds.y * m.row2.y + bounds.z * m.row3.y + m.row4.y;
+				centerZ[lane] = bounds.x * m.row1.z + bounds.y * m.row2.z + bounds.z * m.row3.z + m.row4.z + instance.velocity[1] * motionTime;
+
+				// the largest axis scale keeps the sphere around the model however it is stretched
+				float scale = (std::max)({
+					m.row1.x * m.row1.x + m.row1.y * m.row1.y + m.row1.z * m.row1.z,
+					m.row2.x * m.row2.x + m.row2.y * m.row2.y + m.row2.z * m.row2.z,
+					m.row3.x * m.row3.x + m.row3.y * m.row3.y + m.row3.z * m.row3.z });
+				axisScale[lane] = std::sqrt(scale);
+				radius[lane] = bounds.w * axisScale[lane];
+			}
+
+			__m128 x = _mm_load_ps(centerX);
+			__m128 y = _mm_load_ps(centerY);
+			__m128 z = _mm_load_ps(centerZ);
+			__m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_load_ps(radius));
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (int plane = 0; plane < 6; ++plane)
+			{
+				__m128 distance = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(frustum.x[plane])), _mm_mul_ps(y, _mm_set1_ps(frustum.y[plane]))),
+					_mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(frustum.z[plane])), _mm_set1_ps(frustum.w[plane])));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+				if (plane == 4)
+					_mm_store_ps(nearDistance, distance);
+			}
+
+			int mask = _mm_movemask_ps(inside);
+			for (size_t lane = 0; lane < lanes; ++lane)
+			{
+				drawTable.cullVisible[first + lane] = static_cast<unsigned char>((mask >> lane) & 1);
+				drawTable.cullDepth[first + lane] = nearDistance[lane];
+
+				// anything reaching past the near plane is close enough for the full mesh
+				unsigned int slot = drawTable.cullSlots[first + lane];
+				float closest = nearDistance[lane] - radius[lane];
+				unsigned int lod = closest > 0.0f ? drawTable.lodCount[slot] - 1 : 0;
+				float pixelsPerUnit = closest > 0.0f ? lodScale * axisScale[lane] / closest : 0.0f;
+				while (lod > 0 && !(drawTable.lodError[slot * MeshLODs::maxLevels + lod] * pixelsPerUnit <= drawTable.lodPixelThreshold))
+					--lod;
+				drawTable.cullLod[first + lane] = static_cast<unsigned char>(lod);
+			}
+		}
+	}
+
+	// Buckets every anchored record by slot with a counting sort, the same layout as the static region
+	static std::shared_ptr<const AnchoredRegion> PackAnchoredRegion(entt::registry& registry, DrawTable& drawTable, unsigned long long version)
+	{
+		auto region = std::make_shared<AnchoredRegion>();
+		region->version = version;
+
+		auto anchoredView = registry.view<DrawSlotIndex, GPUInstance, AnchoredInstance>(entt::exclude<DoNotRender>);
+		std::vector<unsigned int> counts(drawTable.slots.size(), 0);
+		for (auto [meshEntity, drawSlot, gpuInstance] : anchoredView.each())
+			++counts[drawSlot.slot];
+
+		unsigned int total = 0;
+		for (unsigned int slot = 0; slot < drawTable.slots.size(); ++slot)
+		{
+			drawTable.writeCursor[slot] = total;
+			if (counts[slot] > 0)
+				region->slots.push_back(DrawSlot{ drawTable.slots[slot].geometry, counts[slot], total });
+			total += counts[slot];
+		}
+		region->instances.resize(total);
+		for (auto [meshEntity, drawSlot, gpuInstance] : anchoredView.each())
+			region->instances[drawTable.writeCursor[drawSlot.slot]++] = PackInstance(gpuInstance);
+		return region;
+	}
+
+	void ExtractRenderSnapshot(entt::registry& registry, entt::entity entity, RenderSnapshot& snapshot)
+	{
+		GetRenderTargetSize(registry, entity, snapshot.windowWidth, snapshot.windowHeight);
+
+		// We really only support one camera, so use the first one
+		auto cameraView = registry.view<Camera>();
+		if (!cameraView.empty())
+		{
+			snapshot.camera = registry.get<Camera>(cameraView.front()).camMatrix;
+		}
+		MotionClock* clock = registry.ctx().find<MotionClock>();
+		snapshot.motionTime = clock ? clock->seconds : 0.0;
+
+		// everything that moves and is in view, radix sorted by draw key, one draw per run of equal keys
+		snapshot.slots.clear();
+		snapshot.instances.clear();
+		snapshot.culledInstances = 0;
+		if (DrawTable* drawTable = registry.ctx().find<DrawTable>())
+		{
+			// anchored movers only change when one is (re-)anchored or destroyed, every other frame shares the last packing
+			unsigned long long anchorVersion = clock ? clock->anchorVersion : 0;
+			if (!drawTable->anchored || drawTable->anchored->version != anchorVersion)
+				drawTable->anchored = PackAnchoredRegion(registry, *drawTable, anchorVersion);
+			snapshot.anchored = drawTable->anchored;
+
+			auto drawView = registry.view<DrawSlotIndex, GPUInstance>(entt::exclude<DoNotRender, StaticInstance, AnchoredInstance>);
+			drawTable->cullInstances.clear();
+			drawTable->cullSlots.clear();
+			for (auto [meshEntity, drawSlot, gpuInstance] : drawView.each())
+			{
+				drawTable->cullInstances.push_back(&gpuInstance);
+				drawTable->cullSlots.push_back(drawSlot.slot);
+			}
+			size_t candidateCount = drawTable->cullInstances.size();
+			drawTable->cullVisible.resize(candidateCount);
+			drawTable->cullDepth.resize(candidateCount);
+			drawTable->cullLod.resize(candidateCount);
+
+			// projMatrix never changes after construction, unlike SceneData it is safe to read while the render thread draws
+			GW::MATH::GMATRIXF view, viewProjection;
+			GW::MATH::GMatrix::InverseF(snapshot.camera, view);
+			const GW::MATH::GMATRIXF& projection = registry.get<VulkanRenderer>(entity).projMatrix;
+			GW::MATH::GMatrix::MultiplyMatrixF(view, projection, viewProjection);
+			FrustumPlanes frustum = ExtractFrustumPlanes(viewProjection);
+			float motionTime = static_cast<float>(snapshot.motionTime);
+			// row2.y is cot(fovY / 2) (negated when y is flipped), half the window height spans that many units at a distance of one
+			float lodScale = std::fabs(projection.row2.y) * snapshot.windowHeight * 0.5f;
+
+			// batches are a multiple of four so only the last one has a partial SSE group
+			const size_t cullBatchSize = 1024;
+			auto cull = [&](size_t begin, size_t end) { CullInstances(*drawTable, frustum, motionTime, lodScale, begin, end); };
+			VulkanCommandRecorder* recorder = registry.try_get<VulkanCommandRecorder>(entity);
+			if (recorder && recorder->jobs && candidateCount > cullBatchSize)
+				recorder->jobs->ParallelFor(candidateCount, cullBatchSize, cull);
+			else
+				cull(0, candidateCount);
+
+			// materials come out of the storage buffer per instance, there is no material state to group by yet;
+			// the mesh field is the slot's LOD, so every level of a mesh is a draw of its own
+			float depthRange = frustum.w[4] + frustum.w[5];
+			drawTable->sortEntries.clear();
+			for (size_t candidate = 0; candidate < candidateCount; ++candidate)
+			{
+				if (!drawTable->cullVisible[candidate])
+					continue;
+				uint64_t key = DrawKey::Make(RecordPass::DynamicScene, DrawPipeline::Scene, 0,
+					DrawKey::DepthBucket(drawTable->cullDepth[candidate], depthRange),
+					drawTable->cullSlots[candidate] * MeshLODs::maxLevels + drawTable->cullLod[candidate]);
+				drawTable->sortEntries.push_back({ key, static_cast<uint32_t>(candidate) });
+			}
+			UTIL::RadixSort(drawTable->sortEntries, drawTable->sortScratch);
+
+			snapshot.instances.resize(drawTable->sortEntries.size());
+			for (size_t i = 0; i < drawTable->sortEntries.size(); ++i)
+			{
+				const UTIL::SortEntry& entry = drawTable->sortEntries[i];
+				if (i == 0 || entry.key != drawTable->sortEntries[i - 1].key)
+				{
+					snapshot.slots.push_back(DrawSlot{ drawTable->lodGeometry[DrawKey::Mesh(entry.key)], 0, static_cast<unsigned int>(i) });
+				}
+				++snapshot.slots.back().instanceCount;
+				snapshot.instances[i] = PackInstance(*drawTable->cullInstances[entry.value]);
+			}
+			snapshot.culledInstances = static_cast<unsigned int>(candidateCount - snapshot.instances.size());
+		}
+
+		snapshot.hudText.clear();
+		TextRenderer* textRenderer = registry.ctx().find<TextRenderer>();
+		GAME::HUDData* hud = registry.ctx().find<GAME::HUDData>();
+		if (textRenderer && hud && !hud->text.empty())
+		{
+			snapshot.hudText = BuildTextMesh(textRenderer->font, hud->text, hud->x, hud->y);
+		}
+	}
+
+	// Draws every snapshot the main thread publishes. The registry is only touched in BeginSnapshotFrame,
+	// which the main thread waits for; recording and presenting overlap its next tick.
+	static void RenderThreadLoop(entt::registry* registry, entt::entity entity, RenderHandoff::Shared* shared)
+	{
+		unsigned long long drawn = shared->released;
+		while (true)
+		{
+			shared->published.wait(drawn);
+			if (shared->stopping)
+				break;
+
+			++drawn;
+			FrameSubmission submission;
+			bool started = BeginSnapshotFrame(*registry, entity, shared->snapshots[drawn % 2], submission);
+			shared->released = drawn;
+			shared->released.notify_one();
+
+			if (started)
+				EndSnapshotFrame(submission);
+			shared->presented = drawn;
+			shared->presented.notify_one();
+		}
+	}
+
+	bool RenderThreadRequested(int argc, char** argv)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			if (std::string(argv[i]) == "--render-thread")
+				return true;
+		}
+		return false;
+	}
+
+	void StartRenderThread(entt::registry& registry, entt::entity entity)
+	{
+		auto& handoff = registry.get<RenderHandoff>(entity);
+		if (handoff.thread.joinable())
+			return;
+
+		handoff.shared->stopping = false;
+		handoff.thread = std::thread(RenderThreadLoop, &registry, entity, handoff.shared.get());
+	}
+
+	void StopRenderThread(entt::registry& registry, entt::entity entity)
+	{
+		RenderHandoff* handoff = registry.try_get<RenderHandoff>(entity);
+		if (!handoff || !handoff->thread.joinable())
+			return;
+
+		// never called mid hand-off, so the thread is presenting or waiting for the next snapshot
+		RenderHandoff::Shared& shared = *handoff->shared;
+		shared.stopping = true;
+		++shared.published;
+		shared.published.notify_one();
+		handoff->thread.join();
+		shared.published = shared.released.load();
+		shared.presented = shared.released.load();
+	}
+
+	void PublishRenderSnapshot(entt::registry& registry, entt::entity entity)
+	{
+		RenderHandoff::Shared& shared = *registry.get<RenderHandoff>(entity).shared;
+
+		// the render thread is done with this slot, the snapshot it held was drawn before the one in flight
+		unsigned long long next = shared.published + 1;
+		ExtractRenderSnapshot(registry, entity, shared.snapshots[next % 2]);
+		shared.published = next;
+		shared.published.notify_one();
+
+		// it needs the registry until the frame's passes are set up, the simulation waits that long
+		for (unsigned long long released = shared.released; released < next; released = shared.released)
+		{
+			shared.released.wait(released);
+		}
+	}
+
+	void WaitForRenderThread(entt::registry& registry, entt::entity entity)
+	{
+		RenderHandoff* handoff = registry.try_get<RenderHandoff>(entity);
+		if (!handoff || !handoff->thread.joinable())
+			return;
+
+		RenderHandoff::Shared& shared = *handoff->shared;
+		unsigned long long published = shared.published;
+		for (unsigned long long presented = shared.presented; presented < published; presented = shared.presented)
+		{
+			shared.presented.wait(presented);
+		}
+	}
+
+	//*** SYSTEMS ***//
+	void Destroy_RenderHandoff(entt::registry& registry, entt::entity entity)
+	{
+		StopRenderThread(registry, entity);
+	}
+
+	// any change to an anchored record makes the next snapshot repack the anchored region
+	void Changed_AnchoredInstance(entt::registry& registry, entt::entity entity)
+	{
+		MotionClock* clock = registry.ctx().find<MotionClock>();
+		if (!clock)
+			clock = &registry.ctx().emplace<MotionClock>();
+		++clock->anchorVersion;
+	}
+
+	// Use this MACRO to connect the EnTT Component Logic
+	CONNECT_COMPONENT_LOGIC() {
+		registry.on_destroy<RenderHandoff>().connect<Destroy_RenderHandoff>();
+		registry.on_construct<AnchoredInstance>().connect<Changed_AnchoredInstance>();
+		registry.on_update<AnchoredInstance>().connect<Changed_AnchoredInstance>();
+		registry.on_destroy<AnchoredInstance>().connect<Changed_AnchoredInstance>();
+	}
+
+} // namespace DRAW
@@ -0,0 +1,733 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+
+namespace DRAW
+{
+    namespace
+    {
+        const unsigned int forsythCacheSize = 32;
+
+        // Tom Forsyth, "Linear-Speed Vertex Cache Optimisation"
+        float ForsythVertexScore(int cachePosition, unsigned int remainingTriangles)
+        {
+            if (remainingTriangles == 0)
+                return -1.0f;
+
+            float score = 0.0f;
+            if (cachePosition >= 0)
+            {
+                // the last triangle's vertices all score the same, no point favouring one of them
+                if (cachePosition < 3)
+                    score = 0.75f;
+                else
+                    score = std::pow(1.0f - (cachePosition - 3) / static_cast<float>(forsythCacheSize - 3), 1.5f);
+            }
+            // vertices with few triangles left get finished off instead of lingering
+            score += 2.0f * std::pow(static_cast<float>(remainingTriangles), -0.5f);
+            return score;
+        }
+
+        void ForsythReorder(const unsigned int* indices, size_t indexCount, unsigned int vertexCount, unsigned int* out)
+        {
+            const size_t triangleCount = indexCount / 3;
+
+            // live triangles of each vertex, adjacency[start[v], start[v] + remaining[v])
+            std::vector<unsigned int> remaining(vertexCount, 0);
+            for (size_t i = 0; i < indexCount; ++i)
+                ++remaining[indices[i]];
+            std::vector<unsigned int> start(vertexCount + 1, 0);
+            for (unsigned int v = 0; v < vertexCount; ++v)
+                start[v + 1] = start[v] + remaining[v];
+            std::vector<unsigned int> adjacency(indexCount);
+            std::vector<unsigned int> fill(start.begin(), start.end() - 1);
+            for (size_t i = 0; i < indexCount; ++i)
+                adjacency[fill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+
+            std::vector<int> cachePosition(vertexCount, -1);
+            std::vector<float> vertexScore(vertexCount);
+            for (unsigned int v = 0; v < vertexCount; ++v)
+                vertexScore[v] = ForsythVertexScore(-1, remaining[v]);
+            std::vector<float> triangleScore(triangleCount);
+            for (size_t t = 0; t < triangleCount; ++t)
+                triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+            std::vector<bool> emitted(triangleCount, false);
+
+            unsigned int cache[forsythCacheSize + 3];
+            unsigned int cacheSize = 0;
+            size_t nextUnemitted = 0;
+            long long best = -1;
+            for (size_t written = 0; written < triangleCount; ++written)
+            {
+                // nothing in the cache touches a live triangle, start a new strip at the next one in order
+                if (best < 0)
+                {
+                    while (emitted[nextUnemitted])
+                        ++nextUnemitted;
+                    best = static_cast<long long>(nextUnemitted);
+                }
+
+                const unsigned int* triangle = &indices[best * 3];
+                std::memcpy(&out[written * 3], triangle, sizeof(unsigned int) * 3);
+                emitted[best] = true;
+                for (int corner = 0; corner < 3; ++corner)
+                {
+                    unsigned int v = triangle[corner];
+                    unsigned int* live = &adjacency[start[v]];
+                    unsigned int* found = std::find(live, live + remaining[v], static_cast<unsigned int>(best));
+                    std::swap(*found, live[remaining[v] - 1]);
+                    --remaining[v];
+                }
+
+                // the triangle's vertices move to the front, everything else shifts back
+                unsigned int newCache[forsythCacheSize + 3];
+                unsigned int newSize = 0;
+                for (int corner = 0; corner < 3; ++corner)
+                    newCache[newSize++] = triangle[corner];
+                for (unsigned int i = 0; i < cacheSize; ++i)
+                {
+                    unsigned int v = cache[i];
+                    if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+                        newCache[newSize++] = v;
+                }
+
+                // rescore everything that moved, including what just fell out
+                for (unsigned int i = 0; i < newSize; ++i)
+                {
+                    unsigned int v = newCache[i];
+                    cachePosition[v] = i < forsythCacheSize ? static_cast<int>(i) : -1;
+                    float score = ForsythVertexScore(cachePosition[v], remaining[v]);
+                    float delta = score - vertexScore[v];
+                    vertexScore[v] = score;
+                    for (unsigned int j = 0; j < remaining[v]; ++j)
+                        triangleScore[adjacency[start[v] + j]] += delta;
+                }
+                cacheSize = (std::min)(newSize, forsythCacheSize);
+                std::memcpy(cache, newCache, sizeof(unsigned int) * cacheSize);
+
+                best = -1;
+                float bestScore = -1.0f;
+                for (unsigned int i = 0; i < cacheSize; ++i)
+                {
+                    unsigned int v = cache[i];
+                    for (unsigned int j = 0; j < remaining[v]; ++j)
+                    {
+                        unsigned int t = adjacency[start[v] + j];
+                        if (triangleScore[t] > bestScore)
+                        {
+                            bestScore = triangleScore[t];
+                            best = t;
+                        }
+                    }
+                }
+            }
+        }
+
+        float ComputeACMR(const unsigned int* indices, size_t indexCount, unsigned int vertexCount, unsigned int cacheSize)
+        {
+            if (indexCount < 3)
+                return 0.0f;
+
+            // FIFO: a vertex is cached while fewer than cacheSize others were loaded after it
+            std::vector<size_t> loadedAt(vertexCount, 0);
+            size_t loads = cacheSize + 1;
+            size_t misses = 0;
+            for (size_t i = 0; i < indexCount; ++i)
+            {
+                if (loads - loadedAt[indices[i]] > cacheSize)
+                {
+                    loadedAt[indices[i]] = loads++;
+                    ++misses;
+                }
+            }
+            return static_cast<float>(misses) / static_cast<float>(indexCount / 3);
+        }
+
+        struct Float3
+        {
+            float x = 0.0f, y = 0.0f, z = 0.0f;
+        };
+
+        // Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw": the cache order
+        // is cut into clusters where a triangle starts cold, and clusters facing away from the middle of the
+        // mesh go first, they are the most likely to hide the rest. Kept only while ACMR stays within threshold.
+        void OptimizeOverdraw(unsigned int* indices, size_t indexCount, const std::vector<H2B::VERTEX>& vertices, float threshold)
+        {
+            const size_t triangleCount = indexCount / 3;
+            const unsigned int vertexCount = static_cast<unsigned int>(vertices.size());
+            if (triangleCount < 2)
+                return;
+
+            std::vector<size_t> clusterStart;
+            {
+                std::vector<size_t> loadedAt(vertexCount, 0);
+                const unsigned int cacheSize = 16;
+                size_t loads = cacheSize + 1;
+                for (size_t t = 0; t < triangleCount; ++t)
+                {
+                    int misses = 0;
+                    for (int corner = 0; corner < 3; ++corner)
+                    {
+                        unsigned int v = indices[t * 3 + corner];
+                        if (loads - loadedAt[v] > cacheSize)
+                        {
+                            loadedAt[v] = loads++;
+                            ++misses;
+                        }
+                    }
+                    if (t == 0 || misses == 3)
+                        clusterStart.push_back(t);
+                }
+            }
+            if (clusterStart.size() < 2)
+                return;
+            clusterStart.push_back(triangleCount);
+            const size_t clusterCount = clusterStart.size() - 1;
+
+            // area weighted centroids and normals, the cross product's length is twice the area
+            std::vector<Float3> clusterCentroid(clusterCount), clusterNormal(clusterCount);
+            Float3 meshCentroid;
+            float meshArea = 0.0f;
+            for (size_t cluster = 0; cluster < clusterCount; ++cluster)
+            {
+                Float3& centroid = clusterCentroid[cluster];
+                Float3& normal = clusterNormal[cluster];
+                float clusterArea = 0.0f;
+                for (size_t t = clusterStart[cluster]; t < clusterStart[cluster + 1]; ++t)
+                {
+                    const H2B::VECTOR& a = vertices[indices[t * 3]].pos;
+                    const H2B::VECTOR& b = vertices[indices[t * 3 + 1]].pos;
+                    const H2B::VECTOR& c = vertices[indices[t * 3 + 2]].pos;
+                    Float3 ab = { b.x - a.x, b.y - a.y, b.z - a.z };
+                    Float3 ac = { c.x - a.x, c.y - a.y, c.z - a.z };
+                    Float3 cross = { ab.y * ac.z - ab.z * ac.y, ab.z * ac.x - ab.x * ac.z, ab.x * ac.y - ab.y * ac.x };
+                    float area = std::sqrt(cross.x * cross.x + cross.y * cross.y + cross.z * cross.z);
+
+                    centroid.x += (a.x + b.x + c.x) / 3.0f * area;
+                    centroid.y += (a.y + b.y + c.y) / 3.0f * area;
+                    centroid.z += (a.z + b.z + c.z) / 3.0f * area;
+                    normal.x += cross.x;
+                    normal.y += cross.y;
+                    normal.z += cross.z;
+                    clusterArea += area;
+                }
+
+                meshCentroid.x += centroid.x;
+                meshCentroid.y += centroid.y;
+                meshCentroid.z += centroid.z;
+                meshArea += clusterArea;
+                if (clusterArea > 0.0f)
+                {
+                    centroid.x /= clusterArea;
+                    centroid.y /= clusterArea;
+                    centroid.z /= clusterArea;
+                }
+            }
+            if (meshArea > 0.0f)
+            {
+                meshCentroid.x /= meshArea;
+                meshCentroid.y /= meshArea;
+                meshCentroid.z /= meshArea;
+            }
+
+            std::vector<float> facing(clusterCount);
+            std::vector<size_t> order(clusterCount);
+            for (size_t cluster = 0; cluster < clusterCount; ++cluster)
+            {
+                const Float3& centroid = clusterCentroid[cluster];
+                const Float3& normal = clusterNormal[cluster];
+                float length = std::sqrt(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+                facing[cluster] = length > 0.0f
+                    ? ((centroid.x - meshCentroid.x) * normal.x + (centroid.y - meshCentroid.y) * normal.y +
+                        (centroid.z - meshCentroid.z) * normal.z) / length
+                    : 0.0f;
+                order[cluster] = cluster;
+            }
+            std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return facing[a] > facing[b]; });
+
+            std::vector<unsigned int> sorted;
+            sorted.reserve(indexCount);
+            for (size_t cluster : order)
+                sorted.insert(sorted.end(), indices + clusterStart[cluster] * 3, indices + clusterStart[cluster + 1] * 3);
+            sorted.insert(sorted.end(), indices + triangleCount * 3, indices + indexCount);
+
+            float cacheOrder = ComputeACMR(indices, indexCount, vertexCount, 16);
+            float overdrawOrder = ComputeACMR(sorted.data(), indexCount, vertexCount, 16);
+            if (overdrawOrder <= cacheOrder * threshold)
+                std::memcpy(indices, sorted.data(), sizeof(unsigned int) * indexCount);
+        }
+
+        struct VertexBitsHash
+        {
+            size_t operator()(const H2B::VERTEX& vertex) const
+            {
+                // FNV-1a over the raw floats
+                const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&vertex);
+                uint64_t hash = 14695981039346656037ull;
+                for (size_t i = 0; i < sizeof(H2B::VERTEX); ++i)
+                    hash = (hash ^ bytes[i]) * 1099511628211ull;
+                return static_cast<size_t>(hash);
+            }
+        };
+
+        struct VertexBitsEqual
+        {
+            bool operator()(const H2B::VERTEX& a, const H2B::VERTEX& b) const
+            {
+                return std::memcmp(&a, &b, sizeof(H2B::VERTEX)) == 0;
+            }
+        };
+
+        size_t MeshBytes(size_t vertexCount, size_t indexCount, size_t indexSize)
+        {
+            return vertexCount * sizeof(H2B::VERTEX) + indexCount * indexSize;
+        }
+    }
+
+    float ComputeACMR(const std::vector<unsigned int>& indices, unsigned int vertexCount, unsigned int cacheSize)
+    {
+        return ComputeACMR(indices.data(), indices.size(), vertexCount, cacheSize);
+    }
+
+    MeshOptimizeStats OptimizeMesh(std::vector<H2B::VERTEX>& vertices, std::vector<unsigned int>& indices,
+        const std::vector<H2B::MESH>& meshes)
+    {
+        MeshOptimizeStats stats;
+        stats.verticesBefore = static_cast<unsigned int>(vertices.size());
+        stats.acmrBefore = ComputeACMR(indices, stats.verticesBefore);
+        stats.bytesBefore = MeshBytes(vertices.size(), indices.size(), sizeof(unsigned int));
+
+        // nothing to gain, and an index past the end means a broken file that is better left alone
+        bool valid = !indices.empty() && *std::max_element(indices.begin(), indices.end()) < vertices.size();
+        if (valid)
+        {
+            // bit-identical vertices collapse into the first one, exporters duplicate them at every seam
+            std::unordered_map<H2B::VERTEX, unsigned int, VertexBitsHash, VertexBitsEqual> unique;
+            std::vector<H2B::VERTEX> uniqueVertices;
+            std::vector<unsigned int> remap(vertices.size());
+            for (size_t v = 0; v < vertices.size(); ++v)
+            {
+                auto inserted = unique.emplace(vertices[v], static_cast<unsigned int>(uniqueVertices.size()));
+                if (inserted.second)
+                    uniqueVertices.push_back(vertices[v]);
+                remap[v] = inserted.first->second;
+            }
+            for (unsigned int& index : indices)
+                index = remap[index];
+            vertices.swap(uniqueVertices);
+
+            // each mesh is drawn on its own, so each is reordered on its own; overlapping ranges are left as they are
+            std::vector<H2B::BATCH> ranges;
+            for (const H2B::MESH& mesh : meshes)
+                ranges.push_back(mesh.drawInfo);
+            std::sort(ranges.begin(), ranges.end(), [](const H2B::BATCH& a, const H2B::BATCH& b) {
+                return a.indexOffset < b.indexOffset;
+            });
+            size_t previousEnd = 0;
+            std::vector<unsigned int> reordered;
+            for (const H2B::BATCH& range : ranges)
+            {
+                size_t begin = range.indexOffset;
+                size_t count = range.indexCount - range.indexCount % 3;
+                if (begin < previousEnd || begin + count > indices.size())
+                    continue;
+                previousEnd = begin + range.indexCount;
+
+                reordered.resize(count);
+                ForsythReorder(&indices[begin], count, static_cast<unsigned int>(vertices.size()), reordered.data());
+                OptimizeOverdraw(reordered.data(), count, vertices, 1.05f);
+                std::copy(reordered.begin(), reordered.end(), indices.begin() + begin);
+            }
+
+            // vertices in the order the GPU asks for them, anything nothing references is dropped
+            std::vector<unsigned int> firstUse(vertices.size(), ~0u);
+            std::vector<H2B::VERTEX> fetchOrder;
+            fetchOrder.reserve(vertices.size());
+            for (unsigned int& index : indices)
+            {
+                if (firstUse[index] == ~0u)
+                {
+                    firstUse[index] = static_cast<unsigned int>(fetchOrder.size());
+                    fetchOrder.push_back(vertices[index]);
+                }
+                index = firstUse[index];
+            }
+            vertices.swap(fetchOrder);
+        }
+
+        stats.verticesAfter = static_cast<unsigned int>(vertices.size());
+        stats.acmrAfter = ComputeACMR(indices, stats.verticesAfter);
+        stats.bytesAfter = MeshBytes(vertices.size(), indices.size(), vertices.size() <= 0x10000 ? sizeof(uint16_t) : sizeof(unsigned int));
+        return stats;
+    }
+
+    std::string DescribeMeshOptimize(const MeshOptimizeStats& stats)
+    {
+        char text[160];
+        std::snprintf(text, sizeof(text), "%u -> %u vertices, ACMR %.2f -> %.2f, %.1f KB -> %.1f KB",
+            stats.verticesBefore, stats.verticesAfter, stats.acmrBefore, stats.acmrAfter,
+            stats.bytesBefore / 1024.0, stats.bytesAfter / 1024.0);
+        return text;
+    }
+
+    namespace
+    {
+        // Symmetric 4x4 plane quadric, weighted by area so the error stays a squared distance once divided out
+        struct Quadric
+        {
+            double a00 = 0, a01 = 0, a02 = 0, a03 = 0, a11 = 0, a12 = 0, a13 = 0, a22 = 0, a23 = 0, a33 = 0;
+            double weight = 0;
+
+            void AddPlane(double a, double b, double c, double d, double w)
+            {
+                a00 += w * a * a; a01 += w * a * b; a02 += w * a * c; a03 += w * a * d;
+                a11 += w * b * b; a12 += w * b * c; a13 += w * b * d;
+                a22 += w * c * c; a23 += w * c * d;
+                a33 += w * d * d;
+                weight += w;
+            }
+
+            void Add(const Quadric& q)
+            {
+                a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+                a11 += q.a11; a12 += q.a12; a13 += q.a13;
+                a22 += q.a22; a23 += q.a23;
+                a33 += q.a33;
+                weight += q.weight;
+            }
+
+            double Error(const H2B::VECTOR& p) const
+            {
+                double x = p.x, y = p.y, z = p.z;
+                double error = a00 * x * x + 2 * a01 * x * y + 2 * a02 * x * z + 2 * a03 * x +
+                    a11 * y * y + 2 * a12 * y * z + 2 * a13 * y +
+                    a22 * z * z + 2 * a23 * z + a33;
+                return weight > 0 ? std::fabs(error) / weight : 0.0;
+            }
+        };
+
+        Float3 TriangleCross(const H2B::VECTOR& a, const H2B::VECTOR& b, const H2B::VECTOR& c)
+        {
+            Float3 ab = { b.x - a.x, b.y - a.y, b.z - a.z };
+            Float3 ac = { c.x - a.x, c.y - a.y, c.z - a.z };
+            return { ab.y * ac.z - ab.z * ac.y, ab.z * ac.x - ab.x * ac.z, ab.x * ac.y - ab.y * ac.x };
+        }
+
+        struct Collapse
+        {
+            unsigned int from, to;
+            double cost;
+        };
+
+        uint64_t EdgeKey(unsigned int a, unsigned int b)
+        {
+            return a < b ? (static_cast<uint64_t>(a) << 32) | b : (static_cast<uint64_t>(b) << 32) | a;
+        }
+    }
+
+    std::vector<unsigned int> SimplifyMesh(const std::vector<H2B::VERTEX>& vertices, const unsigned int* indices,
+        size_t indexCount, size_t targetIndexCount, float maxError, float* resultError)
+    {
+        const unsigned int vertexCount = static_cast<unsigned int>(vertices.size());
+        std::vector<unsigned int> triangles(indices, indices + indexCount - indexCount % 3);
+        size_t liveTriangles = triangles.size() / 3;
+        double reachedError = 0.0;
+
+        // vertices at one position form a group, the group is what collapses
+        std::vector<unsigned int> groupOf(vertexCount, ~0u);
+        std::vector<H2B::VECTOR> groupPosition;
+        std::vector<std::vector<unsigned int>> groupWedges;
+        {
+            std::unordered_map<uint64_t, std::vector<unsigned int>> byHash;
+            for (unsigned int index : triangles)
+            {
+                if (groupOf[index] != ~0u)
+                    continue;
+                const H2B::VECTOR& p = vertices[index].pos;
+                uint64_t hash = 14695981039346656037ull;
+                const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&p);
+                for (size_t i = 0; i < sizeof(H2B::VECTOR); ++i)
+                    hash = (hash ^ bytes[i]) * 1099511628211ull;
+
+                std::vector<unsigned int>& candidates = byHash[hash];
+                for (unsigned int group : candidates)
+                {
+                    if (std::memcmp(&groupPosition[group], &p, sizeof(H2B::VECTOR)) == 0)
+                    {
+                        groupOf[index] = group;
+                        break;
+                    }
+                }
+                if (groupOf[index] == ~0u)
+                {
+                    groupOf[index] = static_cast<unsigned int>(groupPosition.size());
+                    candidates.push_back(groupOf[index]);
+                    groupPosition.push_back(p);
+                    groupWedges.emplace_back();
+                }
+                groupWedges[groupOf[index]].push_back(index);
+            }
+        }
+        const size_t groupCount = groupPosition.size();
+
+        // surface planes, plus a plane standing on every open edge so borders keep their outline
+        std::vector<Quadric> quadrics(groupCount);
+        std::unordered_map<uint64_t, unsigned int> edgeUse;
+        for (size_t t = 0; t < liveTriangles; ++t)
+        {
+            unsigned int g[3] = { groupOf[triangles[t * 3]], groupOf[triangles[t * 3 + 1]], groupOf[triangles[t * 3 + 2]] };
+            for (int corner = 0; corner < 3; ++corner)
+                ++edgeUse[EdgeKey(g[corner], g[(corner + 1) % 3])];
+        }
+        std::vector<bool> border(groupCount, false);
+        for (size_t t = 0; t < liveTriangles; ++t)
+        {
+            unsigned int g[3] = { groupOf[triangles[t * 3]], groupOf[triangles[t * 3 + 1]], groupOf[triangles[t * 3 + 2]] };
+            const H2B::VECTOR& a = groupPosition[g[0]];
+            Float3 normal = TriangleCross(a, groupPosition[g[1]], groupPosition[g[2]]);
+            double length = std::sqrt(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+            if (length <= 0.0)
+                continue;
+            double nx = normal.x / length, ny = normal.y / length, nz = normal.z / length;
+            double area = length * 0.5;
+            for (int corner = 0; corner < 3; ++corner)
+                quadrics[g[corner]].AddPlane(nx, ny, nz, -(nx * a.x + ny * a.y + nz * a.z), area);
+
+            for (int corner = 0; corner < 3; ++corner)
+            {
+                unsigned int from = g[corner], to = g[(corner + 1) % 3];
+                if (edgeUse[EdgeKey(from, to)] != 1)
+                    continue;
+                const H2B::VECTOR& p = groupPosition[from];
+                const H2B::VECTOR& q = groupPosition[to];
+                double ex = q.x - p.x, ey = q.y - p.y, ez = q.z - p.z;
+                double bx = ey * nz - ez * ny, by = ez * nx - ex * nz, bz = ex * ny - ey * nx;
+                double bLength = std::sqrt(bx * bx + by * by + bz * bz);
+                if (bLength <= 0.0)
+                    continue;
+                bx /= bLength; by /= bLength; bz /= bLength;
+                double weight = (ex * ex + ey * ey + ez * ez) * 10.0;
+                double d = -(bx * p.x + by * p.y + bz * p.z);
+                quadrics[from].AddPlane(bx, by, bz, d, weight);
+                quadrics[to].AddPlane(bx, by, bz, d, weight);
+                border[from] = border[to] = true;
+            }
+        }
+
+        // border vertices only slide along open edges, anything else could tear the outline
+        auto allowed = [&](unsigned int from, unsigned int to) {
+            if (!border[from])
+                return true;
+            auto use = edgeUse.find(EdgeKey(from, to));
+            return border[to] && use != edgeUse.end() && use->second == 1;
+        };
+
+        const double maxErrorSquared = static_cast<double>(maxError) * maxError;
+        const size_t targetTriangles = targetIndexCount / 3;
+        std::vector<bool> live(liveTriangles, true);
+        std::vector<unsigned int> groupTriangles, groupTriangleStart(groupCount + 1);
+        std::vector<bool> touched(groupCount);
+        std::vector<Collapse> collapses;
+        bool errorLimited = false;
+        while (liveTriangles > targetTriangles && !errorLimited)
+        {
+            // triangles around each group, rebuilt every pass
+            std::fill(groupTriangleStart.begin(), groupTriangleStart.end(), 0);
+            for (size_t t = 0; t < live.size(); ++t)
+            {
+                if (live[t])
+                {
+                    for (int corner = 0; corner < 3; ++corner)
+                        ++groupTriangleStart[groupOf[triangles[t * 3 + corner]] + 1];
+                }
+            }
+            for (size_t g = 0; g < groupCount; ++g)
+                groupTriangleStart[g + 1] += groupTriangleStart[g];
+            groupTriangles.resize(groupTriangleStart[groupCount]);
+            std::vector<unsigned int> fill(groupTriangleStart.begin(), groupTriangleStart.end() - 1);
+            for (size_t t = 0; t < live.size(); ++t)
+            {
+                if (live[t])
+                {
+                    for (int corner = 0; corner < 3; ++corner)
+                        groupTriangles[fill[groupOf[triangles[t * 3 + corner]]]++] = static_cast<unsigned int>(t);
+                }
+            }
+
+            // the cheaper direction of every edge
+            collapses.clear();
+            for (size_t t = 0; t < live.size(); ++t)
+            {
+                if (!live[t])
+                    continue;
+                for (int corner = 0; corner < 3; ++corner)
+                {
+                    unsigned int a = groupOf[triangles[t * 3 + corner]];
+                    unsigned int b = groupOf[triangles[t * 3 + (corner + 1) % 3]];
+                    if (a > b)
+                        continue; // each edge once, an edge with one triangle is still seen from that side
+                    Quadric combined = quadrics[a];
+                    combined.Add(quadrics[b]);
+                    double toB = allowed(a, b) ? combined.Error(groupPosition[b]) : -1.0;
+                    double toA = allowed(b, a) ? combined.Error(groupPosition[a]) : -1.0;
+                    if (toB >= 0.0 && (toA < 0.0 || toB <= toA))
+                        collapses.push_back({ a, b, toB });
+                    else if (toA >= 0.0)
+                        collapses.push_back({ b, a, toA });
+                }
+            }
+            std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) { return x.cost < y.cost; });
+
+            std::fill(touched.begin(), touched.end(), false);
+            size_t collapsed = 0;
+            for (const Collapse& collapse : collapses)
+            {
+                if (liveTriangles <= targetTriangles)
+                    break;
+                if (collapse.cost > maxErrorSquared)
+                {
+                    errorLimited = true;
+                    break;
+                }
+                if (touched[collapse.from] || touched[collapse.to])
+                    continue;
+
+                // no surviving triangle may turn over
+                bool flips = false;
+                for (unsigned int i = groupTriangleStart[collapse.from]; i < groupTriangleStart[collapse.from + 1] && !flips; ++i)
+                {
+                    unsigned int t = groupTriangles[i];
+                    const H2B::VECTOR* p[3];
+                    bool degenerate = false;
+                    for (int corner = 0; corner < 3; ++corner)
+                    {
+                        unsigned int g = groupOf[triangles[t * 3 + corner]];
+                        degenerate |= g == collapse.to;
+                        p[corner] = &groupPosition[g];
+                    }
+                    if (degenerate)
+                        continue;
+                    Float3 before = TriangleCross(*p[0], *p[1], *p[2]);
+                    for (int corner = 0; corner < 3; ++corner)
+                    {
+                        if (groupOf[triangles[t * 3 + corner]] == collapse.from)
+                            p[corner] = &groupPosition[collapse.to];
+                    }
+                    Float3 after = TriangleCross(*p[0], *p[1], *p[2]);
+                    flips = before.x * after.x + before.y * after.y + before.z * after.z <= 0.0f;
+                }
+                if (flips)
+                    continue;
+
+                // each wedge moves to the target's wedge with the closest uv and normal
+                for (unsigned int i = groupTriangleStart[collapse.from]; i < groupTriangleStart[collapse.from + 1]; ++i)
+                {
+                    unsigned int t = groupTriangles[i];
+                    for (int corner = 0; corner < 3; ++corner)
+                    {
+                        unsigned int& index = triangles[t * 3 + corner];
+                        touched[groupOf[index]] = true;
+                        if (groupOf[index] != collapse.from)
+                            continue;
+                        const H2B::VERTEX& wedge = vertices[index];
+                        unsigned int best = groupWedges[collapse.to].front();
+                        float bestDistance = -1.0f;
+                        for (unsigned int candidate : groupWedges[collapse.to])
+                        {
+                            const H2B::VERTEX& v = vertices[candidate];
+                            float du = v.uvw.x - wedge.uvw.x, dv = v.uvw.y - wedge.uvw.y;
+                            float dx = v.nrm.x - wedge.nrm.x, dy = v.nrm.y - wedge.nrm.y, dz = v.nrm.z - wedge.nrm.z;
+                            float distance = du * du + dv * dv + dx * dx + dy * dy + dz * dz;
+                            if (bestDistance < 0.0f || distance < bestDistance)
+                            {
+                                bestDistance = distance;
+                                best = candidate;
+                            }
+                        }
+                        index = best;
+                    }
+                    unsigned int g0 = groupOf[triangles[t * 3]], g1 = groupOf[triangles[t * 3 + 1]], g2 = groupOf[triangles[t * 3 + 2]];
+                    if (live[t] && (g0 == g1 || g1 == g2 || g0 == g2))
+                    {
+                        live[t] = false;
+                        --liveTriangles;
+                    }
+                }
+                for (unsigned int i = groupTriangleStart[collapse.to]; i < groupTriangleStart[collapse.to + 1]; ++i)
+                {
+                    unsigned int t = groupTriangles[i];
+                    for (int corner = 0; corner < 3; ++corner)
+                        touched[groupOf[triangles[t * 3 + corner]]] = true;
+                }
+                quadrics[collapse.to].Add(quadrics[collapse.from]);
+                reachedError = (std::max)(reachedError, collapse.cost);
+                ++collapsed;
+            }
+            if (collapsed == 0)
+                break;
+        }
+
+        std::vector<unsigned int> result;
+        result.reserve(liveTriangles * 3);
+        for (size_t t = 0; t < live.size(); ++t)
+        {
+            if (live[t])
+                result.insert(result.end(), &triangles[t * 3], &triangles[t * 3] + 3);
+        }
+        if (resultError)
+            *resultError = static_cast<float>(std::sqrt(reachedError));
+        return result;
+    }
+
+    std::vector<MeshLODs> BuildMeshLODs(const std::vector<H2B::VERTEX>& vertices, std::vector<unsigned int>& indices,
+        const std::vector<H2B::MESH>& meshes)
+    {
+        // how far a level may stray, as a fraction of the model's size, and how many triangles it aims for
+        const float errorFraction[MeshLODs::maxLevels] = { 0.0f, 0.01f, 0.03f, 0.08f };
+        const float triangleFraction[MeshLODs::maxLevels] = { 1.0f, 0.5f, 0.25f, 0.125f };
+
+        H2B::VECTOR low = { 0, 0, 0 }, high = { 0, 0, 0 };
+        for (size_t v = 0; v < vertices.size(); ++v)
+        {
+            const H2B::VECTOR& p = vertices[v].pos;
+            low = v == 0 ? p : H2B::VECTOR{ (std::min)(low.x, p.x), (std::min)(low.y, p.y), (std::min)(low.z, p.z) };
+            high = v == 0 ? p : H2B::VECTOR{ (std::max)(high.x, p.x), (std::max)(high.y, p.y), (std::max)(high.z, p.z) };
+        }
+        float size = std::sqrt((high.x - low.x) * (high.x - low.x) + (high.y - low.y) * (high.y - low.y) + (high.z - low.z) * (high.z - low.z));
+
+        std::vector<MeshLODs> lods(meshes.size());
+        for (size_t m = 0; m < meshes.size(); ++m)
+        {
+            const H2B::BATCH& full = meshes[m].drawInfo;
+            lods[m].levels[0] = full;
+            if (static_cast<size_t>(full.indexOffset) + full.indexCount > indices.size())
+                continue;
+
+            for (unsigned int level = 1; level < MeshLODs::maxLevels; ++level)
+            {
+                // always simplified from the full mesh, errors do not stack up level on level
+                size_t target = static_cast<size_t>(full.indexCount * triangleFraction[level]) / 3 * 3;
+                float error = 0.0f;
+                std::vector<unsigned int> simplified = SimplifyMesh(vertices, &indices[full.indexOffset], full.indexCount,
+                    target, size * errorFraction[level], &error);
+
+                // not worth a draw of its own unless it drops a fifth of the previous level
+                const H2B::BATCH& previous = lods[m].levels[lods[m].count - 1];
+                if (simplified.empty() || simplified.size() > previous.indexCount * 4 / 5)
+                    break;
+
+                std::vector<unsigned int> reordered(simplified.size());
+                ForsythReorder(simplified.data(), simplified.size(), static_cast<unsigned int>(vertices.size()), reordered.data());
+                lods[m].levels[lods[m].count] = { static_cast<unsigned int>(reordered.size()), static_cast<unsigned int>(indices.size()) };
+                lods[m].error[lods[m].count] = error;
+                ++lods[m].count;
+                indices.insert(indices.end(), reordered.begin(), reordered.end());
+            }
+        }
+        return lods;
+    }
+}
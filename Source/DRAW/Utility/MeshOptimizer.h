@@ -0,0 +1,48 @@
+#pragma once
+#include "h2bParser.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace DRAW
+{
+    // Before and after numbers of one model, logged by the level loader
+    struct MeshOptimizeStats
+    {
+        unsigned int verticesBefore = 0, verticesAfter = 0;
+        float acmrBefore = 0.0f, acmrAfter = 0.0f; // post-transform cache misses per triangle, 16 entry FIFO
+        size_t bytesBefore = 0, bytesAfter = 0;    // vertices plus indices, 16-bit indices once they fit
+    };
+
+    // Average cache miss ratio of a triangle list: 3 is no reuse at all, ~0.5 is about the best a grid gets
+    float ComputeACMR(const std::vector<unsigned int>& indices, unsigned int vertexCount, unsigned int cacheSize = 16);
+
+    // Import-time pass over one model. Merges bit-identical vertices, reorders each mesh's triangles for the
+    // vertex cache (Forsyth) and then for overdraw, and renumbers the vertices in the order they are first used.
+    // Triangles never leave their mesh's index range, so every drawInfo stays valid.
+    MeshOptimizeStats OptimizeMesh(std::vector<H2B::VERTEX>& vertices, std::vector<unsigned int>& indices,
+        const std::vector<H2B::MESH>& meshes);
+
+    std::string DescribeMeshOptimize(const MeshOptimizeStats& stats);
+
+    // Simplified copies of one mesh, levels[0] is the mesh's own drawInfo. Offsets are relative to the model's
+    // indexStart like every H2B::BATCH, error is how far (model space) a level strays from the full mesh.
+    struct MeshLODs
+    {
+        static constexpr unsigned int maxLevels = 4;
+        H2B::BATCH levels[maxLevels] = {};
+        float error[maxLevels] = {};
+        unsigned int count = 1;
+    };
+
+    // Quadric error simplification (Garland & Heckbert) of an index range. Edges collapse onto existing vertices,
+    // so every level shares the model's vertex buffer; vertices split only by uv or normal collapse together.
+    // Stops at targetIndexCount or before a collapse would move the surface further than maxError.
+    std::vector<unsigned int> SimplifyMesh(const std::vector<H2B::VERTEX>& vertices, const unsigned int* indices,
+        size_t indexCount, size_t targetIndexCount, float maxError, float* resultError);
+
+    // Builds the levels of every mesh and appends their indices (cache optimized) to the model's indices.
+    // One entry per mesh, in the order of meshes.
+    std::vector<MeshLODs> BuildMeshLODs(const std::vector<H2B::VERTEX>& vertices, std::vector<unsigned int>& indices,
+        const std::vector<H2B::MESH>& meshes);
+}
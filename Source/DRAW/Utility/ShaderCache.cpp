@@ -0,0 +1,228 @@
+#include "ShaderCache.h"
+#include "FontLoader.h"
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "shaderc/shaderc.h" // needed for compiling shaders at runtime
+#ifdef _WIN32 // must use MT platform DLL libraries on windows
+#pragma comment(lib, "shaderc_combined.lib")
+#endif
+
+namespace DRAW
+{
+    // bump when the compile options change, every cached shader is rebuilt
+    static const uint64_t shaderCacheVersion = 1;
+
+#ifndef NDEBUG
+    static const bool shaderDebugInfo = true;
+#else
+    static const bool shaderDebugInfo = false;
+#endif
+
+    struct ShaderCompiler::State
+    {
+        shaderc_compiler_t compiler = nullptr;
+        shaderc_compile_options_t options = nullptr;
+    };
+
+    ShaderCompiler::ShaderCompiler() = default;
+
+    ShaderCompiler::~ShaderCompiler()
+    {
+        if (state) {
+            shaderc_compile_options_release(state->options);
+            shaderc_compiler_release(state->compiler);
+        }
+    }
+
+    bool ShaderCompiler::Compile(const ShaderSource& source, const std::string& hlsl, std::vector<char>& spirv)
+    {
+        if (!state) {
+            // Intialize runtime shader compiler HLSL -> SPIRV
+            state = std::make_unique<State>();
+            state->compiler = shaderc_compiler_initialize();
+            state->options = shaderc_compile_options_initialize();
+            shaderc_compile_options_set_source_language(state->options, shaderc_source_language_hlsl);
+            shaderc_compile_options_set_invert_y(state->options, false);
+            if (shaderDebugInfo) {
+                shaderc_compile_options_set_generate_debug_info(state->options);
+            }
+        }
+
+        // variants get their own copy of the options, a macro added to the shared ones would stick
+        shaderc_compile_options_t options = state->options;
+        if (!source.define.empty()) {
+            options = shaderc_compile_options_clone(state->options);
+            shaderc_compile_options_add_macro_definition(options, source.define.c_str(), source.define.size(), "1", 1);
+        }
+
+        std::string fileName = std::filesystem::path(source.path).filename().string();
+        shaderc_compilation_result_t result = shaderc_compile_into_spv(
+            state->compiler, hlsl.c_str(), hlsl.length(),
+            source.stage == ShaderStage::Vertex ? shaderc_vertex_shader : shaderc_fragment_shader,
+            fileName.c_str(), "main", options);
+        if (options != state->options) {
+            shaderc_compile_options_release(options);
+        }
+
+        bool compiled = shaderc_result_get_compilation_status(result) == shaderc_compilation_status_success;
+        if (compiled) {
+            const char* bytes = shaderc_result_get_bytes(result);
+            spirv.assign(bytes, bytes + shaderc_result_get_length(result));
+        }
+        else {
+            std::cout << fileName << " Errors : \n" << shaderc_result_get_error_message(result) << std::endl;
+        }
+
+        shaderc_result_release(result);
+        return compiled;
+    }
+
+    std::vector<ShaderSource> RendererShaderSources(const std::string& vertexShader, const std::string& pixelShader,
+        bool packedVertices)
+    {
+        return {
+            { vertexShader, ShaderStage::Vertex, packedVertices ? "PACKED_VERTEX" : "" },
+            { pixelShader, ShaderStage::Fragment },
+            { ResolveAssetPath("Shaders/TextVertexShader.hlsl"), ShaderStage::Vertex },
+            { ResolveAssetPath("Shaders/TextPixel.hlsl"), ShaderStage::Fragment },
+        };
+    }
+
+    // FNV-1a over the source and everything else that changes the SPIR-V
+    static uint64_t HashShader(const ShaderSource& source, const std::string& hlsl)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        auto mix = [&hash](const void* data, size_t size) {
+            const unsigned char* bytes = static_cast<const unsigned char*>(data);
+            for (size_t i = 0; i < size; ++i) {
+                hash = (hash ^ bytes[i]) * 1099511628211ull;
+            }
+        };
+
+        unsigned char settings[3] = { static_cast<unsigned char>(shaderCacheVersion),
+            static_cast<unsigned char>(source.stage), static_cast<unsigned char>(shaderDebugInfo) };
+        mix(settings, sizeof(settings));
+        mix(source.define.data(), source.define.size());
+        mix(hlsl.data(), hlsl.size());
+        return hash;
+    }
+
+    static bool ReadWholeFile(const std::filesystem::path& path, std::string& contents)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            return false;
+        }
+        std::ostringstream stream;
+        stream << file.rdbuf();
+        contents = stream.str();
+        return true;
+    }
+
+    // Debug and Release builds compile differently, each keeps its own file so switching never recompiles.
+    // Release's is the plain .spv, the one that ships.
+    static std::filesystem::path CachePath(const ShaderSource& source)
+    {
+        std::string extension = source.define.empty() ? "" : "." + source.define;
+        extension += shaderDebugInfo ? ".debug.spv" : ".spv";
+        return std::filesystem::path(source.path).replace_extension(extension);
+    }
+
+    // Written to a temporary file first, a crash mid-write never leaves a truncated .spv behind
+    static void WriteCache(const ShaderSource& source, uint64_t hash, const std::vector<char>& spirv)
+    {
+        std::filesystem::path spvPath = CachePath(source);
+        std::filesystem::path hashPath = spvPath.string() + ".hash";
+        std::filesystem::path tempPath = spvPath.string() + ".tmp";
+
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            if (!file.write(spirv.data(), spirv.size())) {
+                std::cout << "Shader cache: could not write " << tempPath.string() << std::endl;
+                return;
+            }
+        }
+
+        std::error_code error;
+        std::filesystem::rename(tempPath, spvPath, error);
+        if (error) {
+            std::cout << "Shader cache: could not replace " << spvPath.string() << std::endl;
+            return;
+        }
+        std::ofstream(hashPath, std::ios::trunc) << std::hex << hash;
+    }
+
+    std::vector<char> LoadShaderSPIRV(ShaderCompiler& compiler, const ShaderSource& source)
+    {
+        std::filesystem::path spvPath = CachePath(source);
+        std::string cached;
+
+        std::string hlsl;
+        if (!ReadWholeFile(source.path, hlsl)) {
+            // a release build may ship only the SPIR-V
+            if (ReadWholeFile(spvPath, cached) && !cached.empty()) {
+                return std::vector<char>(cached.begin(), cached.end());
+            }
+            std::cout << "ERROR: File \"" << source.path << "\" Not Found!" << std::endl;
+            return {};
+        }
+
+        uint64_t hash = HashShader(source, hlsl);
+        std::string cachedHash;
+        if (ReadWholeFile(spvPath.string() + ".hash", cachedHash)) {
+            std::istringstream hashStream(cachedHash);
+            uint64_t recorded = 0;
+            if (hashStream >> std::hex >> recorded && recorded == hash &&
+                ReadWholeFile(spvPath, cached) && !cached.empty()) {
+                return std::vector<char>(cached.begin(), cached.end());
+            }
+        }
+
+        // development fallback, the HLSL changed since the cache was built
+        std::vector<char> spirv;
+        if (!compiler.Compile(source, hlsl, spirv)) {
+            return {};
+        }
+        WriteCache(source, hash, spirv);
+        return spirv;
+    }
+
+    bool ShaderBuildRequested(int argc, char** argv)
+    {
+        for (int i = 1; i < argc; ++i) {
+            if (std::string(argv[i]) == "--build-shaders") {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    int BuildShaderCache(const std::vector<ShaderSource>& sources)
+    {
+        ShaderCompiler compiler;
+        int failed = 0;
+        for (const ShaderSource& source : sources) {
+            std::string hlsl;
+            std::vector<char> spirv;
+            if (!ReadWholeFile(source.path, hlsl)) {
+                std::cout << "ERROR: File \"" << source.path << "\" Not Found!" << std::endl;
+                ++failed;
+                continue;
+            }
+            if (!compiler.Compile(source, hlsl, spirv)) {
+                ++failed;
+                continue;
+            }
+
+            WriteCache(source, HashShader(source, hlsl), spirv);
+            std::cout << CachePath(source).string() << " (" << spirv.size() << " bytes)" << std::endl;
+        }
+
+        std::cout << sources.size() - failed << " of " << sources.size() << " shaders built" << std::endl;
+        return failed == 0 ? 0 : -1;
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace DRAW
+{
+    enum class ShaderStage
+    {
+        Vertex,
+        Fragment
+    };
+
+    struct ShaderSource
+    {
+        std::string path; // the HLSL, its SPIR-V is cached next to it as .spv + .spv.hash (.debug.spv in Debug builds)
+        ShaderStage stage;
+        std::string define; // compiled with this macro defined, cached as <name>.<define>.spv
+    };
+
+    // Runtime HLSL -> SPIR-V fallback. shaderc is only initialized on the first cache miss.
+    class ShaderCompiler
+    {
+    public:
+        ShaderCompiler();
+        ~ShaderCompiler();
+        ShaderCompiler(const ShaderCompiler&) = delete;
+        ShaderCompiler& operator=(const ShaderCompiler&) = delete;
+
+        // Prints the errors and returns false when the source does not compile
+        bool Compile(const ShaderSource& source, const std::string& hlsl, std::vector<char>& spirv);
+
+    private:
+        struct State;
+        std::unique_ptr<State> state;
+    };
+
+    // Every shader the renderer loads, in the order Construct_VulkanRenderer creates them.
+    // Levels with packed vertices get the scene vertex shader compiled with PACKED_VERTEX.
+    std::vector<ShaderSource> RendererShaderSources(const std::string& vertexShader, const std::string& pixelShader,
+        bool packedVertices = false);
+
+    // Returns the cached SPIR-V when its hash matches the HLSL (or when only the .spv was shipped),
+    // otherwise compiles it and refreshes the cache. Empty on failure.
+    std::vector<char> LoadShaderSPIRV(ShaderCompiler& compiler, const ShaderSource& source);
+
+    // --build-shaders: compiles every source into the cache up front, so a cold start never needs shaderc
+    bool ShaderBuildRequested(int argc, char** argv);
+    int BuildShaderCache(const std::vector<ShaderSource>& sources);
+}
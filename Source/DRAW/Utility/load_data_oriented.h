@@ -8,6 +8,8 @@
 
 // This reads .h2b files which are optimized binary .obj+.mtl files
 #include "h2bParser.h"
+// Dedup, vertex cache and overdraw ordering applied to every model as it is imported
+#include "MeshOptimizer.h"
 
 // * NOTE: *
 // Unlike the OOP version, this class was not designed to be a dynamic/evolving data structure.
@@ -69,6 +71,8 @@ public:
 	// All required drawing information combined
 	std::vector<H2B::BATCH> levelBatches;
 	std::vector<H2B::MESH> levelMeshes;
+	// *LOD* simplified index ranges of each mesh, parallel to levelMeshes
+	std::vector<DRAW::MeshLODs> levelMeshLods;
 	std::vector<LEVEL_MODEL> levelModels;
 	// what we actually draw once loaded (using GPU instancing)
 	std::vector<MODEL_INSTANCES> levelInstances;
@@ -111,6 +115,7 @@ public:
 		levelTextures.clear();
 		levelBatches.clear();
 		levelMeshes.clear();
+		levelMeshLods.clear();
 		levelModels.clear();
 		levelTransforms.clear();
 		levelInstances.clear();
@@ -263,6 +268,16 @@ private:
 						p.meshes[j].name =
 						level_strings.insert(p.meshes[j].name).first->c_str();
 				}
+				// *OPTIMIZED* fewer vertices, cache friendly triangle order, drawInfo ranges untouched
+				DRAW::MeshOptimizeStats optimized = DRAW::OptimizeMesh(p.vertices, p.indices, p.meshes);
+				p.vertexCount = static_cast<unsigned>(p.vertices.size());
+				log.LogCategorized("INFO", (std::string("H2B Optimized: ") + i->modelFile + " " +
+					DRAW::DescribeMeshOptimize(optimized)).c_str());
+				// *LOD* coarser copies of each mesh, their indices go after the model's own
+				std::vector<DRAW::MeshLODs> lods = DRAW::BuildMeshLODs(p.vertices, p.indices, p.meshes);
+				log.LogCategorized("INFO", (std::string("H2B LODs: ") + i->modelFile + " " +
+					std::to_string(p.indexCount) + " -> " + std::to_string(p.indices.size()) + " indices").c_str());
+				p.indexCount = static_cast<unsigned>(p.indices.size());
 				// record source file name & sizes
 				LEVEL_MODEL model;
 				model.filename = level_strings.insert(i->modelFile).first->c_str();
@@ -284,6 +299,7 @@ private:
 				levelMaterials.insert(levelMaterials.end(), p.materials.begin(), p.materials.end());
 				levelBatches.insert(levelBatches.end(), p.batches.begin(), p.batches.end());
 				levelMeshes.insert(levelMeshes.end(), p.meshes.begin(), p.meshes.end());
+				levelMeshLods.insert(levelMeshLods.end(), lods.begin(), lods.end());
 				// *NEW* add overall collision volume(OBB) for this model and it's submeshes 
 				model.colliderIndex = levelColliders.size();
 				levelColliders.push_back(i->ComputeOBB());
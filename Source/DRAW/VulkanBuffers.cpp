@@ -1,5 +1,7 @@
 #include "DrawComponents.h"
 #include "../CCL.h"
+#include <algorithm>
+#include <cstring>
 namespace DRAW
 {
 	//*** HELPERS ***//
@@ -13,29 +15,76 @@ namespace DRAW
 		sceneData.projectionMatrix = renderer.projMatrix;
 	}
 
+	void RetireBuffer(entt::registry& registry, entt::entity rendererEntity, VkBuffer buffer, const GPUAllocation& memory)
+	{
+		if (buffer == VK_NULL_HANDLE && memory.memory == VK_NULL_HANDLE)
+			return;
+
+		FrameTimeline* timeline = registry.try_get<FrameTimeline>(rendererEntity);
+		if (!timeline)
+		{
+			DestroyAllocatedBuffer(registry, rendererEntity, buffer, memory);
+			return;
+		}
+
+		// the frame being recorded may already have bound it
+		timeline->retired.push_back(RetiredBuffer{ buffer, memory, timeline->currentFrame });
+	}
+
+	void ReleaseRetiredBuffers(VkDevice device, GPUMemoryAllocator* allocator, FrameTimeline& timeline, bool deviceIdle)
+	{
+		size_t kept = 0;
+		for (RetiredBuffer& retired : timeline.retired)
+		{
+			if (deviceIdle || retired.lastUsedFrame <= timeline.completedFrame)
+			{
+				vkDestroyBuffer(device, retired.buffer, nullptr);
+				if (allocator)
+					FreeGPUAllocation(*allocator, retired.memory);
+			}
+			else
+			{
+				timeline.retired[kept++] = retired;
+			}
+		}
+		timeline.retired.resize(kept);
+	}
+
+	// Creates a device-local buffer and queues its contents on the transfer queue, returns the upload id
+	static unsigned long long UploadDeviceLocal(entt::registry& registry, entt::entity entity, VkBufferUsageFlags usage,
+		const void* data, VkDeviceSize size, VkBuffer* buffer, GPUAllocation* memory)
+	{
+		// level geometry is all released together on reload, bump allocate it
+		CreateAllocatedBuffer(registry, entity, size, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, memory, GPUMemoryPool::Level);
+		return QueueBufferUpload(registry, entity, *buffer, 0, data, size);
+	}
+
 	//*** SYSTEMS ***//
 	// Forward Declare
 	void Destroy_VulkanVertexBuffer(entt::registry& registry, entt::entity entity);
 
 	void Update_VulkanVertexBuffer(entt::registry& registry, entt::entity entity) {
 		auto& vertex_buffer = registry.get<VulkanVertexBuffer>(entity);
-		// upload the buffer to the GPU
-		if (registry.all_of<VulkanRenderer, std::vector<H2B::VERTEX>>(entity)) {
+		// upload the buffer to the GPU, in whichever format the level picked
+		if (registry.all_of<VulkanRenderer>(entity) && registry.any_of<std::vector<H2B::VERTEX>, std::vector<PackedVertex>>(entity)) {
 			// if there is already a vertex buffer attached, lets delete it
 			if (vertex_buffer.buffer != VK_NULL_HANDLE)
 				Destroy_VulkanVertexBuffer(registry, entity);
 			// if there is a cpu buffer attached, lets upload it to the GPU then delete it
-			auto& vkRenderer = registry.get<VulkanRenderer>(entity);
-			auto& vertex_data = registry.get<std::vector<H2B::VERTEX>>(entity);
-			// Transfer triangle data to the vertex buffer. (staging would be preferred here)
-			GvkHelper::create_buffer(vkRenderer.physicalDevice, vkRenderer.device, sizeof(H2B::VERTEX) * vertex_data.size(),
-				VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-				VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &vertex_buffer.buffer, &vertex_buffer.memory);
-			GvkHelper::write_to_buffer(vkRenderer.device, vertex_buffer.memory,
-				vertex_data.data(), sizeof(H2B::VERTEX) * vertex_data.size());
-			// remove the Vertex Data
-			vkDeviceWaitIdle(vkRenderer.device);
-			registry.remove<std::vector<H2B::VERTEX>>(entity);
+			// Stream triangle data into device-local memory through the staging ring
+			if (auto* packed_data = registry.try_get<std::vector<PackedVertex>>(entity)) {
+				vertex_buffer.uploadId = UploadDeviceLocal(registry, entity, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+					packed_data->data(), sizeof(PackedVertex) * packed_data->size(), &vertex_buffer.buffer, &vertex_buffer.memory);
+				// remove the Vertex Data, the transfer queue keeps its own copy
+				registry.remove<std::vector<PackedVertex>>(entity);
+			}
+			else {
+				auto& vertex_data = registry.get<std::vector<H2B::VERTEX>>(entity);
+				vertex_buffer.uploadId = UploadDeviceLocal(registry, entity, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+					vertex_data.data(), sizeof(H2B::VERTEX) * vertex_data.size(), &vertex_buffer.buffer, &vertex_buffer.memory);
+				registry.remove<std::vector<H2B::VERTEX>>(entity);
+			}
 		}
 	}
 
@@ -43,12 +92,12 @@ namespace DRAW
 		// check if the buffer is allocated, if so, release it
 		if (registry.all_of<VulkanVertexBuffer, VulkanRenderer>(entity)) {
 
-			auto& vkRenderer = registry.get<VulkanRenderer>(entity);
 			auto& vertex_buffer = registry.get<VulkanVertexBuffer>(entity);
-			vkDeviceWaitIdle(vkRenderer.device);
-			// Release allocated buffers, shaders & pipeline
-			vkDestroyBuffer(vkRenderer.device, vertex_buffer.buffer, nullptr);
-			vkFreeMemory(vkRenderer.device, vertex_buffer.memory, nullptr);
+			// frames in flight may still draw from it, release once they are done
+			CancelBufferUploads(registry, entity, vertex_buffer.buffer);
+			RetireBuffer(registry, entity, vertex_buffer.buffer, vertex_buffer.memory);
+			vertex_buffer.buffer = VK_NULL_HANDLE;
+			vertex_buffer.memory = GPUAllocation{};
 		}
 
 	}
@@ -64,17 +113,23 @@ namespace DRAW
 			if (index_buffer.buffer != VK_NULL_HANDLE)
 				Destroy_VulkanIndexBuffer(registry, entity);
 			// if there is index data attached, lets upload it to the GPU then delete it
-			auto& vkRenderer = registry.get<VulkanRenderer>(entity);
 			auto& index_data = registry.get<std::vector<unsigned int>>(entity);
 
-			// Transfer triangle data to the vertex buffer. (staging would be preferred here)
-			GvkHelper::create_buffer(vkRenderer.physicalDevice, vkRenderer.device, sizeof(unsigned int) * index_data.size(),
-				VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-				VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &index_buffer.buffer, &index_buffer.memory);
-			GvkHelper::write_to_buffer(vkRenderer.device, index_buffer.memory,
-				index_data.data(), sizeof(unsigned int) * index_data.size());
+			// indices are relative to each model's vertexStart, so they fit in 16 bits unless a model is huge
+			unsigned int largestIndex = index_data.empty() ? 0 : *std::max_element(index_data.begin(), index_data.end());
+			if (largestIndex <= 0xFFFF) {
+				std::vector<uint16_t> short_data(index_data.begin(), index_data.end());
+				index_buffer.indexType = VK_INDEX_TYPE_UINT16;
+				// Stream index data into device-local memory through the staging ring
+				index_buffer.uploadId = UploadDeviceLocal(registry, entity, VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+					short_data.data(), sizeof(uint16_t) * short_data.size(), &index_buffer.buffer, &index_buffer.memory);
+			}
+			else {
+				index_buffer.indexType = VK_INDEX_TYPE_UINT32;
+				index_buffer.uploadId = UploadDeviceLocal(registry, entity, VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+					index_data.data(), sizeof(unsigned int) * index_data.size(), &index_buffer.buffer, &index_buffer.memory);
+			}
 			// remove the index data
-			vkDeviceWaitIdle(vkRenderer.device);
 			registry.remove<std::vector<unsigned int>>(entity);
 		}
 	}
@@ -83,100 +138,343 @@ namespace DRAW
 		// check if the buffer is allocated, if so, release it
 		if (registry.all_of<VulkanIndexBuffer, VulkanRenderer>(entity)) {
 
-			auto& vkRenderer = registry.get<VulkanRenderer>(entity);
 			auto& index_buffer = registry.get<VulkanIndexBuffer>(entity);
 
-			vkDeviceWaitIdle(vkRenderer.device);
-			// Release allocated buffers, shaders & pipeline
-			vkDestroyBuffer(vkRenderer.device, index_buffer.buffer, nullptr);
-			vkFreeMemory(vkRenderer.device, index_buffer.memory, nullptr);
+			CancelBufferUploads(registry, entity, index_buffer.buffer);
+			RetireBuffer(registry, entity, index_buffer.buffer, index_buffer.memory);
+			index_buffer.buffer = VK_NULL_HANDLE;
+			index_buffer.memory = GPUAllocation{};
 		}
 	}
 
+	// (Re)creates one frame's instance buffer, maps it for good and points that frame's descriptor set at it
+	static void CreateInstanceBufferForFrame(entt::registry& registry, entt::entity entity, VulkanGPUInstanceBuffer& gpuBuffer, unsigned int frame, unsigned long long elementCount)
+	{
+		auto& renderer = registry.get<VulkanRenderer>(entity);
+		CreateAllocatedBuffer(registry, entity, sizeof(GPUInstanceData) * elementCount,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+			VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &gpuBuffer.buffer[frame], &gpuBuffer.memory[frame]);
+
+		// coherent memory stays mapped for the life of the buffer, no map/unmap per frame
+		gpuBuffer.mapped[frame] = reinterpret_cast<GPUInstanceData*>(gpuBuffer.memory[frame].mapped);
+		gpuBuffer.capacity[frame] = elementCount;
+
+		if (frame < renderer.descriptorSets.size())
+		{
+			VkDescriptorBufferInfo storageBufferInfo = { gpuBuffer.buffer[frame], 0, VK_WHOLE_SIZE };
+			VkWriteDescriptorSet storageWrite = {};
+			storageWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			storageWrite.dstSet = renderer.descriptorSets[frame];
+			storageWrite.dstBinding = 1; // 1 For the storage buffer
+			storageWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			storageWrite.descriptorCount = 1;
+			storageWrite.pBufferInfo = &storageBufferInfo;
+
+			vkUpdateDescriptorSets(renderer.device, 1, &storageWrite, 0, nullptr);
+		}
+	}
+
+	static void DestroyInstanceBufferForFrame(entt::registry& registry, entt::entity entity, VulkanGPUInstanceBuffer& gpuBuffer, unsigned int frame)
+	{
+		if (gpuBuffer.buffer[frame] == VK_NULL_HANDLE)
+			return;
+
+		DestroyAllocatedBuffer(registry, entity, gpuBuffer.buffer[frame], gpuBuffer.memory[frame]);
+		gpuBuffer.buffer[frame] = VK_NULL_HANDLE;
+		gpuBuffer.memory[frame] = GPUAllocation{};
+		gpuBuffer.mapped[frame] = nullptr;
+		gpuBuffer.capacity[frame] = 0;
+	}
+
 	void Construct_VulkanGPUInstanceBuffer(entt::registry& registry, entt::entity entity) {
 		auto& bufferComponent = registry.get<VulkanGPUInstanceBuffer>(entity);
 		auto& renderer = registry.get<VulkanRenderer>(entity);
 
-		unsigned int frameCount;
-		renderer.vlkSurface.GetSwapchainImageCount(frameCount);
+		unsigned int frameCount = renderer.frameCount;
 		bufferComponent.memory.resize(frameCount);
-		bufferComponent.buffer.resize(frameCount);
+		bufferComponent.buffer.resize(frameCount, VK_NULL_HANDLE);
+		bufferComponent.mapped.resize(frameCount, nullptr);
+		bufferComponent.capacity.resize(frameCount, 0);
 
 		for (unsigned int i = 0; i < frameCount; i++)
 		{
-			GvkHelper::create_buffer(renderer.physicalDevice, renderer.device, sizeof(GPUInstance)*bufferComponent.element_count,
-				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-				VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &bufferComponent.buffer[i], &bufferComponent.memory[i]);
+			CreateInstanceBufferForFrame(registry, entity, bufferComponent, i, bufferComponent.element_count);
 		}
 		
 	}
-		
-	// Forward declare
-	void Destroy_VulkanGPUInstanceBuffer(entt::registry& registry, entt::entity entity);
 
+	// Makes sure the current frame's buffer can hold required_count instances.
+	// Only this frame's buffer is regrown, the other frames may still be in flight and keep theirs
+	// until their own turn comes around, so this never has to wait on the device.
 	void Update_VulkanGPUInstanceBuffer(entt::registry& registry, entt::entity entity) {
-		if (!registry.all_of<std::vector<GPUInstance>>(entity))
-			return; // No Instances, so nothing to write. Bail
-
-		auto& gpuBuffer = registry.get<VulkanGPUInstanceBuffer>(entity);		
-		auto& instances = registry.get<std::vector<GPUInstance>>(entity);
+		auto& gpuBuffer = registry.get<VulkanGPUInstanceBuffer>(entity);
 		auto& renderer = registry.get<VulkanRenderer>(entity);
 
-		// Resize buffer if needed
-		if (instances.size() > gpuBuffer.element_count)
-		{			
-			Destroy_VulkanGPUInstanceBuffer(registry, entity);
+		unsigned int frame = renderer.currentFrame;
 
-			while (instances.size() > gpuBuffer.element_count)
-			{
-				gpuBuffer.element_count *= 2; // Double the storage size if we ran out
-			}
-			
-			for (unsigned int i = 0; i < gpuBuffer.buffer.size(); i++)
-			{
-				GvkHelper::create_buffer(renderer.physicalDevice, renderer.device, sizeof(GPUInstance) * gpuBuffer.element_count,
-					VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-					VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &gpuBuffer.buffer[i], &gpuBuffer.memory[i]);
-
-				VkDescriptorBufferInfo storageBufferInfo = { gpuBuffer.buffer[i], 0, VK_WHOLE_SIZE };
-				VkWriteDescriptorSet storageWrite = {};
-				storageWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-				storageWrite.dstSet = renderer.descriptorSets[i];
-				storageWrite.dstBinding = 1; // 1 For the storage buffer
-				storageWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-				storageWrite.descriptorCount = 1;
-				storageWrite.pBufferInfo = &storageBufferInfo;
-
-				vkUpdateDescriptorSets(renderer.device, 1, &storageWrite, 0, nullptr);
-			}
-		}		
+		if (gpuBuffer.required_count <= gpuBuffer.capacity[frame])
+			return;
 
-		if (instances.size() > 0)
+		unsigned long long newCapacity = (std::max)(gpuBuffer.capacity[frame], 1ull);
+		while (gpuBuffer.required_count > newCapacity)
 		{
-			unsigned int sizeInBytes = sizeof(GPUInstance) * instances.size();
-			unsigned int frame;
-			renderer.vlkSurface.GetSwapchainCurrentImage(frame);
-			vkDeviceWaitIdle(renderer.device);
-			GvkHelper::write_to_buffer(renderer.device, gpuBuffer.memory[frame], instances.data(), sizeInBytes);
+			newCapacity *= 2; // Double the storage size if we ran out
 		}
 
-		vkDeviceWaitIdle(renderer.device);
-		registry.remove<std::vector<GPUInstance>>(entity);
+		DestroyInstanceBufferForFrame(registry, entity, gpuBuffer, frame);
+		CreateInstanceBufferForFrame(registry, entity, gpuBuffer, frame, newCapacity);
 	}
 
 	void Destroy_VulkanGPUInstanceBuffer(entt::registry& registry, entt::entity entity) {
 		auto& gpuBuffer = registry.get<VulkanGPUInstanceBuffer>(entity);
+
+		// every frame's buffer may still be in flight, the mapping goes with the memory
+		for (unsigned int i = 0; i < gpuBuffer.buffer.size(); i++)
+		{
+			RetireBuffer(registry, entity, gpuBuffer.buffer[i], gpuBuffer.memory[i]);
+			gpuBuffer.buffer[i] = VK_NULL_HANDLE;
+			gpuBuffer.memory[i] = GPUAllocation{};
+			gpuBuffer.mapped[i] = nullptr;
+			gpuBuffer.capacity[i] = 0;
+		}
+	}
+
+	void Construct_VulkanIndirectBuffer(entt::registry& registry, entt::entity entity) {
+		auto& indirectBuffer = registry.get<VulkanIndirectBuffer>(entity);
+		auto& renderer = registry.get<VulkanRenderer>(entity);
+
+		// buffers are created by the first patch, once the draw table size is known
+		unsigned int frameCount = renderer.frameCount;
+		indirectBuffer.buffer.resize(frameCount, VK_NULL_HANDLE);
+		indirectBuffer.memory.resize(frameCount);
+		indirectBuffer.mapped.resize(frameCount, nullptr);
+		indirectBuffer.capacity.resize(frameCount, 0);
+	}
+
+	// Grows the current frame's command buffer to required_count, like Update_VulkanGPUInstanceBuffer
+	void Update_VulkanIndirectBuffer(entt::registry& registry, entt::entity entity) {
+		auto& indirectBuffer = registry.get<VulkanIndirectBuffer>(entity);
+		auto& renderer = registry.get<VulkanRenderer>(entity);
+
+		unsigned int frame = renderer.currentFrame;
+
+		if (indirectBuffer.required_count <= indirectBuffer.capacity[frame])
+			return;
+
+		// this image's previous frame is finished, its buffer can go straight away
+		if (indirectBuffer.buffer[frame] != VK_NULL_HANDLE)
+		{
+			DestroyAllocatedBuffer(registry, entity, indirectBuffer.buffer[frame], indirectBuffer.memory[frame]);
+		}
+
+		CreateAllocatedBuffer(registry, entity, sizeof(VkDrawIndexedIndirectCommand) * indirectBuffer.required_count,
+			VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+			VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &indirectBuffer.buffer[frame], &indirectBuffer.memory[frame]);
+		indirectBuffer.mapped[frame] = reinterpret_cast<VkDrawIndexedIndirectCommand*>(indirectBuffer.memory[frame].mapped);
+		indirectBuffer.capacity[frame] = indirectBuffer.required_count;
+	}
+
+	void Destroy_VulkanIndirectBuffer(entt::registry& registry, entt::entity entity) {
+		auto& indirectBuffer = registry.get<VulkanIndirectBuffer>(entity);
+
+		for (unsigned int i = 0; i < indirectBuffer.buffer.size(); i++)
+		{
+			RetireBuffer(registry, entity, indirectBuffer.buffer[i], indirectBuffer.memory[i]);
+			indirectBuffer.buffer[i] = VK_NULL_HANDLE;
+			indirectBuffer.memory[i] = GPUAllocation{};
+			indirectBuffer.mapped[i] = nullptr;
+			indirectBuffer.capacity[i] = 0;
+		}
+	}
+
+	// Uploads the MaterialTable and points every frame's descriptor set (binding 2) at it.
+	// Only runs at level load, before any frame could be using the sets.
+	void Update_VulkanMaterialBuffer(entt::registry& registry, entt::entity entity) {
+		auto& materialBuffer = registry.get<VulkanMaterialBuffer>(entity);
 		auto& renderer = registry.get<VulkanRenderer>(entity);
+		MaterialTable* materialTable = registry.ctx().find<MaterialTable>();
+		if (!materialTable || materialTable->materials.empty())
+			return;
+
+		RetireBuffer(registry, entity, materialBuffer.buffer, materialBuffer.memory);
+
+		VkDeviceSize size = sizeof(H2B::ATTRIBUTES) * materialTable->materials.size();
+		CreateAllocatedBuffer(registry, entity, size,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+			VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &materialBuffer.buffer, &materialBuffer.memory, GPUMemoryPool::Level);
+		memcpy(materialBuffer.memory.mapped, materialTable->materials.data(), size);
+
+		std::vector<VkDescriptorSet> descriptorSets = renderer.descriptorSets;
+		descriptorSets.insert(descriptorSets.end(), renderer.staticDescriptorSets.begin(), renderer.staticDescriptorSets.end());
+		descriptorSets.insert(descriptorSets.end(), renderer.anchoredDescriptorSets.begin(), renderer.anchoredDescriptorSets.end());
+		for (VkDescriptorSet descriptorSet : descriptorSets)
+		{
+			VkDescriptorBufferInfo materialBufferInfo = { materialBuffer.buffer, 0, VK_WHOLE_SIZE };
+			VkWriteDescriptorSet materialWrite = {};
+			materialWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			materialWrite.dstSet = descriptorSet;
+			materialWrite.dstBinding = 2; // 2 For the material table
+			materialWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			materialWrite.descriptorCount = 1;
+			materialWrite.pBufferInfo = &materialBufferInfo;
+
+			vkUpdateDescriptorSets(renderer.device, 1, &materialWrite, 0, nullptr);
+		}
+	}
+
+	void Destroy_VulkanMaterialBuffer(entt::registry& registry, entt::entity entity) {
+		auto& materialBuffer = registry.get<VulkanMaterialBuffer>(entity);
+		RetireBuffer(registry, entity, materialBuffer.buffer, materialBuffer.memory);
+		materialBuffer.buffer = VK_NULL_HANDLE;
+		materialBuffer.memory = GPUAllocation{};
+	}
+
+	// Uploads DrawTable::staticInstances and their draw commands to device-local memory,
+	// then points binding 1 of the static descriptor sets at the instances
+	void Update_VulkanStaticInstanceBuffer(entt::registry& registry, entt::entity entity) {
+		auto& staticBuffer = registry.get<VulkanStaticInstanceBuffer>(entity);
+		auto& renderer = registry.get<VulkanRenderer>(entity);
+		DrawTable* drawTable = registry.ctx().find<DrawTable>();
+		if (!drawTable || drawTable->staticInstances.empty())
+			return;
+
+		CancelBufferUploads(registry, entity, staticBuffer.instances);
+		CancelBufferUploads(registry, entity, staticBuffer.commands);
+		RetireBuffer(registry, entity, staticBuffer.instances, staticBuffer.instanceMemory);
+		RetireBuffer(registry, entity, staticBuffer.commands, staticBuffer.commandMemory);
 
-		vkDeviceWaitIdle(renderer.device);
-		for (auto handle : gpuBuffer.buffer)
+		UploadDeviceLocal(registry, entity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, drawTable->staticInstances.data(),
+			sizeof(GPUInstanceData) * drawTable->staticInstances.size(), &staticBuffer.instances, &staticBuffer.instanceMemory);
+
+		std::vector<VkDrawIndexedIndirectCommand> commands;
+		for (const DrawSlot& slot : drawTable->staticSlots)
 		{
-			vkDestroyBuffer(renderer.device, handle, nullptr);
+			commands.push_back(VkDrawIndexedIndirectCommand{ slot.geometry.indexCount, slot.instanceCount,
+				slot.geometry.indexStart, static_cast<int32_t>(slot.geometry.vertexStart), slot.firstInstance });
 		}
-		for (auto data : gpuBuffer.memory)
+		staticBuffer.uploadId = UploadDeviceLocal(registry, entity, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, commands.data(),
+			sizeof(VkDrawIndexedIndirectCommand) * commands.size(), &staticBuffer.commands, &staticBuffer.commandMemory);
+		staticBuffer.drawCount = static_cast<unsigned int>(commands.size());
+
+		for (VkDescriptorSet descriptorSet : renderer.staticDescriptorSets)
 		{
-			vkFreeMemory(renderer.device, data, nullptr);
+			VkDescriptorBufferInfo storageBufferInfo = { staticBuffer.instances, 0, VK_WHOLE_SIZE };
+			VkWriteDescriptorSet storageWrite = {};
+			storageWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			storageWrite.dstSet = descriptorSet;
+			storageWrite.dstBinding = 1; // 1 For the storage buffer
+			storageWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			storageWrite.descriptorCount = 1;
+			storageWrite.pBufferInfo = &storageBufferInfo;
+
+			vkUpdateDescriptorSets(renderer.device, 1, &storageWrite, 0, nullptr);
 		}
+
+		// the GPU has its copy now
+		drawTable->staticInstances.clear();
+		drawTable->staticInstances.shrink_to_fit();
+	}
+
+	void Destroy_VulkanStaticInstanceBuffer(entt::registry& registry, entt::entity entity) {
+		auto& staticBuffer = registry.get<VulkanStaticInstanceBuffer>(entity);
+		CancelBufferUploads(registry, entity, staticBuffer.instances);
+		CancelBufferUploads(registry, entity, staticBuffer.commands);
+		RetireBuffer(registry, entity, staticBuffer.instances, staticBuffer.instanceMemory);
+		RetireBuffer(registry, entity, staticBuffer.commands, staticBuffer.commandMemory);
+		staticBuffer = VulkanStaticInstanceBuffer{};
+	}
+
+	void Construct_VulkanAnchoredInstanceBuffer(entt::registry& registry, entt::entity entity) {
+		auto& anchoredBuffer = registry.get<VulkanAnchoredInstanceBuffer>(entity);
+		auto& renderer = registry.get<VulkanRenderer>(entity);
+
+		// buffers are created by the first patch that has something to draw
+		unsigned int frameCount = renderer.frameCount;
+		anchoredBuffer.written.resize(frameCount);
+		anchoredBuffer.instances.resize(frameCount, VK_NULL_HANDLE);
+		anchoredBuffer.instanceMemory.resize(frameCount);
+		anchoredBuffer.instanceCapacity.resize(frameCount, 0);
+		anchoredBuffer.commands.resize(frameCount, VK_NULL_HANDLE);
+		anchoredBuffer.commandMemory.resize(frameCount);
+		anchoredBuffer.commandCapacity.resize(frameCount, 0);
+	}
+
+	// Brings the current frame's copy of the anchored region up to date when it holds an older one.
+	// This frame's previous submission is finished, its buffers can be rewritten or regrown in place.
+	void Update_VulkanAnchoredInstanceBuffer(entt::registry& registry, entt::entity entity) {
+		auto& anchoredBuffer = registry.get<VulkanAnchoredInstanceBuffer>(entity);
+		auto& renderer = registry.get<VulkanRenderer>(entity);
+
+		unsigned int frame = renderer.currentFrame;
+		if (!anchoredBuffer.region || anchoredBuffer.written[frame] == anchoredBuffer.region)
+			return;
+		const AnchoredRegion& region = *anchoredBuffer.region;
+
+		if (region.instances.size() > anchoredBuffer.instanceCapacity[frame])
+		{
+			unsigned long long newCapacity = (std::max)(anchoredBuffer.instanceCapacity[frame], 16ull);
+			while (region.instances.size() > newCapacity)
+			{
+				newCapacity *= 2;
+			}
+
+			if (anchoredBuffer.instances[frame] != VK_NULL_HANDLE)
+			{
+				DestroyAllocatedBuffer(registry, entity, anchoredBuffer.instances[frame], anchoredBuffer.instanceMemory[frame]);
+			}
+			CreateAllocatedBuffer(registry, entity, sizeof(GPUInstanceData) * newCapacity,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+				VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &anchoredBuffer.instances[frame], &anchoredBuffer.instanceMemory[frame]);
+			anchoredBuffer.instanceCapacity[frame] = newCapacity;
+
+			VkDescriptorBufferInfo storageBufferInfo = { anchoredBuffer.instances[frame], 0, VK_WHOLE_SIZE };
+			VkWriteDescriptorSet storageWrite = {};
+			storageWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			storageWrite.dstSet = renderer.anchoredDescriptorSets[frame];
+			storageWrite.dstBinding = 1; // 1 For the storage buffer
+			storageWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			storageWrite.descriptorCount = 1;
+			storageWrite.pBufferInfo = &storageBufferInfo;
+
+			vkUpdateDescriptorSets(renderer.device, 1, &storageWrite, 0, nullptr);
+		}
+
+		if (region.slots.size() > anchoredBuffer.commandCapacity[frame])
+		{
+			if (anchoredBuffer.commands[frame] != VK_NULL_HANDLE)
+			{
+				DestroyAllocatedBuffer(registry, entity, anchoredBuffer.commands[frame], anchoredBuffer.commandMemory[frame]);
+			}
+			CreateAllocatedBuffer(registry, entity, sizeof(VkDrawIndexedIndirectCommand) * region.slots.size(),
+				VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+				VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &anchoredBuffer.commands[frame], &anchoredBuffer.commandMemory[frame]);
+			anchoredBuffer.commandCapacity[frame] = region.slots.size();
+		}
+
+		if (!region.instances.empty())
+		{
+			memcpy(anchoredBuffer.instanceMemory[frame].mapped, region.instances.data(), sizeof(GPUInstanceData) * region.instances.size());
+		}
+		VkDrawIndexedIndirectCommand* commands = reinterpret_cast<VkDrawIndexedIndirectCommand*>(anchoredBuffer.commandMemory[frame].mapped);
+		for (size_t i = 0; i < region.slots.size(); ++i)
+		{
+			const DrawSlot& slot = region.slots[i];
+			commands[i] = VkDrawIndexedIndirectCommand{ slot.geometry.indexCount, slot.instanceCount,
+				slot.geometry.indexStart, static_cast<int32_t>(slot.geometry.vertexStart), slot.firstInstance };
+		}
+		anchoredBuffer.written[frame] = anchoredBuffer.region;
+	}
+
+	void Destroy_VulkanAnchoredInstanceBuffer(entt::registry& registry, entt::entity entity) {
+		auto& anchoredBuffer = registry.get<VulkanAnchoredInstanceBuffer>(entity);
+
+		// every frame's copy may still be in flight
+		for (unsigned int i = 0; i < anchoredBuffer.instances.size(); i++)
+		{
+			RetireBuffer(registry, entity, anchoredBuffer.instances[i], anchoredBuffer.instanceMemory[i]);
+			RetireBuffer(registry, entity, anchoredBuffer.commands[i], anchoredBuffer.commandMemory[i]);
+		}
+		anchoredBuffer = VulkanAnchoredInstanceBuffer{};
 	}
 
 	void Construct_VulkanUniformBuffer(entt::registry& registry, entt::entity entity) {
@@ -190,14 +488,13 @@ namespace DRAW
 			AddSceneData(registry, entity);
 		}
 
-		unsigned int frameCount;
-		renderer.vlkSurface.GetSwapchainImageCount(frameCount);
+		unsigned int frameCount = renderer.frameCount;
 		bufferComponent.memory.resize(frameCount);
 		bufferComponent.buffer.resize(frameCount);
 
 		for (unsigned int i = 0; i < frameCount; i++)
 		{
-			GvkHelper::create_buffer(renderer.physicalDevice, renderer.device, sizeof(SceneData),
+			CreateAllocatedBuffer(registry, entity, sizeof(SceneData),
 				VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
 				VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &bufferComponent.buffer[i], &bufferComponent.memory[i]);
 		}
@@ -208,29 +505,18 @@ namespace DRAW
 		auto& renderer = registry.get<VulkanRenderer>(entity);
 		auto& data = registry.get<SceneData>(entity);
 
-		// TODO : Update Dynamic parts of the Scene Data here
-		// We really only support one camera, so use the first one
-		auto& camera = registry.get<Camera>(registry.view<Camera>().front());
-
-		data.camPos = camera.camMatrix.row4;
-		GW::MATH::GMatrix::InverseF(camera.camMatrix, data.viewMatrix);
+		// the camera and motion time were copied in from the frame's RenderSnapshot by BeginSnapshotFrame
 
-		unsigned int frame;
-		renderer.vlkSurface.GetSwapchainCurrentImage(frame);
-		GvkHelper::write_to_buffer(renderer.device, gpuBuffer.memory[frame], &data, sizeof(SceneData));
+		unsigned int frame = renderer.currentFrame;
+		memcpy(gpuBuffer.memory[frame].mapped, &data, sizeof(SceneData));
 	}
 
 	void Destroy_VulkanUniformBuffer(entt::registry& registry, entt::entity entity) {
 		auto& gpuBuffer = registry.get<VulkanUniformBuffer>(entity);
-		auto& renderer = registry.get<VulkanRenderer>(entity);
 
-		for (auto handle : gpuBuffer.buffer)
-		{
-			vkDestroyBuffer(renderer.device, handle, nullptr);
-		}
-		for (auto data : gpuBuffer.memory)
+		for (unsigned int i = 0; i < gpuBuffer.buffer.size(); i++)
 		{
-			vkFreeMemory(renderer.device, data, nullptr);
+			DestroyAllocatedBuffer(registry, entity, gpuBuffer.buffer[i], gpuBuffer.memory[i]);
 		}
 	}
 
@@ -247,6 +533,20 @@ namespace DRAW
 		registry.on_update<VulkanGPUInstanceBuffer>().connect<Update_VulkanGPUInstanceBuffer>();
 		registry.on_destroy<VulkanGPUInstanceBuffer>().connect<Destroy_VulkanGPUInstanceBuffer>();
 
+		registry.on_construct<VulkanIndirectBuffer>().connect<Construct_VulkanIndirectBuffer>();
+		registry.on_update<VulkanIndirectBuffer>().connect<Update_VulkanIndirectBuffer>();
+		registry.on_destroy<VulkanIndirectBuffer>().connect<Destroy_VulkanIndirectBuffer>();
+
+		registry.on_update<VulkanMaterialBuffer>().connect<Update_VulkanMaterialBuffer>();
+		registry.on_destroy<VulkanMaterialBuffer>().connect<Destroy_VulkanMaterialBuffer>();
+
+		registry.on_update<VulkanStaticInstanceBuffer>().connect<Update_VulkanStaticInstanceBuffer>();
+		registry.on_destroy<VulkanStaticInstanceBuffer>().connect<Destroy_VulkanStaticInstanceBuffer>();
+
+		registry.on_construct<VulkanAnchoredInstanceBuffer>().connect<Construct_VulkanAnchoredInstanceBuffer>();
+		registry.on_update<VulkanAnchoredInstanceBuffer>().connect<Update_VulkanAnchoredInstanceBuffer>();
+		registry.on_destroy<VulkanAnchoredInstanceBuffer>().connect<Destroy_VulkanAnchoredInstanceBuffer>();
+
 		registry.on_construct<VulkanUniformBuffer>().connect<Construct_VulkanUniformBuffer>();
 		registry.on_update<VulkanUniformBuffer>().connect<Update_VulkanUniformBuffer>();
 		registry.on_destroy<VulkanUniformBuffer>().connect<Destroy_VulkanUniformBuffer>();
@@ -0,0 +1,131 @@
+#include "DrawComponents.h"
+#include "../CCL.h"
+#include <iostream>
+
+namespace DRAW
+{
+	//*** HELPERS ***//
+	void ExecuteRecordedPasses(VulkanRenderer& renderer, VulkanCommandRecorder& recorder, VkCommandBuffer primary,
+		VkSubpassContents contents, unsigned int image, VkFramebuffer framebuffer, const VkViewport& viewport, const VkRect2D& scissor)
+	{
+		const unsigned int passCount = VulkanCommandRecorder::passCount;
+
+		// Gateware's StartFrame begins its pass with inline contents, which cannot execute secondaries.
+		// Restarting the pass would clear the frame a second time, so on screen the passes go straight into the primary.
+		if (contents == VK_SUBPASS_CONTENTS_INLINE)
+		{
+			vkCmdSetViewport(primary, 0, 1, &viewport);
+			vkCmdSetScissor(primary, 0, 1, &scissor);
+			for (unsigned int pass = 0; pass < passCount; ++pass)
+			{
+				if (recorder.passes[pass])
+					recorder.passes[pass](primary);
+				recorder.passes[pass] = nullptr;
+			}
+			return;
+		}
+
+		VkCommandBufferInheritanceInfo inheritance = {};
+		inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		inheritance.renderPass = renderer.renderPass;
+		inheritance.subpass = 0;
+		inheritance.framebuffer = framebuffer;
+
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		beginInfo.pInheritanceInfo = &inheritance;
+
+		// StartFrame waited on this image's fence, so the buffers it executed last time are free to reuse
+		VkCommandBuffer* buffers = &recorder.buffers[image * passCount];
+		VkCommandPool* pools = &recorder.pools[image * passCount];
+		bool recorded[passCount] = {};
+
+		recorder.jobs->ParallelFor(passCount, 1, [&](size_t begin, size_t end) {
+			for (size_t pass = begin; pass < end; ++pass)
+			{
+				if (!recorder.passes[pass])
+					continue;
+
+				vkResetCommandPool(renderer.device, pools[pass], 0);
+				vkBeginCommandBuffer(buffers[pass], &beginInfo);
+				// dynamic state is not inherited from the primary
+				vkCmdSetViewport(buffers[pass], 0, 1, &viewport);
+				vkCmdSetScissor(buffers[pass], 0, 1, &scissor);
+				recorder.passes[pass](buffers[pass]);
+				vkEndCommandBuffer(buffers[pass]);
+				recorded[pass] = true;
+			}
+		});
+
+		VkCommandBuffer executed[passCount];
+		uint32_t executedCount = 0;
+		for (unsigned int pass = 0; pass < passCount; ++pass)
+		{
+			if (recorded[pass])
+				executed[executedCount++] = buffers[pass];
+			recorder.passes[pass] = nullptr;
+		}
+		// the frame's one render pass was begun with secondary contents, it clears even when nothing is executed
+		if (executedCount != 0)
+			vkCmdExecuteCommands(primary, executedCount, executed);
+	}
+
+	//*** SYSTEMS ***//
+	void Construct_VulkanCommandRecorder(entt::registry& registry, entt::entity entity)
+	{
+		auto& recorder = registry.get<VulkanCommandRecorder>(entity);
+		auto& renderer = registry.get<VulkanRenderer>(entity);
+
+		// one thread per pass is all recording can use, the rest of the pool is there for other frame work
+		recorder.jobs = std::make_unique<UTIL::JobSystem>();
+		// on screen the passes are recorded inline into Gateware's primary, see ExecuteRecordedPasses
+		if (!renderer.headless)
+			return;
+
+		recorder.pools.resize(renderer.frameCount * VulkanCommandRecorder::passCount, VK_NULL_HANDLE);
+		recorder.buffers.resize(recorder.pools.size(), VK_NULL_HANDLE);
+
+		// a pool per buffer, command pools must never be used from two threads at once
+		for (size_t i = 0; i < recorder.pools.size(); ++i)
+		{
+			VkCommandPoolCreateInfo poolInfo = {};
+			poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+			poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+			poolInfo.queueFamilyIndex = renderer.graphicsFamily;
+			vkCreateCommandPool(renderer.device, &poolInfo, nullptr, &recorder.pools[i]);
+
+			VkCommandBufferAllocateInfo allocateInfo = {};
+			allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocateInfo.commandPool = recorder.pools[i];
+			allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+			allocateInfo.commandBufferCount = 1;
+			vkAllocateCommandBuffers(renderer.device, &allocateInfo, &recorder.buffers[i]);
+		}
+	}
+
+	void Destroy_VulkanCommandRecorder(entt::registry& registry, entt::entity entity)
+	{
+		auto& recorder = registry.get<VulkanCommandRecorder>(entity);
+		recorder.jobs.reset();
+
+		VulkanRenderer* renderer = registry.try_get<VulkanRenderer>(entity);
+		if (!renderer || renderer->device == nullptr)
+			return;
+
+		// registry.clear() may get here before the renderer has idled the device
+		vkDeviceWaitIdle(renderer->device);
+		// freeing a pool frees its command buffer
+		for (VkCommandPool pool : recorder.pools)
+			vkDestroyCommandPool(renderer->device, pool, nullptr);
+		recorder.pools.clear();
+		recorder.buffers.clear();
+	}
+
+	// Use this MACRO to connect the EnTT Component Logic
+	CONNECT_COMPONENT_LOGIC() {
+		registry.on_construct<VulkanCommandRecorder>().connect<Construct_VulkanCommandRecorder>();
+		registry.on_destroy<VulkanCommandRecorder>().connect<Destroy_VulkanCommandRecorder>();
+	}
+
+} // namespace DRAW
@@ -0,0 +1,495 @@
+#include "DrawComponents.h"
+#include "../CCL.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace DRAW
+{
+	//*** HELPERS ***//
+	// UINT32_MAX when the device has no such type, allocating with a made up index is undefined
+	static uint32_t FindOffscreenMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeBits, VkMemoryPropertyFlags properties)
+	{
+		VkPhysicalDeviceMemoryProperties memoryProperties;
+		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+		for (uint32_t type = 0; type < memoryProperties.memoryTypeCount; ++type)
+		{
+			if ((typeBits & (1u << type)) && (memoryProperties.memoryTypes[type].propertyFlags & properties) == properties)
+				return type;
+		}
+		return UINT32_MAX;
+	}
+
+	static bool CreateOffscreenImage(VulkanRenderer& renderer, const VulkanOffscreenTarget& target, VkFormat format,
+		VkImageUsageFlags usage, VkImageAspectFlags aspect, VkImage* image, VkDeviceMemory* memory, VkImageView* view)
+	{
+		VkImageCreateInfo imageInfo = {};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = format;
+		imageInfo.extent = { target.width, target.height, 1 };
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = usage;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		vkCreateImage(renderer.device, &imageInfo, nullptr, image);
+
+		VkMemoryRequirements requirements;
+		vkGetImageMemoryRequirements(renderer.device, *image, &requirements);
+		VkMemoryAllocateInfo allocateInfo = {};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocateInfo.allocationSize = requirements.size;
+		allocateInfo.memoryTypeIndex = FindOffscreenMemoryType(renderer.physicalDevice, requirements.memoryTypeBits,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		if (allocateInfo.memoryTypeIndex == UINT32_MAX || vkAllocateMemory(renderer.device, &allocateInfo, nullptr, memory) != VK_SUCCESS)
+			return false;
+		vkBindImageMemory(renderer.device, *image, *memory, 0);
+
+		VkImageViewCreateInfo viewInfo = {};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = *image;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = format;
+		viewInfo.subresourceRange = { aspect, 0, 1, 0, 1 };
+		vkCreateImageView(renderer.device, &viewInfo, nullptr, view);
+		return true;
+	}
+
+	// Made the first time a frame is dumped, most runs never need it
+	static bool CreateReadback(VulkanRenderer& renderer, const VulkanOffscreenTarget& target, VulkanOffscreenTarget::Frame& frame)
+	{
+		VkBufferCreateInfo bufferInfo = {};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = static_cast<VkDeviceSize>(target.width) * target.height * 4;
+		bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		vkCreateBuffer(renderer.device, &bufferInfo, nullptr, &frame.readback);
+
+		VkMemoryRequirements requirements;
+		vkGetBufferMemoryRequirements(renderer.device, frame.readback, &requirements);
+		VkMemoryAllocateInfo allocateInfo = {};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocateInfo.allocationSize = requirements.size;
+		allocateInfo.memoryTypeIndex = FindOffscreenMemoryType(renderer.physicalDevice, requirements.memoryTypeBits,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		if (allocateInfo.memoryTypeIndex == UINT32_MAX ||
+			vkAllocateMemory(renderer.device, &allocateInfo, nullptr, &frame.readbackMemory) != VK_SUCCESS)
+		{
+			vkDestroyBuffer(renderer.device, frame.readback, nullptr);
+			frame.readback = VK_NULL_HANDLE;
+			return false;
+		}
+		vkBindBufferMemory(renderer.device, frame.readback, frame.readbackMemory, 0);
+		vkMapMemory(renderer.device, frame.readbackMemory, 0, VK_WHOLE_SIZE, 0, &frame.readbackMapped);
+		return true;
+	}
+
+	// Binary PPM, every image diff tool reads it and it needs no library. Rows come out top to bottom.
+	static bool WritePPM(const std::string& path, const unsigned char* pixels, unsigned int width, unsigned int height, bool bgra)
+	{
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file << "P6\n" << width << " " << height << "\n255\n";
+		std::vector<unsigned char> row(static_cast<size_t>(width) * 3);
+		for (unsigned int y = 0; y < height; ++y)
+		{
+			const unsigned char* source = pixels + static_cast<size_t>(y) * width * 4;
+			for (unsigned int x = 0; x < width; ++x)
+			{
+				row[x * 3 + 0] = source[x * 4 + (bgra ? 2 : 0)];
+				row[x * 3 + 1] = source[x * 4 + 1];
+				row[x * 3 + 2] = source[x * 4 + (bgra ? 0 : 2)];
+			}
+			file.write(reinterpret_cast<const char*>(row.data()), row.size());
+		}
+		return static_cast<bool>(file);
+	}
+
+	// The frame's fence has signalled, so its timestamps and image are final
+	static void CollectOffscreenFrame(VulkanRenderer& renderer, VulkanOffscreenTarget& target, unsigned int index)
+	{
+		VulkanOffscreenTarget::Frame& frame = target.frames[index];
+		if (frame.frameNumber == 0)
+			return;
+
+		double gpuMilliseconds = 0.0;
+		if (target.timestamps != VK_NULL_HANDLE)
+		{
+			uint64_t ticks[2] = {};
+			if (vkGetQueryPoolResults(renderer.device, target.timestamps, index * 2, 2, sizeof(ticks), ticks,
+				sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+			{
+				gpuMilliseconds = static_cast<double>((ticks[1] - ticks[0]) & target.timestampMask) * target.timestampPeriod / 1.0e6;
+			}
+		}
+		target.timings.push_back({ frame.frameNumber, frame.recordSeconds * 1000.0, gpuMilliseconds });
+
+		// an empty folder here means a later readback failed and dumping was switched off
+		if (frame.dump && !target.dumpFolder.empty())
+		{
+			std::error_code error;
+			std::filesystem::create_directories(target.dumpFolder, error);
+			char name[32];
+			std::snprintf(name, sizeof(name), "frame_%05llu.ppm", frame.frameNumber);
+			std::string path = (std::filesystem::path(target.dumpFolder) / name).string();
+			bool bgra = target.colorFormat == VK_FORMAT_B8G8R8A8_UNORM || target.colorFormat == VK_FORMAT_B8G8R8A8_SRGB;
+			if (!WritePPM(path, static_cast<const unsigned char*>(frame.readbackMapped), target.width, target.height, bgra))
+				std::cout << "Offscreen: could not write " << path << std::endl;
+		}
+		frame.dump = false;
+		frame.frameNumber = 0;
+	}
+
+	bool CreateOffscreenDevice(VulkanRenderer& renderer, VulkanOffscreenTarget& target, bool validation)
+	{
+		VkApplicationInfo appInfo = {};
+		appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+		appInfo.pApplicationName = "SPACE RACE (offscreen)";
+		appInfo.apiVersion = VK_API_VERSION_1_1;
+
+		// only when it is installed, CI machines rarely have the SDK
+		std::vector<const char*> layers;
+		if (validation)
+		{
+			uint32_t layerCount = 0;
+			vkEnumerateInstanceLayerProperties(&layerCount, nullptr);
+			std::vector<VkLayerProperties> available(layerCount);
+			vkEnumerateInstanceLayerProperties(&layerCount, available.data());
+			for (const VkLayerProperties& layer : available)
+			{
+				if (std::strcmp(layer.layerName, "VK_LAYER_KHRONOS_validation") == 0)
+					layers.push_back("VK_LAYER_KHRONOS_validation");
+			}
+		}
+
+		VkInstanceCreateInfo instanceInfo = {};
+		instanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+		instanceInfo.pApplicationInfo = &appInfo;
+		instanceInfo.enabledLayerCount = static_cast<uint32_t>(layers.size());
+		instanceInfo.ppEnabledLayerNames = layers.data();
+		if (vkCreateInstance(&instanceInfo, nullptr, &renderer.instance) != VK_SUCCESS)
+			return false;
+
+		// a real GPU when there is one, otherwise lavapipe or whatever CPU implementation is installed
+		uint32_t deviceCount = 0;
+		vkEnumeratePhysicalDevices(renderer.instance, &deviceCount, nullptr);
+		std::vector<VkPhysicalDevice> devices(deviceCount);
+		vkEnumeratePhysicalDevices(renderer.instance, &deviceCount, devices.data());
+		int bestScore = -1;
+		uint32_t timestampValidBits = 0;
+		for (VkPhysicalDevice device : devices)
+		{
+			VkPhysicalDeviceProperties properties;
+			vkGetPhysicalDeviceProperties(device, &properties);
+			int score = properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU ? 1 : 2;
+			if (score <= bestScore)
+				continue;
+
+			uint32_t familyCount = 0;
+			vkGetPhysicalDeviceQueueFamilyProperties(device, &familyCount, nullptr);
+			std::vector<VkQueueFamilyProperties> families(familyCount);
+			vkGetPhysicalDeviceQueueFamilyProperties(device, &familyCount, families.data());
+			for (uint32_t family = 0; family < familyCount; ++family)
+			{
+				if (families[family].queueFlags & VK_QUEUE_GRAPHICS_BIT)
+				{
+					bestScore = score;
+					renderer.physicalDevice = device;
+					renderer.graphicsFamily = family;
+					timestampValidBits = families[family].timestampValidBits;
+					break;
+				}
+			}
+		}
+		if (bestScore < 0)
+		{
+			std::cout << "Offscreen: no Vulkan device with a graphics queue" << std::endl;
+			return false;
+		}
+		// the attachments need device local memory and the frame dumps need memory the CPU can map
+		if (FindOffscreenMemoryType(renderer.physicalDevice, ~0u, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) == UINT32_MAX ||
+			FindOffscreenMemoryType(renderer.physicalDevice, ~0u,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) == UINT32_MAX)
+		{
+			std::cout << "Offscreen: the Vulkan device has no usable memory type" << std::endl;
+			return false;
+		}
+
+		// every supported feature, the same as Gateware asks for on screen
+		VkPhysicalDeviceFeatures features;
+		vkGetPhysicalDeviceFeatures(renderer.physicalDevice, &features);
+		float priority = 1.0f;
+		VkDeviceQueueCreateInfo queueInfo = {};
+		queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+		queueInfo.queueFamilyIndex = renderer.graphicsFamily;
+		queueInfo.queueCount = 1;
+		queueInfo.pQueuePriorities = &priority;
+
+		VkDeviceCreateInfo deviceInfo = {};
+		deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+		deviceInfo.queueCreateInfoCount = 1;
+		deviceInfo.pQueueCreateInfos = &queueInfo;
+		deviceInfo.pEnabledFeatures = &features;
+		if (vkCreateDevice(renderer.physicalDevice, &deviceInfo, nullptr, &renderer.device) != VK_SUCCESS)
+			return false;
+		vkGetDeviceQueue(renderer.device, renderer.graphicsFamily, 0, &renderer.graphicsQueue);
+		renderer.frameCount = target.frameCount;
+		renderer.headless = true;
+
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(renderer.physicalDevice, &properties);
+		target.timestampPeriod = properties.limits.timestampPeriod;
+		target.timestampMask = timestampValidBits >= 64 ? ~0ull : (1ull << timestampValidBits) - 1;
+		std::cout << "Offscreen: " << target.width << "x" << target.height << " on " << properties.deviceName
+			<< (target.timestampMask ? "" : ", no GPU timestamps") << std::endl;
+		return true;
+	}
+
+	bool CreateOffscreenFrames(VulkanRenderer& renderer, VulkanOffscreenTarget& target)
+	{
+		// the same attachments as Gateware's pass, the pipelines are built exactly as they are on screen
+		VkAttachmentDescription attachments[2] = {};
+		attachments[0].format = target.colorFormat;
+		attachments[0].samples = VK_SAMPLE_COUNT_1_BIT;
+		attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		attachments[0].finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL; // ready for the readback copy
+		attachments[1].format = target.depthFormat;
+		attachments[1].samples = VK_SAMPLE_COUNT_1_BIT;
+		attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachments[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		attachments[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachments[1].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+		VkAttachmentReference colorReference = { 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+		VkAttachmentReference depthReference = { 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+		VkSubpassDescription subpass = {};
+		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpass.colorAttachmentCount = 1;
+		subpass.pColorAttachments = &colorReference;
+		subpass.pDepthStencilAttachment = &depthReference;
+
+		// in: the images' previous frame (and its readback) is done with them. out: the readback copy waits for the color
+		VkSubpassDependency dependencies[2] = {};
+		dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+		dependencies[0].dstSubpass = 0;
+		dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT |
+			VK_PIPELINE_STAGE_TRANSFER_BIT;
+		dependencies[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+			VK_ACCESS_TRANSFER_READ_BIT;
+		dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+		dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		dependencies[1].srcSubpass = 0;
+		dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+		dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+		VkRenderPassCreateInfo passInfo = {};
+		passInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		passInfo.attachmentCount = 2;
+		passInfo.pAttachments = attachments;
+		passInfo.subpassCount = 1;
+		passInfo.pSubpasses = &subpass;
+		passInfo.dependencyCount = 2;
+		passInfo.pDependencies = dependencies;
+		vkCreateRenderPass(renderer.device, &passInfo, nullptr, &target.renderPass);
+		renderer.renderPass = target.renderPass;
+
+		if (target.timestampMask != 0)
+		{
+			VkQueryPoolCreateInfo queryInfo = {};
+			queryInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+			queryInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+			queryInfo.queryCount = target.frameCount * 2;
+			vkCreateQueryPool(renderer.device, &queryInfo, nullptr, &target.timestamps);
+		}
+
+		target.frames.resize(target.frameCount);
+		for (VulkanOffscreenTarget::Frame& frame : target.frames)
+		{
+			if (!CreateOffscreenImage(renderer, target, target.colorFormat,
+					VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_IMAGE_ASPECT_COLOR_BIT,
+					&frame.color, &frame.colorMemory, &frame.colorView) ||
+				!CreateOffscreenImage(renderer, target, target.depthFormat,
+					VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_IMAGE_ASPECT_DEPTH_BIT,
+					&frame.depth, &frame.depthMemory, &frame.depthView))
+			{
+				std::cout << "Offscreen: no device local memory for a " << target.width << "x" << target.height << " image" << std::endl;
+				return false;
+			}
+
+			VkImageView views[2] = { frame.colorView, frame.depthView };
+			VkFramebufferCreateInfo framebufferInfo = {};
+			framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+			framebufferInfo.renderPass = target.renderPass;
+			framebufferInfo.attachmentCount = 2;
+			framebufferInfo.pAttachments = views;
+			framebufferInfo.width = target.width;
+			framebufferInfo.height = target.height;
+			framebufferInfo.layers = 1;
+			vkCreateFramebuffer(renderer.device, &framebufferInfo, nullptr, &frame.framebuffer);
+
+			VkCommandPoolCreateInfo poolInfo = {};
+			poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+			poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+			poolInfo.queueFamilyIndex = renderer.graphicsFamily;
+			vkCreateCommandPool(renderer.device, &poolInfo, nullptr, &frame.commandPool);
+
+			VkCommandBufferAllocateInfo allocateInfo = {};
+			allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocateInfo.commandPool = frame.commandPool;
+			allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			allocateInfo.commandBufferCount = 1;
+			vkAllocateCommandBuffers(renderer.device, &allocateInfo, &frame.commandBuffer);
+
+			VkFenceCreateInfo fenceInfo = {};
+			fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+			vkCreateFence(renderer.device, &fenceInfo, nullptr, &frame.fence);
+		}
+		return true;
+	}
+
+	VkCommandBuffer BeginOffscreenFrame(VulkanRenderer& renderer, VulkanOffscreenTarget& target)
+	{
+		target.current = static_cast<unsigned int>(target.submittedFrames % target.frames.size());
+		VulkanOffscreenTarget::Frame& frame = target.frames[target.current];
+
+		// like StartFrame, this only blocks when the GPU is every frame behind
+		if (frame.frameNumber != 0)
+		{
+			vkWaitForFences(renderer.device, 1, &frame.fence, VK_TRUE, UINT64_MAX);
+			CollectOffscreenFrame(renderer, target, target.current);
+		}
+
+		vkResetCommandPool(renderer.device, frame.commandPool, 0);
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		vkBeginCommandBuffer(frame.commandBuffer, &beginInfo);
+		if (target.timestamps != VK_NULL_HANDLE)
+		{
+			vkCmdResetQueryPool(frame.commandBuffer, target.timestamps, target.current * 2, 2);
+			vkCmdWriteTimestamp(frame.commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, target.timestamps, target.current * 2);
+		}
+
+		// the renderer's clear values like StartFrame, but with secondary contents so the passes recorded
+		// on the job pool execute in this one render pass
+		VkRenderPassBeginInfo passInfo = {};
+		passInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		passInfo.renderPass = target.renderPass;
+		passInfo.framebuffer = frame.framebuffer;
+		passInfo.renderArea = { { 0, 0 }, { target.width, target.height } };
+		passInfo.clearValueCount = 2;
+		passInfo.pClearValues = renderer.clrAndDepth;
+		vkCmdBeginRenderPass(frame.commandBuffer, &passInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+		return frame.commandBuffer;
+	}
+
+	void EndOffscreenFrame(VulkanRenderer& renderer, VulkanOffscreenTarget& target, double recordSeconds)
+	{
+		VulkanOffscreenTarget::Frame& frame = target.frames[target.current];
+		VkCommandBuffer commandBuffer = frame.commandBuffer;
+		vkCmdEndRenderPass(commandBuffer);
+		// before the readback copy, the GPU time is the frame's rendering only
+		if (target.timestamps != VK_NULL_HANDLE)
+			vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, target.timestamps, target.current * 2 + 1);
+
+		if (!target.dumpFolder.empty() && frame.readback == VK_NULL_HANDLE && !CreateReadback(renderer, target, frame))
+		{
+			std::cout << "Offscreen: no host visible memory for the readback, frames are not dumped" << std::endl;
+			target.dumpFolder.clear();
+		}
+		frame.dump = !target.dumpFolder.empty();
+		if (frame.dump)
+		{
+
+			VkBufferImageCopy region = {};
+			region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+			region.imageExtent = { target.width, target.height, 1 };
+			vkCmdCopyImageToBuffer(commandBuffer, frame.color, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, frame.readback, 1, &region);
+
+			VkMemoryBarrier toHost = {};
+			toHost.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			toHost.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			toHost.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+				1, &toHost, 0, nullptr, 0, nullptr);
+		}
+		vkEndCommandBuffer(commandBuffer);
+
+		VkSubmitInfo submitInfo = {};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &commandBuffer;
+		vkResetFences(renderer.device, 1, &frame.fence);
+		vkQueueSubmit(renderer.graphicsQueue, 1, &submitInfo, frame.fence);
+
+		frame.frameNumber = ++target.submittedFrames;
+		frame.recordSeconds = recordSeconds;
+	}
+
+	void FinishOffscreenFrames(VulkanRenderer& renderer, VulkanOffscreenTarget& target)
+	{
+		// the next frame to be reused is the oldest, going round from there keeps the timings in order
+		for (size_t i = 0; i < target.frames.size(); ++i)
+		{
+			unsigned int index = static_cast<unsigned int>((target.submittedFrames + i) % target.frames.size());
+			if (target.frames[index].frameNumber == 0)
+				continue;
+			vkWaitForFences(renderer.device, 1, &target.frames[index].fence, VK_TRUE, UINT64_MAX);
+			CollectOffscreenFrame(renderer, target, index);
+		}
+	}
+
+	//*** SYSTEMS ***//
+	void Destroy_VulkanOffscreenTarget(entt::registry& registry, entt::entity entity)
+	{
+		auto& target = registry.get<VulkanOffscreenTarget>(entity);
+		VulkanRenderer* renderer = registry.try_get<VulkanRenderer>(entity);
+		if (!renderer || renderer->device == nullptr)
+			return;
+
+		// registry.clear() may get here before the renderer has idled the device
+		vkDeviceWaitIdle(renderer->device);
+		for (VulkanOffscreenTarget::Frame& frame : target.frames)
+		{
+			vkDestroyFramebuffer(renderer->device, frame.framebuffer, nullptr);
+			vkDestroyImageView(renderer->device, frame.colorView, nullptr);
+			vkDestroyImageView(renderer->device, frame.depthView, nullptr);
+			vkDestroyImage(renderer->device, frame.color, nullptr);
+			vkDestroyImage(renderer->device, frame.depth, nullptr);
+			vkFreeMemory(renderer->device, frame.colorMemory, nullptr);
+			vkFreeMemory(renderer->device, frame.depthMemory, nullptr);
+			// freeing the memory unmaps it
+			vkDestroyBuffer(renderer->device, frame.readback, nullptr);
+			vkFreeMemory(renderer->device, frame.readbackMemory, nullptr);
+			vkDestroyFence(renderer->device, frame.fence, nullptr);
+			// freeing a pool frees its command buffer
+			vkDestroyCommandPool(renderer->device, frame.commandPool, nullptr);
+		}
+		target.frames.clear();
+		vkDestroyQueryPool(renderer->device, target.timestamps, nullptr);
+		vkDestroyRenderPass(renderer->device, target.renderPass, nullptr);
+		target.timestamps = VK_NULL_HANDLE;
+		target.renderPass = VK_NULL_HANDLE;
+		renderer->renderPass = VK_NULL_HANDLE;
+	}
+
+	// Use this MACRO to connect the EnTT Component Logic
+	CONNECT_COMPONENT_LOGIC() {
+		registry.on_destroy<VulkanOffscreenTarget>().connect<Destroy_VulkanOffscreenTarget>();
+	}
+
+} // namespace DRAW
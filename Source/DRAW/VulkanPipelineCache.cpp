@@ -0,0 +1,167 @@
+#include "DrawComponents.h"
+#include "../CCL.h"
+#include "Utility/FontLoader.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace DRAW
+{
+	//*** HELPERS ***//
+	// Written in front of the driver's blob. A cache from another GPU or driver build is worthless
+	// at best, so it is thrown away unless all of these match.
+	struct PipelineCacheFileHeader
+	{
+		uint32_t magic = 0x43504B56; // "VKPC"
+		uint32_t version = 1;
+		uint32_t vendorID = 0;
+		uint32_t deviceID = 0;
+		uint32_t driverVersion = 0;
+		uint8_t pipelineCacheUUID[VK_UUID_SIZE] = {};
+		uint8_t deviceUUID[VK_UUID_SIZE] = {};
+		uint8_t driverUUID[VK_UUID_SIZE] = {};
+		uint64_t dataSize = 0;
+	};
+
+	static PipelineCacheFileHeader DescribeDevice(VulkanRenderer& renderer)
+	{
+		PipelineCacheFileHeader header;
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(renderer.physicalDevice, &properties);
+		header.vendorID = properties.vendorID;
+		header.deviceID = properties.deviceID;
+		header.driverVersion = properties.driverVersion;
+		memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+
+		// device and driver UUIDs are Vulkan 1.1, left zeroed (and so still compared) without it
+		VkInstance instance = renderer.instance;
+		auto getProperties2 = instance && properties.apiVersion >= VK_API_VERSION_1_1
+			? reinterpret_cast<PFN_vkGetPhysicalDeviceProperties2>(vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceProperties2"))
+			: nullptr;
+		if (getProperties2)
+		{
+			VkPhysicalDeviceIDProperties idProperties = {};
+			idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+			VkPhysicalDeviceProperties2 properties2 = {};
+			properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+			properties2.pNext = &idProperties;
+			getProperties2(renderer.physicalDevice, &properties2);
+			memcpy(header.deviceUUID, idProperties.deviceUUID, VK_UUID_SIZE);
+			memcpy(header.driverUUID, idProperties.driverUUID, VK_UUID_SIZE);
+		}
+		return header;
+	}
+
+	static bool SameDevice(const PipelineCacheFileHeader& a, const PipelineCacheFileHeader& b)
+	{
+		return a.magic == b.magic && a.version == b.version && a.vendorID == b.vendorID && a.deviceID == b.deviceID &&
+			a.driverVersion == b.driverVersion &&
+			memcmp(a.pipelineCacheUUID, b.pipelineCacheUUID, VK_UUID_SIZE) == 0 &&
+			memcmp(a.deviceUUID, b.deviceUUID, VK_UUID_SIZE) == 0 &&
+			memcmp(a.driverUUID, b.driverUUID, VK_UUID_SIZE) == 0;
+	}
+
+	// Empty when there is no file or it was written by another device or driver
+	static std::vector<char> ReadPipelineCache(const std::string& path, const PipelineCacheFileHeader& expected)
+	{
+		std::ifstream file(path, std::ios::binary);
+		PipelineCacheFileHeader header;
+		if (!file || !file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+			return {};
+
+		if (!SameDevice(header, expected))
+		{
+			std::cout << "Pipeline cache: " << path << " is from another device or driver, starting cold" << std::endl;
+			return {};
+		}
+
+		std::vector<char> data(header.dataSize);
+		if (!file.read(data.data(), data.size()))
+			return {};
+		return data;
+	}
+
+	// Written to a temporary file first so a crash mid-write never leaves a broken cache behind
+	static void WritePipelineCache(VkDevice device, const VulkanPipelineCache& pipelineCache, PipelineCacheFileHeader header)
+	{
+		size_t size = 0;
+		if (vkGetPipelineCacheData(device, pipelineCache.cache, &size, nullptr) != VK_SUCCESS || size == 0)
+			return;
+		std::vector<char> data(size);
+		if (vkGetPipelineCacheData(device, pipelineCache.cache, &size, data.data()) != VK_SUCCESS)
+			return;
+		header.dataSize = size;
+
+		std::string tempPath = pipelineCache.path + ".tmp";
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(data.data(), size);
+			if (!file)
+			{
+				std::cout << "Pipeline cache: could not write " << tempPath << std::endl;
+				return;
+			}
+		}
+
+		std::error_code error;
+		std::filesystem::rename(tempPath, pipelineCache.path, error);
+		if (error)
+			std::cout << "Pipeline cache: could not replace " << pipelineCache.path << std::endl;
+	}
+
+	//*** SYSTEMS ***//
+	void Construct_VulkanPipelineCache(entt::registry& registry, entt::entity entity)
+	{
+		auto& pipelineCache = registry.get<VulkanPipelineCache>(entity);
+		auto& renderer = registry.get<VulkanRenderer>(entity);
+
+		pipelineCache.path = ResolveAssetPath("Shaders/PipelineCache.bin");
+		std::vector<char> data = ReadPipelineCache(pipelineCache.path, DescribeDevice(renderer));
+
+		VkPipelineCacheCreateInfo createInfo = {};
+		createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		createInfo.initialDataSize = data.size();
+		createInfo.pInitialData = data.empty() ? nullptr : data.data();
+		if (vkCreatePipelineCache(renderer.device, &createInfo, nullptr, &pipelineCache.cache) != VK_SUCCESS)
+		{
+			// the driver rejected the blob after all, fall back to an empty cache
+			createInfo.initialDataSize = 0;
+			createInfo.pInitialData = nullptr;
+			data.clear();
+			vkCreatePipelineCache(renderer.device, &createInfo, nullptr, &pipelineCache.cache);
+		}
+		pipelineCache.loadedBytes = data.size();
+	}
+
+	// Waits for the workers, frees pipelines nobody collected, then saves the cache for the next run
+	void Destroy_VulkanPipelineCache(entt::registry& registry, entt::entity entity)
+	{
+		auto& pipelineCache = registry.get<VulkanPipelineCache>(entity);
+		VulkanRenderer* renderer = registry.try_get<VulkanRenderer>(entity);
+		if (!renderer || renderer->device == nullptr || pipelineCache.cache == VK_NULL_HANDLE)
+			return;
+
+		for (std::future<VkPipeline>* pending : { &pipelineCache.scenePipeline, &pipelineCache.textPipeline })
+		{
+			if (pending->valid())
+			{
+				VkPipeline pipeline = pending->get();
+				if (pipeline != VK_NULL_HANDLE)
+					vkDestroyPipeline(renderer->device, pipeline, nullptr);
+			}
+		}
+
+		WritePipelineCache(renderer->device, pipelineCache, DescribeDevice(*renderer));
+		vkDestroyPipelineCache(renderer->device, pipelineCache.cache, nullptr);
+		pipelineCache.cache = VK_NULL_HANDLE;
+	}
+
+	// Use this MACRO to connect the EnTT Component Logic
+	CONNECT_COMPONENT_LOGIC() {
+		registry.on_construct<VulkanPipelineCache>().connect<Construct_VulkanPipelineCache>();
+		registry.on_destroy<VulkanPipelineCache>().connect<Destroy_VulkanPipelineCache>();
+	}
+
+} // namespace DRAW
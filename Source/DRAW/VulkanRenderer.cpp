@@ -1,23 +1,21 @@
 #include "DrawComponents.h"
 #include "../CCL.h"
 // component dependencies
-#include "Utility/FileIntoString.h"
-#include "Utility/TextMeshBuilder.h"
-#include "../GAME/GameComponents.h"
+#include "Utility/ShaderCache.h"
 #include "../DRAW/Utility/FontLoader.h"
 
 #include <cstring>
 #include <iostream>
 
-#include "shaderc/shaderc.h" // needed for compiling shaders at runtime
-#ifdef _WIN32 // must use MT platform DLL libraries on windows
-#pragma comment(lib, "shaderc_combined.lib") 
-#endif
-
 namespace DRAW
 {
 	//*** HELPER METHODS ***//
 
+	static double SecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
 
 	VkViewport CreateViewportFromWindowDimensions(unsigned int windowWidth, unsigned int windowHeight)
 	{
@@ -41,16 +39,30 @@ namespace DRAW
 		return retval;
 	}
 
+	void GetRenderTargetSize(entt::registry& registry, entt::entity entity, unsigned int& width, unsigned int& height)
+	{
+		if (VulkanOffscreenTarget* offscreen = registry.try_get<VulkanOffscreenTarget>(entity))
+		{
+			width = offscreen->width;
+			height = offscreen->height;
+			return;
+		}
+		GW::SYSTEM::GWindow win = registry.get<GW::SYSTEM::GWindow>(entity);
+		win.GetClientWidth(width);
+		win.GetClientHeight(height);
+	}
+
 	void InitializeDescriptors(entt::registry& registry, entt::entity entity)
 	{
 		auto& vulkanRenderer = registry.get<VulkanRenderer>(entity);
 
-		unsigned int frameCount;
-		vulkanRenderer.vlkSurface.GetSwapchainImageCount(frameCount);
+		unsigned int frameCount = vulkanRenderer.frameCount;
 		vulkanRenderer.descriptorSets.resize(frameCount);
+		vulkanRenderer.staticDescriptorSets.resize(frameCount);
+		vulkanRenderer.anchoredDescriptorSets.resize(frameCount);
 
 #pragma region Descriptor Layout
-		VkDescriptorSetLayoutBinding layoutBinding[2] = {};
+		VkDescriptorSetLayoutBinding layoutBinding[3] = {};
 		layoutBinding[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
 		layoutBinding[0].descriptorCount = 1;
 		layoutBinding[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
@@ -63,9 +75,16 @@ namespace DRAW
 		layoutBinding[1].binding = 1;
 		layoutBinding[1].pImmutableSamplers = nullptr;
 
+		// material table, written once the level is loaded
+		layoutBinding[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		layoutBinding[2].descriptorCount = 1;
+		layoutBinding[2].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+		layoutBinding[2].binding = 2;
+		layoutBinding[2].pImmutableSamplers = nullptr;
+
 		VkDescriptorSetLayoutCreateInfo setCreateInfo = {};
 		setCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-		setCreateInfo.bindingCount = 2;
+		setCreateInfo.bindingCount = 3;
 		setCreateInfo.pBindings = layoutBinding;
 		setCreateInfo.flags = 0;
 		setCreateInfo.pNext = nullptr;
@@ -75,13 +94,14 @@ namespace DRAW
 #pragma region Descriptor Pool
 		VkDescriptorPoolCreateInfo descriptorpool_create_info = {};
 		descriptorpool_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		// a per-frame, a static and an anchored set for every frame
 		VkDescriptorPoolSize descriptorpool_size[2] = {
-			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, frameCount },
-			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frameCount }
+			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, frameCount * 3 },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frameCount * 6 }
 		};
 		descriptorpool_create_info.poolSizeCount = 2;
 		descriptorpool_create_info.pPoolSizes = descriptorpool_size;
-		descriptorpool_create_info.maxSets = frameCount;
+		descriptorpool_create_info.maxSets = frameCount * 3;
 		descriptorpool_create_info.flags = 0;
 		descriptorpool_create_info.pNext = nullptr;
 		vkCreateDescriptorPool(vulkanRenderer.device, &descriptorpool_create_info, nullptr, &vulkanRenderer.descriptorPool);
@@ -97,6 +117,8 @@ namespace DRAW
 		for (int i = 0; i < frameCount; i++)
 		{
 			vkAllocateDescriptorSets(vulkanRenderer.device, &allocateInfo, &vulkanRenderer.descriptorSets[i]);
+			vkAllocateDescriptorSets(vulkanRenderer.device, &allocateInfo, &vulkanRenderer.staticDescriptorSets[i]);
+			vkAllocateDescriptorSets(vulkanRenderer.device, &allocateInfo, &vulkanRenderer.anchoredDescriptorSets[i]);
 		}
 #pragma endregion
 
@@ -104,6 +126,8 @@ namespace DRAW
 		auto& storageBuffer = registry.emplace<VulkanGPUInstanceBuffer>(entity,
 			VulkanGPUInstanceBuffer{16}); // Start with a reasonable size of elements. The Buffer will grow if it needs to later
 		auto& uniformBuffer = registry.emplace<VulkanUniformBuffer>(entity);
+		registry.emplace<VulkanIndirectBuffer>(entity);
+		registry.emplace<VulkanAnchoredInstanceBuffer>(entity);
 
 		 
 		for (int i = 0; i < frameCount; i++)
@@ -127,29 +151,34 @@ namespace DRAW
 			storageWrite.descriptorCount = 1;
 			storageWrite.pBufferInfo = &storageBufferInfo;
 
-			VkWriteDescriptorSet descriptorWrites[] = { uniformWrite, storageWrite };
-			vkUpdateDescriptorSets(vulkanRenderer.device, 2, descriptorWrites, 0, nullptr);
+			VkWriteDescriptorSet staticUniformWrite = uniformWrite;
+			staticUniformWrite.dstSet = vulkanRenderer.staticDescriptorSets[i];
+			VkWriteDescriptorSet anchoredUniformWrite = uniformWrite;
+			anchoredUniformWrite.dstSet = vulkanRenderer.anchoredDescriptorSets[i];
+
+			VkWriteDescriptorSet descriptorWrites[] = { uniformWrite, storageWrite, staticUniformWrite, anchoredUniformWrite };
+			vkUpdateDescriptorSets(vulkanRenderer.device, 4, descriptorWrites, 0, nullptr);
 		}
 
 	}
 
-	void InitializeGraphicsPipeline(entt::registry& registry, entt::entity entity)
+	// Runs on a worker thread, touches nothing but what it is handed
+	static VkPipeline CreateGraphicsPipeline(VkDevice device, VkPipelineCache pipelineCache, VkRenderPass renderPass,
+		VkPipelineLayout pipelineLayout, VkShaderModule vertexShader, VkShaderModule fragmentShader,
+		unsigned int windowWidth, unsigned int windowHeight, bool packedVertices)
 	{
-		auto& vulkanRenderer = registry.get<VulkanRenderer>(entity);
-		GW::SYSTEM::GWindow win = registry.get<GW::SYSTEM::GWindow>(entity);
-
-		// Create Pipeline & Layout (Thanks Tiny!)
+		// Create Pipeline (Thanks Tiny!)
 		VkPipelineShaderStageCreateInfo stage_create_info[2] = {};
 		// Create Stage Info for Vertex Shader
 		stage_create_info[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 		stage_create_info[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-		stage_create_info[0].module = vulkanRenderer.vertexShader;
+		stage_create_info[0].module = vertexShader;
 		stage_create_info[0].pName = "main";
 
 		// Create Stage Info for Fragment Shader
 		stage_create_info[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 		stage_create_info[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-		stage_create_info[1].module = vulkanRenderer.fragmentShader;
+		stage_create_info[1].module = fragmentShader;
 		stage_create_info[1].pName = "main";
 
 		VkPipelineInputAssemblyStateCreateInfo assembly_create_info = {};
@@ -159,7 +188,7 @@ namespace DRAW
 
 		VkVertexInputBindingDescription vertex_binding_description = {};
 		vertex_binding_description.binding = 0;
-		vertex_binding_description.stride = sizeof(H2B::VERTEX);
+		vertex_binding_description.stride = packedVertices ? sizeof(PackedVertex) : sizeof(H2B::VERTEX);
 		vertex_binding_description.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
 		VkVertexInputAttributeDescription vertex_attribute_description[3];
@@ -178,6 +207,15 @@ namespace DRAW
 		vertex_attribute_description[2].format = VK_FORMAT_R32G32B32_SFLOAT;
 		vertex_attribute_description[2].offset = offsetof(H2B::VERTEX, nrm);
 
+		// both formats are core vertex formats, the shader gets the uv as float2 and decodes the normal itself
+		if (packedVertices) {
+			vertex_attribute_description[0].offset = offsetof(PackedVertex, pos);
+			vertex_attribute_description[1].format = VK_FORMAT_R16G16_SFLOAT;
+			vertex_attribute_description[1].offset = offsetof(PackedVertex, uv);
+			vertex_attribute_description[2].format = VK_FORMAT_R16G16_SNORM;
+			vertex_attribute_description[2].offset = offsetof(PackedVertex, normal);
+		}
+
 		VkPipelineVertexInputStateCreateInfo input_vertex_info = {};
 		input_vertex_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 		input_vertex_info.vertexBindingDescriptionCount = 1;
@@ -185,9 +223,6 @@ namespace DRAW
 		input_vertex_info.vertexAttributeDescriptionCount = 3;
 		input_vertex_info.pVertexAttributeDescriptions = vertex_attribute_description;
 
-		unsigned int windowWidth, windowHeight;
-		win.GetClientWidth(windowWidth);
-		win.GetClientHeight(windowHeight);
 		VkViewport viewport = CreateViewportFromWindowDimensions(windowWidth, windowHeight);
 
 		VkRect2D scissor = CreateScissorFromWindowDimensions(windowWidth, windowHeight);
@@ -264,17 +299,6 @@ namespace DRAW
 		dynamic_create_info.dynamicStateCount = 2;
 		dynamic_create_info.pDynamicStates = dynamic_states;
 
-		InitializeDescriptors(registry, entity);
-
-		VkPipelineLayoutCreateInfo pipeline_layout_create_info = {};
-		pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-		pipeline_layout_create_info.setLayoutCount = 1;
-		pipeline_layout_create_info.pSetLayouts = &vulkanRenderer.descriptorLayout;
-		pipeline_layout_create_info.pushConstantRangeCount = 0;
-		pipeline_layout_create_info.pPushConstantRanges = nullptr;
-
-		vkCreatePipelineLayout(vulkanRenderer.device, &pipeline_layout_create_info, nullptr, &vulkanRenderer.pipelineLayout);
-
 		// Pipeline State... (FINALLY) 
 		VkGraphicsPipelineCreateInfo pipeline_create_info = {};
 		pipeline_create_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
@@ -288,19 +312,49 @@ namespace DRAW
 		pipeline_create_info.pDepthStencilState = &depth_stencil_create_info;
 		pipeline_create_info.pColorBlendState = &color_blend_create_info;
 		pipeline_create_info.pDynamicState = &dynamic_create_info;
-		pipeline_create_info.layout = vulkanRenderer.pipelineLayout;
-		pipeline_create_info.renderPass = vulkanRenderer.renderPass;
+		pipeline_create_info.layout = pipelineLayout;
+		pipeline_create_info.renderPass = renderPass;
 		pipeline_create_info.subpass = 0;
 		pipeline_create_info.basePipelineHandle = VK_NULL_HANDLE;
 
-		vkCreateGraphicsPipelines(vulkanRenderer.device, VK_NULL_HANDLE, 1, &pipeline_create_info, nullptr, &vulkanRenderer.pipeline);
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		if (vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipeline_create_info, nullptr, &pipeline) != VK_SUCCESS) {
+			std::cout << "Failed to create graphics pipeline\n";
+			return VK_NULL_HANDLE;
+		}
+		return pipeline;
 	}
 
-	void InitializeTextPipeline(entt::registry& registry, entt::entity entity)
+	// Descriptors and layout are made here, the pipeline itself is built on a worker thread
+	// and picked up by CollectPipelines
+	void InitializeGraphicsPipeline(entt::registry& registry, entt::entity entity)
 	{
-		auto& vr = registry.get<VulkanRenderer>(entity);
-		VkDevice device = vr.device;
+		auto& vulkanRenderer = registry.get<VulkanRenderer>(entity);
+
+		InitializeDescriptors(registry, entity);
+
+		VkPipelineLayoutCreateInfo pipeline_layout_create_info = {};
+		pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipeline_layout_create_info.setLayoutCount = 1;
+		pipeline_layout_create_info.pSetLayouts = &vulkanRenderer.descriptorLayout;
+		pipeline_layout_create_info.pushConstantRangeCount = 0;
+		pipeline_layout_create_info.pPushConstantRanges = nullptr;
+
+		vkCreatePipelineLayout(vulkanRenderer.device, &pipeline_layout_create_info, nullptr, &vulkanRenderer.pipelineLayout);
+
+		unsigned int windowWidth, windowHeight;
+		GetRenderTargetSize(registry, entity, windowWidth, windowHeight);
+
+		auto& pipelineCache = registry.get<VulkanPipelineCache>(entity);
+		pipelineCache.scenePipeline = std::async(std::launch::async, CreateGraphicsPipeline, vulkanRenderer.device, pipelineCache.cache,
+			vulkanRenderer.renderPass, vulkanRenderer.pipelineLayout, vulkanRenderer.vertexShader, vulkanRenderer.fragmentShader,
+			windowWidth, windowHeight, vulkanRenderer.packedVertices);
+	}
 
+	// Runs on a worker thread, like CreateGraphicsPipeline
+	static VkPipeline CreateTextPipeline(VkDevice device, VkPipelineCache pipelineCache, VkRenderPass renderPass,
+		VkPipelineLayout layout, VkShaderModule vertexShader, VkShaderModule fragmentShader)
+	{
 		// Vertex layout: TextVertex { float x, y; float u, v; }
 		VkVertexInputBindingDescription binding{};
 		binding.binding = 0;
@@ -373,29 +427,15 @@ namespace DRAW
 		viewportState.scissorCount = 1;
 		viewportState.pScissors = nullptr; // dynamic
 
-		// No descriptors, no push constants
-		VkPipelineLayoutCreateInfo layoutInfo{};
-		layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-		layoutInfo.setLayoutCount = 0;
-		layoutInfo.pSetLayouts = nullptr;
-		layoutInfo.pushConstantRangeCount = 0;
-		layoutInfo.pPushConstantRanges = nullptr;
-
-		VkPipelineLayout layout = VK_NULL_HANDLE;
-		if (vkCreatePipelineLayout(device, &layoutInfo, nullptr, &layout) != VK_SUCCESS) {
-			std::cout << "Failed to create text pipeline layout\n";
-			return;
-		}
-
 		VkPipelineShaderStageCreateInfo stages[2]{};
 		stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 		stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-		stages[0].module = vr.textVertexShader;
+		stages[0].module = vertexShader;
 		stages[0].pName = "main";
 
 		stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 		stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-		stages[1].module = vr.textFragmentShader;
+		stages[1].module = fragmentShader;
 		stages[1].pName = "main";
 
 		VkGraphicsPipelineCreateInfo pipe{};
@@ -410,64 +450,94 @@ namespace DRAW
 		pipe.pDynamicState = &dynamic;
 		pipe.pViewportState = &viewportState;
 		pipe.layout = layout;
-		pipe.renderPass = vr.renderPass;
+		pipe.renderPass = renderPass;
 		pipe.subpass = 0;
 
 		VkPipeline pipeline = VK_NULL_HANDLE;
-		if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipe, nullptr, &pipeline) != VK_SUCCESS) {
+		if (vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipe, nullptr, &pipeline) != VK_SUCCESS) {
 			std::cout << "Failed to create text graphics pipeline\n";
-			vkDestroyPipelineLayout(device, layout, nullptr);
-			return;
+			return VK_NULL_HANDLE;
 		}
-
-		vr.textPipelineLayout = layout;
-		vr.textPipeline = pipeline;
+		return pipeline;
 	}
 
+	void InitializeTextPipeline(entt::registry& registry, entt::entity entity)
+	{
+		auto& vr = registry.get<VulkanRenderer>(entity);
 
-	//*** SYSTEMS ***//
+		// No descriptors, no push constants
+		VkPipelineLayoutCreateInfo layoutInfo{};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		layoutInfo.setLayoutCount = 0;
+		layoutInfo.pSetLayouts = nullptr;
+		layoutInfo.pushConstantRangeCount = 0;
+		layoutInfo.pPushConstantRanges = nullptr;
 
-	static uint32_t FindMemoryType(
-		VkPhysicalDevice physicalDevice,
-		uint32_t typeFilter,
-		VkMemoryPropertyFlags properties)
+		if (vkCreatePipelineLayout(vr.device, &layoutInfo, nullptr, &vr.textPipelineLayout) != VK_SUCCESS) {
+			std::cout << "Failed to create text pipeline layout\n";
+			vr.textPipelineLayout = VK_NULL_HANDLE;
+			return;
+		}
+
+		auto& pipelineCache = registry.get<VulkanPipelineCache>(entity);
+		pipelineCache.textPipeline = std::async(std::launch::async, CreateTextPipeline, vr.device, pipelineCache.cache,
+			vr.renderPass, vr.textPipelineLayout, vr.textVertexShader, vr.textFragmentShader);
+	}
+
+	// Takes whatever pipelines the workers have finished, true once the scene pipeline is usable.
+	// The first time everything is in, reports how long startup took.
+	static bool CollectPipelines(entt::registry& registry, entt::entity entity)
 	{
-		VkPhysicalDeviceMemoryProperties memProperties;
-		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+		auto& vr = registry.get<VulkanRenderer>(entity);
+		VulkanPipelineCache* pipelineCache = registry.try_get<VulkanPipelineCache>(entity);
+		if (!pipelineCache)
+			return vr.pipeline != VK_NULL_HANDLE;
 
-		for (uint32_t i = 0; i < memProperties.memoryTypeCount; ++i) {
-			if ((typeFilter & (1u << i)) &&
-				(memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-				return i;
-			}
+		auto ready = [](std::future<VkPipeline>& pending) {
+			return pending.valid() && pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+		};
+		bool collected = false;
+		if (ready(pipelineCache->scenePipeline)) {
+			vr.pipeline = pipelineCache->scenePipeline.get();
+			collected = true;
+		}
+		if (ready(pipelineCache->textPipeline)) {
+			vr.textPipeline = pipelineCache->textPipeline.get();
+			collected = true;
 		}
 
-		// If you want to be safer, you can assert/abort here instead
-		throw std::runtime_error("Failed to find suitable Vulkan memory type for text buffer.");
+		if (collected && !pipelineCache->scenePipeline.valid() && !pipelineCache->textPipeline.valid()) {
+			std::cout << "Startup: pipelines ready " << static_cast<int>(SecondsSince(pipelineCache->startupBegin) * 1000.0)
+				<< " ms after the renderer started (" << static_cast<int>(pipelineCache->constructSeconds * 1000.0) << " ms of it constructing on the main thread), "
+				<< (pipelineCache->loadedBytes ? "warm" : "cold") << " pipeline cache" << std::endl;
+		}
+		return vr.pipeline != VK_NULL_HANDLE;
 	}
 
-	// Helper: create or resize the text vertex buffer (host-visible)
+
+	//*** SYSTEMS ***//
+
+	// Helper: create or resize one frame's text vertex buffer (host-visible)
 	static void CreateOrResizeTextBuffer(
 		entt::registry& registry,
 		entt::entity entity,
+		unsigned int frame,
 		VkDeviceSize requiredSizeBytes)
 	{
 		auto& vr = registry.get<VulkanRenderer>(entity);
-		VkDevice device = vr.device;
 
 		// If we already have a buffer large enough, keep it
-		if (vr.textVertexBuffer != VK_NULL_HANDLE &&
-			requiredSizeBytes <= vr.textVertexCapacity) {
+		if (vr.textVertexBuffers[frame] != VK_NULL_HANDLE &&
+			requiredSizeBytes <= vr.textVertexCapacity[frame]) {
 			return;
 		}
 
-		// Destroy old buffer if it exists
-		if (vr.textVertexBuffer != VK_NULL_HANDLE) {
-			vkDestroyBuffer(device, vr.textVertexBuffer, nullptr);
-			vkFreeMemory(device, vr.textVertexMemory, nullptr);
-			vr.textVertexBuffer = VK_NULL_HANDLE;
-			vr.textVertexMemory = VK_NULL_HANDLE;
-			vr.textVertexCapacity = 0;
+		// Retire old buffer if it exists, the other frames keep theirs
+		if (vr.textVertexBuffers[frame] != VK_NULL_HANDLE) {
+			RetireBuffer(registry, entity, vr.textVertexBuffers[frame], vr.textVertexMemory[frame]);
+			vr.textVertexBuffers[frame] = VK_NULL_HANDLE;
+			vr.textVertexMemory[frame] = GPUAllocation{};
+			vr.textVertexCapacity[frame] = 0;
 		}
 
 		// Optionally pad size or grow by factor; for now, just use required size
@@ -477,40 +547,67 @@ namespace DRAW
 			newSize = sizeof(DRAW::TextVertex) * 256;
 		}
 
-		VkBufferCreateInfo bufInfo{};
-		bufInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-		bufInfo.size = newSize;
-		bufInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
-		bufInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		// host-visible and mapped for good, HUD text is rewritten every frame
+		CreateAllocatedBuffer(registry, entity, newSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			&vr.textVertexBuffers[frame], &vr.textVertexMemory[frame]);
+
+		vr.textVertexCapacity[frame] = newSize;
+	}
 
-		if (vkCreateBuffer(device, &bufInfo, nullptr, &vr.textVertexBuffer) != VK_SUCCESS) {
-			throw std::runtime_error("Failed to create text vertex buffer.");
+	// Called once StartFrame has handed back the current image, whatever that image's context
+	// submitted last time is finished now
+	static void BeginFrameContext(FrameTimeline& timeline, unsigned int image, double waitSeconds)
+	{
+		auto now = std::chrono::steady_clock::now();
+		if (timeline.currentFrame > 0) {
+			timeline.frameSeconds += std::chrono::duration<double>(now - timeline.lastFrameStart).count();
+			timeline.waitSeconds += waitSeconds;
+			++timeline.reportFrames;
 		}
+		else {
+			timeline.lastReport = now;
+		}
+		timeline.lastFrameStart = now;
 
-		VkMemoryRequirements memReq{};
-		vkGetBufferMemoryRequirements(device, vr.textVertexBuffer, &memReq);
+		FrameContext& context = timeline.contexts[image];
+		timeline.completedFrame = (std::max)(timeline.completedFrame, context.submittedFrame);
 
-		VkMemoryAllocateInfo allocInfo{};
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.allocationSize = memReq.size;
-		allocInfo.memoryTypeIndex = FindMemoryType(
-			vr.physicalDevice,
-			memReq.memoryTypeBits,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		++timeline.currentFrame;
+		timeline.currentContext = image;
+		context.submittedFrame = timeline.currentFrame;
+	}
 
-		if (vkAllocateMemory(device, &allocInfo, nullptr, &vr.textVertexMemory) != VK_SUCCESS) {
-			throw std::runtime_error("Failed to allocate memory for text vertex buffer.");
+	static void ReportFrameOverlap(FrameTimeline& timeline)
+	{
+		if (timeline.reportFrames == 0 || SecondsSince(timeline.lastReport) < timeline.reportInterval) {
+			return;
 		}
 
-		vkBindBufferMemory(device, vr.textVertexBuffer, vr.textVertexMemory, 0);
-
-		vr.textVertexCapacity = newSize;
+		double frameMs = timeline.frameSeconds * 1000.0 / timeline.reportFrames;
+		double waitMs = timeline.waitSeconds * 1000.0 / timeline.reportFrames;
+		double overlap = timeline.frameSeconds > 0.0 ? 100.0 * (1.0 - timeline.waitSeconds / timeline.frameSeconds) : 0.0;
+		double recordMs = timeline.recordSeconds * 1000.0 / timeline.reportFrames;
+		unsigned long long culled = timeline.culledInstances / timeline.reportFrames;
+		std::cout << "Renderer: " << frameMs << " ms/frame, " << waitMs << " ms waiting on the GPU, "
+			<< recordMs << " ms recording, " << overlap << "% CPU/GPU overlap, "
+			<< (timeline.currentFrame - timeline.completedFrame) << " frames in flight, "
+			<< culled << " instances culled" << std::endl;
+
+		timeline.frameSeconds = 0.0;
+		timeline.waitSeconds = 0.0;
+		timeline.recordSeconds = 0.0;
+		timeline.culledInstances = 0;
+		timeline.reportFrames = 0;
+		timeline.lastReport = std::chrono::steady_clock::now();
 	}
 
 	// run this code when a VulkanRenderer component is connected
 	void Construct_VulkanRenderer(entt::registry& registry, entt::entity entity)
 	{
-		if (!registry.all_of<GW::SYSTEM::GWindow>(entity))
+		auto constructStart = std::chrono::steady_clock::now();
+		VulkanOffscreenTarget* offscreen = registry.try_get<VulkanOffscreenTarget>(entity);
+		if (!offscreen && !registry.all_of<GW::SYSTEM::GWindow>(entity))
 		{
 			std::cout << "Window not added to the registry yet!" << std::endl;
 			abort();
@@ -527,155 +624,106 @@ namespace DRAW
 		auto& vulkanRenderer = registry.get<VulkanRenderer>(entity);
 		auto& initializationData = registry.get<VulkanRendererInitialization>(entity);
 
-		GW::SYSTEM::GWindow win = registry.get<GW::SYSTEM::GWindow>(entity);		
 #ifndef NDEBUG
-		const char* debugLayers[] = {
-			"VK_LAYER_KHRONOS_validation", // standard validation layer
-		};
-		if (-vulkanRenderer.vlkSurface.Create(win, GW::GRAPHICS::DEPTH_BUFFER_SUPPORT,
-			sizeof(debugLayers) / sizeof(debugLayers[0]),
-			debugLayers, 0, nullptr, 0, nullptr, false))
+		const bool validation = true;
 #else
-		if (-vulkanRenderer.vlkSurface.Create(win, GW::GRAPHICS::DEPTH_BUFFER_SUPPORT))
+		const bool validation = false;
 #endif
+		float aspectRatio;
+		if (offscreen)
 		{
-			std::cout << "Failed to create Vulkan Surface!" << std::endl;
-			abort();
-			return;
+			// headless: no window, no swapchain, the renderer makes its own device and images
+			if (!CreateOffscreenDevice(vulkanRenderer, *offscreen, validation))
+			{
+				std::cout << "Failed to create a Vulkan device for offscreen rendering!" << std::endl;
+				abort();
+				return;
+			}
+			aspectRatio = static_cast<float>(offscreen->width) / static_cast<float>(offscreen->height);
+		}
+		else
+		{
+			GW::SYSTEM::GWindow win = registry.get<GW::SYSTEM::GWindow>(entity);
+#ifndef NDEBUG
+			const char* debugLayers[] = {
+				"VK_LAYER_KHRONOS_validation", // standard validation layer
+			};
+			if (-vulkanRenderer.vlkSurface.Create(win, GW::GRAPHICS::DEPTH_BUFFER_SUPPORT,
+				sizeof(debugLayers) / sizeof(debugLayers[0]),
+				debugLayers, 0, nullptr, 0, nullptr, true)) // all supported features, same as release (multiDrawIndirect)
+#else
+			if (-vulkanRenderer.vlkSurface.Create(win, GW::GRAPHICS::DEPTH_BUFFER_SUPPORT))
+#endif
+			{
+				std::cout << "Failed to create Vulkan Surface!" << std::endl;
+				abort();
+				return;
+			}
+			vulkanRenderer.vlkSurface.GetAspectRatio(aspectRatio);
+
+			vulkanRenderer.vlkSurface.GetInstance((void**)&vulkanRenderer.instance);
+			vulkanRenderer.vlkSurface.GetDevice((void**)&vulkanRenderer.device);
+			vulkanRenderer.vlkSurface.GetPhysicalDevice((void**)&vulkanRenderer.physicalDevice);
+			vulkanRenderer.vlkSurface.GetRenderPass((void**)&vulkanRenderer.renderPass);
+			unsigned int presentFamily;
+			vulkanRenderer.vlkSurface.GetQueueFamilyIndices(vulkanRenderer.graphicsFamily, presentFamily);
+			vulkanRenderer.vlkSurface.GetGraphicsQueue((void**)&vulkanRenderer.graphicsQueue);
+			vulkanRenderer.vlkSurface.GetSwapchainImageCount(vulkanRenderer.frameCount);
 		}
 
 		vulkanRenderer.clrAndDepth[0].color = initializationData.clearColor;
 		vulkanRenderer.clrAndDepth[1].depthStencil = initializationData.depthStencil;
 
 		// Create Projection matrix
-		float aspectRatio;
-		vulkanRenderer.vlkSurface.GetAspectRatio(aspectRatio);
 		GW::MATH::GMatrix::ProjectionVulkanLHF(G2D_DEGREE_TO_RADIAN_F(initializationData.fovDegrees), aspectRatio, initializationData.nearPlane, initializationData.farPlane, vulkanRenderer.projMatrix);
 
-		
-		vulkanRenderer.vlkSurface.GetDevice((void**)&vulkanRenderer.device);
-		vulkanRenderer.vlkSurface.GetPhysicalDevice((void**)&vulkanRenderer.physicalDevice);
-		vulkanRenderer.vlkSurface.GetRenderPass((void**)&vulkanRenderer.renderPass);
-
-		// Intialize runtime shader compiler HLSL -> SPIRV
-		shaderc_compiler_t compiler = shaderc_compiler_initialize();
-		shaderc_compile_options_t options = shaderc_compile_options_initialize();
-		shaderc_compile_options_set_source_language(options, shaderc_source_language_hlsl);
-		shaderc_compile_options_set_invert_y(options, false);
-#ifndef NDEBUG
-		shaderc_compile_options_set_generate_debug_info(options);
-#endif
-
-		// Vertex Shader
-		std::string vertexShaderSource = ReadFileIntoString(initializationData.vertexShaderName.c_str());
-
-		shaderc_compilation_result_t result = shaderc_compile_into_spv( // compile
-			compiler, vertexShaderSource.c_str(), vertexShaderSource.length(),
-			shaderc_vertex_shader, "main.vert", "main", options);
-
-		if (shaderc_result_get_compilation_status(result) != shaderc_compilation_status_success) // errors?
+		// Gateware enables every supported feature, so supported here means usable
+		VkPhysicalDeviceFeatures deviceFeatures;
+		vkGetPhysicalDeviceFeatures(vulkanRenderer.physicalDevice, &deviceFeatures);
+		VkPhysicalDeviceProperties deviceProperties;
+		vkGetPhysicalDeviceProperties(vulkanRenderer.physicalDevice, &deviceProperties);
+		vulkanRenderer.multiDrawIndirect = deviceFeatures.multiDrawIndirect && deviceFeatures.drawIndirectFirstInstance;
+		vulkanRenderer.maxDrawIndirectCount = deviceProperties.limits.maxDrawIndirectCount;
+
+		// one frame context per swapchain image (or offscreen frame)
+		registry.emplace<FrameTimeline>(entity).contexts.resize(vulkanRenderer.frameCount);
+		registry.emplace<GPUMemoryAllocator>(entity);
+		if (offscreen && !CreateOffscreenFrames(vulkanRenderer, *offscreen))
 		{
-			std::cout << "Vertex Shader Errors : \n" << shaderc_result_get_error_message(result) << std::endl;
+			std::cout << "Failed to create the offscreen frames!" << std::endl;
 			abort();
 			return;
 		}
-
-		GvkHelper::create_shader_module(vulkanRenderer.device, shaderc_result_get_length(result), // load into Vulkan
-			(char*)shaderc_result_get_bytes(result), &vulkanRenderer.vertexShader);
-
-		shaderc_result_release(result); // done
-
-		// Fragment Shader
-		std::string fragmentShaderSource = ReadFileIntoString(initializationData.fragmentShaderName.c_str());
-
-		result = shaderc_compile_into_spv( // compile
-			compiler, fragmentShaderSource.c_str(), fragmentShaderSource.length(),
-			shaderc_fragment_shader, "main.frag", "main", options);
-
-		if (shaderc_result_get_compilation_status(result) != shaderc_compilation_status_success) // errors?
+		registry.emplace<VulkanTransferQueue>(entity);
+		// loaded from disk here, the pipelines below are built through it on worker threads
+		registry.emplace<VulkanPipelineCache>(entity).startupBegin = constructStart;
+		registry.emplace<VulkanCommandRecorder>(entity);
+		registry.emplace<RenderHandoff>(entity);
+
+		// the level's vertex format picks the scene pipeline's vertex input and the vertex shader variant
+		if (CPULevel* cpuLevel = registry.try_get<CPULevel>(entity))
+			vulkanRenderer.packedVertices = cpuLevel->packedVertices;
+
+		// SPIR-V comes from the shader cache, shaderc only starts up when an HLSL file changed
+		ShaderCompiler compiler;
+		std::vector<ShaderSource> shaderSources = RendererShaderSources(
+			initializationData.vertexShaderName, initializationData.fragmentShaderName, vulkanRenderer.packedVertices);
+		VkShaderModule* shaderModules[] = { &vulkanRenderer.vertexShader, &vulkanRenderer.fragmentShader,
+			&vulkanRenderer.textVertexShader, &vulkanRenderer.textFragmentShader };
+
+		for (size_t i = 0; i < shaderSources.size(); ++i)
 		{
-			std::cout << "Fragment Shader Errors : \n" << shaderc_result_get_error_message(result) << std::endl;
-			abort();
-			return;
-		}
-
-		GvkHelper::create_shader_module(vulkanRenderer.device, shaderc_result_get_length(result), // load into Vulkan
-			(char*)shaderc_result_get_bytes(result), &vulkanRenderer.fragmentShader);
-
-		shaderc_result_release(result); // done
-
-		// --- Text vertex shader ---
-		{
-			auto vsPath = ResolveAssetPath("Shaders/TextVertexShader.hlsl");
-			std::cout << "Text VS path: " << vsPath << std::endl;
-			std::string textVSsrc = ReadFileIntoString(vsPath.c_str());
-
-			result = shaderc_compile_into_spv(
-				compiler,
-				textVSsrc.c_str(),
-				textVSsrc.length(),
-				shaderc_vertex_shader,
-				"TextVertexShader.hlsl",
-				"main",
-				options
-			);
-
-			if (shaderc_result_get_compilation_status(result) != shaderc_compilation_status_success)
-			{
-				std::cout << "Text Vertex Shader Errors:\n"
-					<< shaderc_result_get_error_message(result) << std::endl;
-				abort();
-				return;
-			}
-
-			GvkHelper::create_shader_module(
-				vulkanRenderer.device,
-				shaderc_result_get_length(result),
-				(char*)shaderc_result_get_bytes(result),
-				&vulkanRenderer.textVertexShader
-			);
-
-			shaderc_result_release(result);
-		}
-
-		// --- Text pixel shader ---
-		{
-			auto psPath = ResolveAssetPath("Shaders/TextPixel.hlsl");
-			std::cout << "Text PS path: " << psPath << std::endl;
-			std::string textFSsrc = ReadFileIntoString(psPath.c_str());
-
-			result = shaderc_compile_into_spv(
-				compiler,
-				textFSsrc.c_str(),
-				textFSsrc.length(),
-				shaderc_fragment_shader,
-				"TextPixel.hlsl",
-				"main",
-				options
-			);
-
-			if (shaderc_result_get_compilation_status(result) != shaderc_compilation_status_success)
+			std::vector<char> spirv = LoadShaderSPIRV(compiler, shaderSources[i]);
+			if (spirv.empty())
 			{
-				std::cout << "Text Pixel Shader Errors:\n"
-					<< shaderc_result_get_error_message(result) << std::endl;
+				std::cout << "Failed to load shader " << shaderSources[i].path << std::endl;
 				abort();
 				return;
 			}
 
-			GvkHelper::create_shader_module(
-				vulkanRenderer.device,
-				shaderc_result_get_length(result),
-				(char*)shaderc_result_get_bytes(result),
-				&vulkanRenderer.textFragmentShader
-			);
-
-			shaderc_result_release(result);
+			GvkHelper::create_shader_module(vulkanRenderer.device, spirv.size(), spirv.data(), shaderModules[i]); // load into Vulkan
 		}
 
-		// Free runtime shader compiler resources
-		shaderc_compile_options_release(options);
-		shaderc_compiler_release(compiler);
-
 		InitializeGraphicsPipeline(registry, entity);
 
 		// Remove the initializtion data as we no longer need it
@@ -691,156 +739,304 @@ namespace DRAW
 		// Create text overlay pipeline (you still need to fill this in with real shaders)
 		InitializeTextPipeline(registry, entity);
 
-		// Create initial HUD text buffer
+		// Create initial HUD text buffers, one per frame context
 		VkDeviceSize initialBytes = sizeof(DRAW::TextVertex) * 512;
-		CreateOrResizeTextBuffer(registry, entity, initialBytes);
+		vulkanRenderer.textVertexBuffers.resize(vulkanRenderer.frameCount, VK_NULL_HANDLE);
+		vulkanRenderer.textVertexMemory.resize(vulkanRenderer.frameCount);
+		vulkanRenderer.textVertexCapacity.resize(vulkanRenderer.frameCount, 0);
+		for (unsigned int i = 0; i < vulkanRenderer.frameCount; ++i)
+			CreateOrResizeTextBuffer(registry, entity, i, initialBytes);
+
+		registry.get<VulkanPipelineCache>(entity).constructSeconds = SecondsSince(constructStart);
 	}
 
-	// run this code when a VulkanRenderer component is updated
-	void Update_VulkanRenderer(entt::registry& registry, entt::entity entity)
+	// Everything up to recording. Reads nothing but the renderer entity and the snapshot, the
+	// render thread runs it while the main thread waits.
+	bool BeginSnapshotFrame(entt::registry& registry, entt::entity entity, const RenderSnapshot& snapshot,
+		FrameSubmission& submission)
 	{
 		auto& vulkanRenderer = registry.get<VulkanRenderer>(entity);
+		VulkanOffscreenTarget* offscreen = registry.try_get<VulkanOffscreenTarget>(entity);
 
-		if (-vulkanRenderer.vlkSurface.StartFrame(2, vulkanRenderer.clrAndDepth))
+		// StartFrame only blocks when the GPU is a full swapchain behind
+		auto waitStart = std::chrono::steady_clock::now();
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		VkFramebuffer framebuffer = VK_NULL_HANDLE;
+		unsigned int frame;
+		if (offscreen)
 		{
-			std::cout << "Failed to start frame!" << std::endl;
-			return;
+			commandBuffer = BeginOffscreenFrame(vulkanRenderer, *offscreen);
+			frame = offscreen->current;
+			framebuffer = offscreen->frames[frame].framebuffer;
 		}
+		else
+		{
+			if (-vulkanRenderer.vlkSurface.StartFrame(2, vulkanRenderer.clrAndDepth))
+			{
+				std::cout << "Failed to start frame!" << std::endl;
+				return false;
+			}
+			vulkanRenderer.vlkSurface.GetSwapchainCurrentImage(frame);
+			vulkanRenderer.vlkSurface.GetCommandBuffer(frame, (void**)&commandBuffer);
+			vulkanRenderer.vlkSurface.GetSwapchainFramebuffer(frame, (void**)&framebuffer);
+		}
+		double startFrameWait = SecondsSince(waitStart);
+		vulkanRenderer.currentFrame = frame;
 
-		auto win = registry.get<GW::SYSTEM::GWindow>(entity);
-		unsigned int frame;
-		vulkanRenderer.vlkSurface.GetSwapchainCurrentImage(frame);
-
-		VkCommandBuffer commandBuffer;
-		unsigned int currentBuffer;
-		vulkanRenderer.vlkSurface.GetSwapchainCurrentImage(currentBuffer);
-		vulkanRenderer.vlkSurface.GetCommandBuffer(currentBuffer, (void**)&commandBuffer);
-
-		unsigned int windowWidth, windowHeight;
-		win.GetClientWidth(windowWidth);
-		win.GetClientHeight(windowHeight);
-		VkViewport viewport = CreateViewportFromWindowDimensions(windowWidth, windowHeight);
-		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+		auto& timeline = registry.get<FrameTimeline>(entity);
+		BeginFrameContext(timeline, frame, startFrameWait);
+		timeline.culledInstances += snapshot.culledInstances;
+		ReleaseRetiredBuffers(vulkanRenderer.device, registry.try_get<GPUMemoryAllocator>(entity), timeline, false);
+		PumpTransfers(registry, entity);
 
-		VkRect2D scissor = CreateScissorFromWindowDimensions(windowWidth, windowHeight);
-		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+		VkViewport viewport = CreateViewportFromWindowDimensions(snapshot.windowWidth, snapshot.windowHeight);
+		VkRect2D scissor = CreateScissorFromWindowDimensions(snapshot.windowWidth, snapshot.windowHeight);
 
-		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkanRenderer.pipeline);
+		// the pipelines are still being built on worker threads for the first few frames, only clear until then
+		bool pipelinesReady = CollectPipelines(registry, entity);
 
 		// Update uniform and storage buffers
+		if (SceneData* sceneData = registry.try_get<SceneData>(entity))
+		{
+			sceneData->camPos = snapshot.camera.row4;
+			GW::MATH::GMatrix::InverseF(snapshot.camera, sceneData->viewMatrix);
+			sceneData->motionTime = static_cast<float>(snapshot.motionTime);
+		}
 		registry.patch<VulkanUniformBuffer>(entity);
 
-		// TODO: Build draw instructions
+		// Everything that touches the registry happens here, each pass only captures the handles it draws with
+		auto& recorder = registry.get<VulkanCommandRecorder>(entity);
 
 		// Check for presence of the buffers first as they take a few frames before they are created
-		if (registry.all_of< VulkanVertexBuffer, VulkanIndexBuffer>(entity))
+		DrawTable* drawTable = registry.ctx().find<DrawTable>();
+		if (pipelinesReady && drawTable && registry.all_of< VulkanVertexBuffer, VulkanIndexBuffer, VulkanMaterialBuffer>(entity))
 		{
 			auto& vertexBuffer = registry.get<VulkanVertexBuffer>(entity);
 			auto& indexBuffer = registry.get<VulkanIndexBuffer>(entity);
 
-			std::map<GeometryData, int> geometryData;
-
-			if (vertexBuffer.buffer != VK_NULL_HANDLE && indexBuffer.buffer != VK_NULL_HANDLE)
+			// level geometry streams in through the transfer queue, draw nothing until it is all there
+			if (vertexBuffer.buffer != VK_NULL_HANDLE && indexBuffer.buffer != VK_NULL_HANDLE &&
+				IsUploadComplete(registry, entity, vertexBuffer.uploadId) && IsUploadComplete(registry, entity, indexBuffer.uploadId))
 			{
-				VkDeviceSize offsets[] = { 0 };
-				vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer.buffer, offsets);
-				vkCmdBindIndexBuffer(commandBuffer, indexBuffer.buffer, 0, VkIndexType::VK_INDEX_TYPE_UINT32);
-
-				auto group = registry.group<GeometryData>(entt::get<GPUInstance>, entt::exclude<DoNotRender>);
-				group.sort<GeometryData>([](const GeometryData& a, const GeometryData& b) {
-					return a < b;
-					});
+				VkPipeline scenePipeline = vulkanRenderer.pipeline;
+				VkPipelineLayout sceneLayout = vulkanRenderer.pipelineLayout;
+				VkBuffer sceneVertices = vertexBuffer.buffer;
+				VkBuffer sceneIndices = indexBuffer.buffer;
+				VkIndexType sceneIndexType = indexBuffer.indexType;
+				auto bindScene = [=](VkCommandBuffer secondary, VkDescriptorSet descriptorSet) {
+					VkDeviceSize offsets[] = { 0 };
+					vkCmdBindPipeline(secondary, VK_PIPELINE_BIND_POINT_GRAPHICS, scenePipeline);
+					vkCmdBindVertexBuffers(secondary, 0, 1, &sceneVertices, offsets);
+					vkCmdBindIndexBuffer(secondary, sceneIndices, 0, sceneIndexType);
+					vkCmdBindDescriptorSets(secondary, VK_PIPELINE_BIND_POINT_GRAPHICS, sceneLayout, 0, 1, &descriptorSet, 0, nullptr);
+				};
+
+				// static level geometry, nothing to upload
+				VulkanStaticInstanceBuffer* staticBuffer = registry.try_get<VulkanStaticInstanceBuffer>(entity);
+				if (staticBuffer && staticBuffer->instances != VK_NULL_HANDLE && IsUploadComplete(registry, entity, staticBuffer->uploadId)) {
+					VkDescriptorSet staticSet = vulkanRenderer.staticDescriptorSets[frame];
+					VkBuffer staticCommands = staticBuffer->commands;
+					unsigned int staticDrawCount = staticBuffer->drawCount;
+					bool staticIndirect = vulkanRenderer.multiDrawIndirect && staticDrawCount <= vulkanRenderer.maxDrawIndirectCount;
+					// only written at level load
+					const std::vector<DrawSlot>* staticSlots = &drawTable->staticSlots;
+
+					recorder.passes[static_cast<int>(RecordPass::StaticScene)] = [=](VkCommandBuffer secondary) {
+						bindScene(secondary, staticSet);
+						if (staticIndirect) {
+							vkCmdDrawIndexedIndirect(secondary, staticCommands, 0, staticDrawCount, sizeof(VkDrawIndexedIndirectCommand));
+						}
+						else {
+							for (const DrawSlot& slot : *staticSlots) {
+								vkCmdDrawIndexed(secondary, slot.geometry.indexCount, slot.instanceCount,
+									slot.geometry.indexStart, slot.geometry.vertexStart, slot.firstInstance);
+							}
+						}
+					};
+				}
 
-				std::vector<GPUInstance> gpuInstances;
+				// straight-line movers, this frame's copy is only rewritten when something was (re-)anchored
+				if (snapshot.anchored && !snapshot.anchored->instances.empty()) {
+					auto& anchoredBuffer = registry.get<VulkanAnchoredInstanceBuffer>(entity);
+					anchoredBuffer.region = snapshot.anchored;
+					registry.patch<VulkanAnchoredInstanceBuffer>(entity);
+
+					VkDescriptorSet anchoredSet = vulkanRenderer.anchoredDescriptorSets[frame];
+					VkBuffer anchoredCommands = anchoredBuffer.commands[frame];
+					std::shared_ptr<const AnchoredRegion> anchored = snapshot.anchored;
+					unsigned int anchoredDrawCount = static_cast<unsigned int>(anchored->slots.size());
+					bool anchoredIndirect = vulkanRenderer.multiDrawIndirect && anchoredDrawCount <= vulkanRenderer.maxDrawIndirectCount;
+
+					recorder.passes[static_cast<int>(RecordPass::AnchoredScene)] = [=](VkCommandBuffer secondary) {
+						bindScene(secondary, anchoredSet);
+						if (anchoredIndirect) {
+							vkCmdDrawIndexedIndirect(secondary, anchoredCommands, 0, anchoredDrawCount, sizeof(VkDrawIndexedIndirectCommand));
+						}
+						else {
+							for (const DrawSlot& slot : anchored->slots) {
+								vkCmdDrawIndexed(secondary, slot.geometry.indexCount, slot.instanceCount,
+									slot.geometry.indexStart, slot.geometry.vertexStart, slot.firstInstance);
+							}
+						}
+					};
+				}
 
-				for (auto [meshEntity, geometry, gpuInstance] : group.each()) {
-					gpuInstances.push_back(gpuInstance);
-					geometryData[geometry] += 1;
+				// the snapshot already sorted everything that moves into draws, nearest first
+				// with everything culled there is no indirect buffer to point at, the loop below draws nothing instead
+				unsigned int slotCount = static_cast<unsigned int>(snapshot.slots.size());
+				bool drawIndirect = vulkanRenderer.multiDrawIndirect && slotCount > 0 && slotCount <= vulkanRenderer.maxDrawIndirectCount;
+				VkBuffer indirectBuffer = VK_NULL_HANDLE;
+				if (drawIndirect) {
+					registry.get<VulkanIndirectBuffer>(entity).required_count = slotCount;
+					registry.patch<VulkanIndirectBuffer>(entity);
+					VkDrawIndexedIndirectCommand* drawCommands = registry.get<VulkanIndirectBuffer>(entity).mapped[frame];
+					indirectBuffer = registry.get<VulkanIndirectBuffer>(entity).buffer[frame];
+
+					for (unsigned int slot = 0; slot < slotCount; ++slot) {
+						const DrawSlot& drawSlot = snapshot.slots[slot];
+						drawCommands[slot] = VkDrawIndexedIndirectCommand{
+							drawSlot.geometry.indexCount,
+							drawSlot.instanceCount,
+							drawSlot.geometry.indexStart,
+							static_cast<int32_t>(drawSlot.geometry.vertexStart),
+							drawSlot.firstInstance
+						};
+					}
 				}
-				registry.emplace_or_replace<std::vector<GPUInstance>>(entity, std::move(gpuInstances));
-				registry.patch<VulkanGPUInstanceBuffer>(entity);
-			}
 
-			// TODO: Update buffers here before the bind of the descriptor sets
+				// grow this frame's instance buffer if needed, then copy the packed instances into it
+				registry.get<VulkanGPUInstanceBuffer>(entity).required_count = snapshot.instances.size();
+				registry.patch<VulkanGPUInstanceBuffer>(entity);
+				if (!snapshot.instances.empty()) {
+					std::memcpy(registry.get<VulkanGPUInstanceBuffer>(entity).mapped[frame], snapshot.instances.data(),
+						sizeof(GPUInstanceData) * snapshot.instances.size());
+				}
 
-			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkanRenderer.pipelineLayout, 0, 1, &vulkanRenderer.descriptorSets[frame], 0, nullptr);
+				VkDescriptorSet dynamicSet = vulkanRenderer.descriptorSets[frame];
+				// the snapshot is not reused until this frame is recorded
+				const std::vector<DrawSlot>* dynamicSlots = &snapshot.slots;
+				recorder.passes[static_cast<int>(RecordPass::DynamicScene)] = [=](VkCommandBuffer secondary) {
+					bindScene(secondary, dynamicSet);
+					if (drawIndirect) {
+						vkCmdDrawIndexedIndirect(secondary, indirectBuffer, 0, slotCount, sizeof(VkDrawIndexedIndirectCommand));
+						return;
+					}
 
-			// TODO: Draw all the things that need drawing
-			int instanceOffset = 0;
-			for (auto& [geometry, instanceCount] : geometryData) {
-				vkCmdDrawIndexed(
-					commandBuffer,
-					geometry.indexCount,
-					instanceCount,
-					geometry.indexStart,
-					geometry.vertexStart,
-					instanceOffset
-				);
+					// no multi-draw support, one call per batch
+					for (const DrawSlot& slot : *dynamicSlots) {
+						if (slot.instanceCount == 0) {
+							continue;
+						}
 
-				instanceOffset += instanceCount;
+						vkCmdDrawIndexed(
+							secondary,
+							slot.geometry.indexCount,
+							slot.instanceCount,
+							slot.geometry.indexStart,
+							slot.geometry.vertexStart,
+							slot.firstInstance
+						);
+					}
+				};
 			}
 		}
 
-		if (registry.ctx().contains<DRAW::TextRenderer>() &&
-			registry.ctx().contains<GAME::HUDData>() &&
-			vulkanRenderer.textPipeline != VK_NULL_HANDLE)
+		if (vulkanRenderer.textPipeline != VK_NULL_HANDLE && !snapshot.hudText.empty())
 		{
-			auto& tr = registry.ctx().get<DRAW::TextRenderer>();
-			auto& hud = registry.ctx().get<GAME::HUDData>();
-
-			if (!hud.text.empty()) {
-				std::vector<DRAW::TextVertex> verts =
-					DRAW::BuildTextMesh(
-						tr.font,
-						hud.text,
-						hud.x,
-						hud.y
-					);
-
-				if (!verts.empty()) {
-					VkDevice device = vulkanRenderer.device;
-					VkDeviceSize neededBytes =
-						static_cast<VkDeviceSize>(verts.size() * sizeof(DRAW::TextVertex));
-
-					CreateOrResizeTextBuffer(registry, entity, neededBytes);
-
-					if (vulkanRenderer.textVertexBuffer != VK_NULL_HANDLE) {
-						void* mapped = nullptr;
-						if (vkMapMemory(device, vulkanRenderer.textVertexMemory,
-							0, neededBytes, 0, &mapped) == VK_SUCCESS)
-						{
-							std::memcpy(mapped, verts.data(), static_cast<size_t>(neededBytes));
-							vkUnmapMemory(device, vulkanRenderer.textVertexMemory);
-
-							vkCmdBindPipeline(
-								commandBuffer,
-								VK_PIPELINE_BIND_POINT_GRAPHICS,
-								vulkanRenderer.textPipeline
-							);
-
-							VkBuffer buffers[] = { vulkanRenderer.textVertexBuffer };
-							VkDeviceSize offsets[] = { 0 };
-							vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
-
-							vkCmdDraw(
-								commandBuffer,
-								static_cast<uint32_t>(verts.size()),
-								1,
-								0,
-								0
-							);
-						}
-					}
+			VkDeviceSize neededBytes =
+				static_cast<VkDeviceSize>(snapshot.hudText.size() * sizeof(DRAW::TextVertex));
+
+			CreateOrResizeTextBuffer(registry, entity, frame, neededBytes);
+
+			if (vulkanRenderer.textVertexBuffers[frame] != VK_NULL_HANDLE) {
+				void* mapped = vulkanRenderer.textVertexMemory[frame].mapped;
+				if (mapped != nullptr)
+				{
+					std::memcpy(mapped, snapshot.hudText.data(), static_cast<size_t>(neededBytes));
+
+					VkPipeline textPipeline = vulkanRenderer.textPipeline;
+					VkBuffer textVertices = vulkanRenderer.textVertexBuffers[frame];
+					uint32_t textVertexCount = static_cast<uint32_t>(snapshot.hudText.size());
+					recorder.passes[static_cast<int>(RecordPass::HUD)] = [=](VkCommandBuffer secondary) {
+						vkCmdBindPipeline(
+							secondary,
+							VK_PIPELINE_BIND_POINT_GRAPHICS,
+							textPipeline
+						);
+
+						VkDeviceSize offsets[] = { 0 };
+						vkCmdBindVertexBuffers(secondary, 0, 1, &textVertices, offsets);
+
+						vkCmdDraw(
+							secondary,
+							textVertexCount,
+							1,
+							0,
+							0
+						);
+					};
 				}
 			}
 		}
-		vulkanRenderer.vlkSurface.EndFrame(true);
+
+		// fetched last, HUD drawing above may have added components to this entity
+		submission.renderer = &vulkanRenderer;
+		submission.recorder = &registry.get<VulkanCommandRecorder>(entity);
+		submission.timeline = &registry.get<FrameTimeline>(entity);
+		submission.offscreen = offscreen;
+		submission.commandBuffer = commandBuffer;
+		submission.framebuffer = framebuffer;
+		submission.image = frame;
+		submission.viewport = viewport;
+		submission.scissor = scissor;
+		return true;
+	}
+
+	void EndSnapshotFrame(FrameSubmission& submission)
+	{
+		// BeginOffscreenFrame's pass takes secondaries recorded on the job pool, StartFrame's only inline commands
+		auto recordStart = std::chrono::steady_clock::now();
+		VkSubpassContents contents = submission.offscreen ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE;
+		ExecuteRecordedPasses(*submission.renderer, *submission.recorder, submission.commandBuffer, contents,
+			submission.image, submission.framebuffer, submission.viewport, submission.scissor);
+		double recordSeconds = SecondsSince(recordStart);
+		submission.timeline->recordSeconds += recordSeconds;
+
+		auto waitStart = std::chrono::steady_clock::now();
+		if (submission.offscreen)
+			EndOffscreenFrame(*submission.renderer, *submission.offscreen, recordSeconds);
+		else
+			submission.renderer->vlkSurface.EndFrame(true);
+		submission.timeline->waitSeconds += SecondsSince(waitStart);
+		ReportFrameOverlap(*submission.timeline);
+	}
+
+	// run this code when a VulkanRenderer component is updated
+	void Update_VulkanRenderer(entt::registry& registry, entt::entity entity)
+	{
+		auto& handoff = registry.get<RenderHandoff>(entity);
+		if (handoff.thread.joinable())
+		{
+			PublishRenderSnapshot(registry, entity);
+			return;
+		}
+
+		// no render thread, the snapshot is drawn straight away
+		RenderSnapshot& snapshot = handoff.shared->snapshots[0];
+		ExtractRenderSnapshot(registry, entity, snapshot);
+		FrameSubmission submission;
+		if (BeginSnapshotFrame(registry, entity, snapshot, submission))
+		{
+			EndSnapshotFrame(submission);
+		}
 	}
 
 	// run this code when a VulkanRenderer component is updated
 	void Destroy_VulkanRenderer(entt::registry& registry, entt::entity entity)
 	{
 		auto& vulkanRenderer = registry.get<VulkanRenderer>(entity);
+		// joins the render thread, if there is one, before anything it draws with goes away
+		registry.remove<RenderHandoff>(entity);
 		// wait till everything has completed
 		vkDeviceWaitIdle(vulkanRenderer.device);
 
@@ -848,17 +1044,31 @@ namespace DRAW
 		registry.remove<VulkanIndexBuffer>(entity);
 		registry.remove<VulkanVertexBuffer>(entity);
 		registry.remove<VulkanGPUInstanceBuffer>(entity);
+		registry.remove<VulkanIndirectBuffer>(entity);
+		registry.remove<VulkanMaterialBuffer>(entity);
+		registry.remove<VulkanStaticInstanceBuffer>(entity);
+		registry.remove<VulkanAnchoredInstanceBuffer>(entity);
 		registry.remove<VulkanUniformBuffer>(entity);
+		registry.remove<VulkanTransferQueue>(entity);
+		registry.remove<VulkanCommandRecorder>(entity);
 
-		// Text rendering cleanup
-		if (vulkanRenderer.textVertexBuffer != VK_NULL_HANDLE) {
-			vkDestroyBuffer(vulkanRenderer.device, vulkanRenderer.textVertexBuffer, nullptr);
-			vulkanRenderer.textVertexBuffer = VK_NULL_HANDLE;
+		// the device is idle, nothing retired above needs to wait
+		if (FrameTimeline* timeline = registry.try_get<FrameTimeline>(entity)) {
+			ReleaseRetiredBuffers(vulkanRenderer.device, registry.try_get<GPUMemoryAllocator>(entity), *timeline, true);
 		}
-		if (vulkanRenderer.textVertexMemory != VK_NULL_HANDLE) {
-			vkFreeMemory(vulkanRenderer.device, vulkanRenderer.textVertexMemory, nullptr);
-			vulkanRenderer.textVertexMemory = VK_NULL_HANDLE;
+
+		// Text rendering cleanup
+		for (size_t i = 0; i < vulkanRenderer.textVertexBuffers.size(); ++i) {
+			if (vulkanRenderer.textVertexBuffers[i] != VK_NULL_HANDLE) {
+				DestroyAllocatedBuffer(registry, entity, vulkanRenderer.textVertexBuffers[i], vulkanRenderer.textVertexMemory[i]);
+				vulkanRenderer.textVertexBuffers[i] = VK_NULL_HANDLE;
+				vulkanRenderer.textVertexMemory[i] = GPUAllocation{};
+			}
 		}
+		// every buffer is gone, release the blocks they lived in
+		registry.remove<GPUMemoryAllocator>(entity);
+		// waits on any pipeline still being built and saves the cache for the next run
+		registry.remove<VulkanPipelineCache>(entity);
 		if (vulkanRenderer.textPipeline != VK_NULL_HANDLE) {
 			vkDestroyPipeline(vulkanRenderer.device, vulkanRenderer.textPipeline, nullptr);
 			vulkanRenderer.textPipeline = VK_NULL_HANDLE;
@@ -884,6 +1094,28 @@ namespace DRAW
 		vkDestroyShaderModule(vulkanRenderer.device, vulkanRenderer.fragmentShader, nullptr);
 		vkDestroyPipelineLayout(vulkanRenderer.device, vulkanRenderer.pipelineLayout, nullptr);
 		vkDestroyPipeline(vulkanRenderer.device, vulkanRenderer.pipeline, nullptr);
+
+		// Gateware releases its own device with the surface, a headless renderer's goes last, after its images
+		if (vulkanRenderer.headless) {
+			registry.remove<VulkanOffscreenTarget>(entity);
+			vkDestroyDevice(vulkanRenderer.device, nullptr);
+			vkDestroyInstance(vulkanRenderer.instance, nullptr);
+			vulkanRenderer.device = nullptr;
+			vulkanRenderer.instance = VK_NULL_HANDLE;
+		}
+	}
+
+	// registry.clear() may take the timeline before the renderer, don't lose what is still queued
+	void Destroy_FrameTimeline(entt::registry& registry, entt::entity entity)
+	{
+		auto& timeline = registry.get<FrameTimeline>(entity);
+		VulkanRenderer* vulkanRenderer = registry.try_get<VulkanRenderer>(entity);
+		if (timeline.retired.empty() || !vulkanRenderer || vulkanRenderer->device == nullptr) {
+			return;
+		}
+
+		vkDeviceWaitIdle(vulkanRenderer->device);
+		ReleaseRetiredBuffers(vulkanRenderer->device, registry.try_get<GPUMemoryAllocator>(entity), timeline, true);
 	}
 
 
@@ -893,6 +1125,7 @@ namespace DRAW
 		registry.on_construct<VulkanRenderer>().connect<Construct_VulkanRenderer>();
 		registry.on_update<VulkanRenderer>().connect<Update_VulkanRenderer>();
 		registry.on_destroy<VulkanRenderer>().connect<Destroy_VulkanRenderer>();
+		registry.on_destroy<FrameTimeline>().connect<Destroy_FrameTimeline>();
 	}
 
 } // namespace DRAW
\ No newline at end of file
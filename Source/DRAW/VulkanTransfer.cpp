@@ -0,0 +1,226 @@
+#include "DrawComponents.h"
+#include "../CCL.h"
+#include <cstring>
+
+namespace DRAW
+{
+	//*** HELPERS ***//
+	// Contiguous bytes free at the head of the ring
+	static VkDeviceSize ContiguousFree(VulkanTransferQueue& transfer)
+	{
+		if (transfer.used == 0)
+		{
+			transfer.head = transfer.tail = 0;
+			return transfer.stagingSize;
+		}
+		if (transfer.head > transfer.tail)
+			return transfer.stagingSize - transfer.head;
+		return transfer.tail - transfer.head; // 0 when head caught up with tail, the ring is full
+	}
+
+	// Frees the ring space of every batch that has finished, oldest first
+	static void CollectBatches(VkDevice device, VulkanTransferQueue& transfer)
+	{
+		for (unsigned int i = 0; i < transfer.batches.size(); ++i)
+		{
+			VulkanTransferQueue::Batch& batch = transfer.batches[(transfer.nextBatch + i) % transfer.batches.size()];
+			if (!batch.inFlight)
+				continue;
+			if (vkGetFenceStatus(device, batch.fence) != VK_SUCCESS)
+				break; // later batches were submitted after this one
+
+			transfer.tail = batch.ringEnd;
+			transfer.used -= batch.ringBytes;
+			transfer.completedUploadId = (std::max)(transfer.completedUploadId, batch.lastUploadId);
+			batch.inFlight = false;
+		}
+	}
+
+	unsigned long long QueueBufferUpload(entt::registry& registry, entt::entity rendererEntity,
+		VkBuffer destination, VkDeviceSize destinationOffset, const void* data, VkDeviceSize size)
+	{
+		auto& transfer = registry.get<VulkanTransferQueue>(rendererEntity);
+		if (size == 0)
+			return 0; // nothing to wait for
+
+		VulkanTransferQueue::PendingUpload upload;
+		upload.destination = destination;
+		upload.destinationOffset = destinationOffset;
+		upload.data.assign(static_cast<const unsigned char*>(data), static_cast<const unsigned char*>(data) + size);
+		upload.uploadId = ++transfer.lastUploadId;
+		transfer.pending.push_back(std::move(upload));
+		return transfer.lastUploadId;
+	}
+
+	bool IsUploadComplete(entt::registry& registry, entt::entity rendererEntity, unsigned long long uploadId)
+	{
+		VulkanTransferQueue* transfer = registry.try_get<VulkanTransferQueue>(rendererEntity);
+		return !transfer || uploadId <= transfer->completedUploadId;
+	}
+
+	void CancelBufferUploads(entt::registry& registry, entt::entity rendererEntity, VkBuffer destination)
+	{
+		VulkanTransferQueue* transfer = registry.try_get<VulkanTransferQueue>(rendererEntity);
+		if (!transfer)
+			return;
+
+		// chunks already submitted are fine, the buffer is retired behind the frame that follows them
+		for (auto it = transfer->pending.begin(); it != transfer->pending.end();)
+		{
+			if (it->destination == destination)
+				it = transfer->pending.erase(it);
+			else
+				++it;
+		}
+	}
+
+	void PumpTransfers(entt::registry& registry, entt::entity rendererEntity)
+	{
+		auto& transfer = registry.get<VulkanTransferQueue>(rendererEntity);
+		auto& renderer = registry.get<VulkanRenderer>(rendererEntity);
+
+		CollectBatches(renderer.device, transfer);
+		if (transfer.pending.empty())
+			return;
+
+		VulkanTransferQueue::Batch& batch = transfer.batches[transfer.nextBatch];
+		if (batch.inFlight)
+			return; // every batch is busy, try again next frame
+
+		bool recording = false;
+		VkDeviceSize batchStart = transfer.used;
+		while (!transfer.pending.empty())
+		{
+			VulkanTransferQueue::PendingUpload& upload = transfer.pending.front();
+			VkDeviceSize remaining = upload.data.size() - upload.copied;
+
+			VkDeviceSize contiguous = ContiguousFree(transfer);
+			if (contiguous == 0 && transfer.head > transfer.tail && transfer.tail > 0)
+			{
+				// wrap around, the skipped end of the ring is freed together with this batch
+				transfer.used += transfer.stagingSize - transfer.head;
+				transfer.head = 0;
+				contiguous = ContiguousFree(transfer);
+			}
+			if (contiguous == 0)
+				break; // ring full until earlier batches finish
+
+			if (!recording)
+			{
+				VkCommandBufferBeginInfo beginInfo = {};
+				beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+				beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+				vkResetCommandBuffer(batch.commandBuffer, 0);
+				vkBeginCommandBuffer(batch.commandBuffer, &beginInfo);
+				recording = true;
+			}
+
+			VkDeviceSize chunk = (std::min)(remaining, contiguous);
+			std::memcpy(transfer.staging + transfer.head, upload.data.data() + upload.copied, chunk);
+
+			VkBufferCopy region = { transfer.head, upload.destinationOffset + upload.copied, chunk };
+			vkCmdCopyBuffer(batch.commandBuffer, transfer.stagingBuffer, upload.destination, 1, &region);
+
+			transfer.head += chunk;
+			transfer.used += chunk;
+			upload.copied += chunk;
+			if (upload.copied < upload.data.size())
+				continue;
+
+			batch.lastUploadId = upload.uploadId;
+			transfer.pending.pop_front();
+		}
+
+		if (!recording)
+			return;
+
+		// make the copies visible to whatever reads the buffers afterwards on this queue
+		VkMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+		vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+			0, 1, &barrier, 0, nullptr, 0, nullptr);
+		vkEndCommandBuffer(batch.commandBuffer);
+
+		VkSubmitInfo submitInfo = {};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &batch.commandBuffer;
+		vkResetFences(renderer.device, 1, &batch.fence);
+		vkQueueSubmit(transfer.queue, 1, &submitInfo, batch.fence);
+
+		batch.ringEnd = transfer.head;
+		batch.ringBytes = transfer.used - batchStart;
+		batch.inFlight = true;
+		transfer.nextBatch = (transfer.nextBatch + 1) % transfer.batches.size();
+	}
+
+	//*** SYSTEMS ***//
+	void Construct_VulkanTransferQueue(entt::registry& registry, entt::entity entity)
+	{
+		auto& transfer = registry.get<VulkanTransferQueue>(entity);
+		auto& renderer = registry.get<VulkanRenderer>(entity);
+
+		transfer.queue = renderer.graphicsQueue;
+
+		VkCommandPoolCreateInfo poolInfo = {};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+		poolInfo.queueFamilyIndex = renderer.graphicsFamily;
+		vkCreateCommandPool(renderer.device, &poolInfo, nullptr, &transfer.commandPool);
+
+		// a batch per frame context is enough, pumping happens once a frame
+		transfer.batches.resize(renderer.frameCount);
+		for (VulkanTransferQueue::Batch& batch : transfer.batches)
+		{
+			VkCommandBufferAllocateInfo allocateInfo = {};
+			allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocateInfo.commandPool = transfer.commandPool;
+			allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			allocateInfo.commandBufferCount = 1;
+			vkAllocateCommandBuffers(renderer.device, &allocateInfo, &batch.commandBuffer);
+
+			VkFenceCreateInfo fenceInfo = {};
+			fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+			vkCreateFence(renderer.device, &fenceInfo, nullptr, &batch.fence);
+		}
+
+		CreateAllocatedBuffer(registry, entity, transfer.stagingSize,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+			VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &transfer.stagingBuffer, &transfer.stagingMemory);
+		transfer.staging = transfer.stagingMemory.mapped;
+	}
+
+	void Destroy_VulkanTransferQueue(entt::registry& registry, entt::entity entity)
+	{
+		auto& transfer = registry.get<VulkanTransferQueue>(entity);
+		VulkanRenderer* renderer = registry.try_get<VulkanRenderer>(entity);
+		if (!renderer || renderer->device == nullptr)
+			return;
+
+		for (VulkanTransferQueue::Batch& batch : transfer.batches)
+		{
+			if (batch.inFlight)
+				vkWaitForFences(renderer->device, 1, &batch.fence, VK_TRUE, UINT64_MAX);
+			vkDestroyFence(renderer->device, batch.fence, nullptr);
+		}
+		transfer.batches.clear();
+		transfer.pending.clear();
+
+		// freeing the pool frees its command buffers
+		vkDestroyCommandPool(renderer->device, transfer.commandPool, nullptr);
+		DestroyAllocatedBuffer(registry, entity, transfer.stagingBuffer, transfer.stagingMemory);
+		transfer.commandPool = VK_NULL_HANDLE;
+		transfer.stagingBuffer = VK_NULL_HANDLE;
+		transfer.stagingMemory = GPUAllocation{};
+		transfer.staging = nullptr;
+	}
+
+	// Use this MACRO to connect the EnTT Component Logic
+	CONNECT_COMPONENT_LOGIC() {
+		registry.on_construct<VulkanTransferQueue>().connect<Construct_VulkanTransferQueue>();
+		registry.on_destroy<VulkanTransferQueue>().connect<Destroy_VulkanTransferQueue>();
+	}
+
+} // namespace DRAW
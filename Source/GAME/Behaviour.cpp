@@ -0,0 +1,337 @@
+#include "../UTIL/Utilities.h"
+#include "GameComponents.h"
+#include "Behaviour.h"
+#include "../CCL.h"
+
+namespace GAME
+{
+	//*** Frame pool ***//
+
+	int BehaviourFramePool::SizeClass(size_t size)
+	{
+		for (size_t i = 0; i < classCount; ++i)
+		{
+			if (size <= classSizes[i])
+			{
+				return static_cast<int>(i);
+			}
+		}
+		return -1;
+	}
+
+	void* BehaviourFramePool::Allocate(size_t size)
+	{
+		int sizeClass = SizeClass(size);
+		if (sizeClass < 0)
+		{
+			return ::operator new(size); //bigger than any script should be, don't pool it
+		}
+
+		std::vector<void*>& freeList = freeBlocks[sizeClass];
+		if (freeList.empty())
+		{
+			//carve a new chunk into blocks of this class
+			size_t blockSize = classSizes[sizeClass];
+			chunks.push_back(std::make_unique<std::byte[]>(blockSize * blocksPerChunk));
+			std::byte* chunk = chunks.back().get();
+			for (size_t i = 0; i < blocksPerChunk; ++i)
+			{
+				freeList.push_back(chunk + blockSize * i);
+			}
+		}
+
+		void* block = freeList.back();
+		freeList.pop_back();
+		return block;
+	}
+
+	void BehaviourFramePool::Free(void* block, size_t size)
+	{
+		int sizeClass = SizeClass(size);
+		if (sizeClass < 0)
+		{
+			::operator delete(block);
+			return;
+		}
+		freeBlocks[sizeClass].push_back(block);
+	}
+
+	void BehaviourPromise::operator delete(void* frame, size_t size)
+	{
+		void* block = static_cast<std::byte*>(frame) - alignof(std::max_align_t);
+		BehaviourFramePool* pool = *static_cast<BehaviourFramePool**>(block);
+		pool->Free(block, size + alignof(std::max_align_t));
+	}
+
+
+	//*** Scheduler ***//
+
+	BehaviourScheduler::~BehaviourScheduler()
+	{
+		for (Slot& slot : slots)
+		{
+			if (slot.frame)
+			{
+				slot.frame.destroy();
+			}
+		}
+	}
+
+	BehaviourHandle BehaviourScheduler::Start(BehaviourTask task)
+	{
+		uint32_t index;
+		if (!freeSlots.empty())
+		{
+			index = freeSlots.back();
+			freeSlots.pop_back();
+		}
+		else
+		{
+			index = static_cast<uint32_t>(slots.size());
+			slots.emplace_back();
+		}
+
+		Slot& slot = slots[index];
+		slot.frame = task.Release();
+		slot.running = false;
+		slot.cancelRequested = false;
+
+		BehaviourHandle handle{ index, slot.generation };
+		slot.frame.promise().self = handle;
+
+		Resume(handle);
+		return handle;
+	}
+
+	bool BehaviourScheduler::IsRunning(BehaviourHandle handle) const
+	{
+		return handle.index < slots.size()
+			&& slots[handle.index].generation == handle.generation
+			&& slots[handle.index].frame;
+	}
+
+	void BehaviourScheduler::Cancel(BehaviourHandle handle)
+	{
+		if (!IsRunning(handle))
+		{
+			return; //already finished or cancelled
+		}
+
+		Slot& slot = slots[handle.index];
+		if (slot.running)
+		{
+			//a script cancelling itself, its frame goes once it suspends
+			slot.cancelRequested = true;
+			return;
+		}
+		Release(handle.index);
+	}
+
+	void BehaviourScheduler::Release(uint32_t index)
+	{
+		Slot& slot = slots[index];
+		slot.frame.destroy();
+		slot.frame = nullptr;
+		slot.running = false;
+		slot.cancelRequested = false;
+
+		//a script cancelled while waiting on an arrival leaves no entry behind
+		if (slot.arrivalEntity != entt::null)
+		{
+			auto waiter = arrivalWaiters.find(slot.arrivalEntity);
+			if (waiter != arrivalWaiters.end() && waiter->second.index == index && waiter->second.generation == slot.generation)
+			{
+				arrivalWaiters.erase(waiter);
+			}
+			slot.arrivalEntity = entt::null;
+		}
+
+		//any timer or waiter still holding the old generation is now ignored
+		++slot.generation;
+		freeSlots.push_back(index);
+	}
+
+	void BehaviourScheduler::Resume(BehaviourHandle handle)
+	{
+		if (!IsRunning(handle))
+		{
+			return;
+		}
+
+		slots[handle.index].running = true;
+		slots[handle.index].frame.resume();
+
+		//the script may have started others, so slots could have reallocated
+		Slot& slot = slots[handle.index];
+		slot.running = false;
+		if (slot.frame.done() || slot.cancelRequested)
+		{
+			Release(handle.index);
+		}
+	}
+
+	void BehaviourScheduler::AddTimer(BehaviourHandle handle, float seconds)
+	{
+		timers.push(Timer{ now + (std::max)(seconds, 0.0f), timerOrder++, handle });
+	}
+
+	void BehaviourScheduler::AddArrivalWaiter(BehaviourHandle handle, entt::entity entity)
+	{
+		arrivalWaiters[entity] = handle;
+		slots[handle.index].arrivalEntity = entity;
+	}
+
+	void BehaviourScheduler::AddEventWaiter(BehaviourHandle handle, PlayerEvent event)
+	{
+		eventWaiters[static_cast<int>(event)].push_back(handle);
+	}
+
+	bool BehaviourScheduler::NotifyArrival(entt::entity entity)
+	{
+		auto waiter = arrivalWaiters.find(entity);
+		if (waiter == arrivalWaiters.end())
+		{
+			return false;
+		}
+
+		BehaviourHandle handle = waiter->second;
+		arrivalWaiters.erase(waiter);
+		if (!IsRunning(handle))
+		{
+			return false; //the script waiting on it was cancelled
+		}
+
+		slots[handle.index].arrivalEntity = entt::null;
+		ready.push_back(handle);
+		return true;
+	}
+
+	void BehaviourScheduler::CancelArrivalWaiter(entt::entity entity)
+	{
+		auto waiter = arrivalWaiters.find(entity);
+		if (waiter == arrivalWaiters.end())
+		{
+			return;
+		}
+
+		BehaviourHandle handle = waiter->second;
+		arrivalWaiters.erase(waiter);
+		Cancel(handle);
+	}
+
+	void BehaviourScheduler::RaisePlayerEvent(PlayerEvent event)
+	{
+		std::vector<BehaviourHandle>& waiters = eventWaiters[static_cast<int>(event)];
+		ready.insert(ready.end(), waiters.begin(), waiters.end());
+		waiters.clear();
+	}
+
+	void BehaviourScheduler::Update(float deltaTime)
+	{
+		now += deltaTime;
+
+		//collect first, scripts that wait again (even for 0 seconds) are picked up next frame
+		resuming.swap(ready);
+		while (!timers.empty() && timers.top().wakeTime <= now)
+		{
+			resuming.push_back(timers.top().handle);
+			timers.pop();
+		}
+
+		for (BehaviourHandle handle : resuming)
+		{
+			Resume(handle);
+		}
+		resuming.clear();
+	}
+
+
+	//*** Helpers ***//
+
+	BehaviourHandle StartBehaviour(entt::registry& registry, BehaviourTask task)
+	{
+		return registry.ctx().get<GAME::BehaviourScheduler>().Start(std::move(task));
+	}
+
+	void CancelBehaviour(entt::registry& registry, BehaviourHandle handle)
+	{
+		if (GAME::BehaviourScheduler* scheduler = registry.ctx().find<GAME::BehaviourScheduler>())
+		{
+			scheduler->Cancel(handle);
+		}
+	}
+
+	void StartEnemyScript(entt::registry& registry, entt::entity enemy, BehaviourTask task)
+	{
+		if (GAME::EnemyScript* current = registry.try_get<GAME::EnemyScript>(enemy))
+		{
+			CancelBehaviour(registry, current->handle);
+		}
+
+		BehaviourHandle handle = StartBehaviour(registry, std::move(task));
+		registry.emplace_or_replace<GAME::EnemyScript>(enemy, handle);
+	}
+
+	void RunBehaviours(entt::registry& registry)
+	{
+		GAME::BehaviourScheduler* scheduler = registry.ctx().find<GAME::BehaviourScheduler>();
+		UTIL::DeltaTime* deltaTimeComponent = registry.ctx().find<UTIL::DeltaTime>();
+		if (!scheduler || !deltaTimeComponent)
+		{
+			return;
+		}
+
+		if (GAME::FlightPathLibrary* library = registry.ctx().find<GAME::FlightPathLibrary>())
+		{
+			for (entt::entity arrived : library->arrivals)
+			{
+				if (!scheduler->NotifyArrival(arrived) && registry.valid(arrived))
+				{
+					//nobody is steering it any more, stop re-reporting the arrival every frame
+					registry.remove<GAME::PathFollower>(arrived);
+				}
+			}
+			library->arrivals.clear();
+		}
+
+		scheduler->Update(static_cast<float>(deltaTimeComponent->dtSec));
+	}
+
+
+	//*** Component logic ***//
+
+	void Destroy_EnemyScript(entt::registry& registry, entt::entity entity)
+	{
+		CancelBehaviour(registry, registry.get<GAME::EnemyScript>(entity).handle);
+
+		//a script steering this enemy from elsewhere would otherwise wait on it for the rest of the session
+		if (GAME::BehaviourScheduler* scheduler = registry.ctx().find<GAME::BehaviourScheduler>())
+		{
+			scheduler->CancelArrivalWaiter(entity);
+		}
+	}
+
+	void Construct_PlayerEvents(entt::registry& registry, entt::entity entity)
+	{
+		if (GAME::BehaviourScheduler* scheduler = registry.ctx().find<GAME::BehaviourScheduler>())
+		{
+			scheduler->RaisePlayerEvent(PlayerEvent::Spawned);
+		}
+	}
+
+	void Destroy_PlayerEvents(entt::registry& registry, entt::entity entity)
+	{
+		if (GAME::BehaviourScheduler* scheduler = registry.ctx().find<GAME::BehaviourScheduler>())
+		{
+			scheduler->RaisePlayerEvent(PlayerEvent::Died);
+		}
+	}
+
+	CONNECT_COMPONENT_LOGIC()
+	{
+		registry.on_destroy<GAME::EnemyScript>().connect<Destroy_EnemyScript>();
+		registry.on_construct<GAME::Player>().connect<Construct_PlayerEvents>();
+		registry.on_destroy<GAME::Player>().connect<Destroy_PlayerEvents>();
+	}
+
+}
@@ -0,0 +1,223 @@
+#ifndef BEHAVIOUR_H_
+#define BEHAVIOUR_H_
+
+#include "GameComponents.h"
+#include <coroutine>
+#include <queue>
+#include <unordered_map>
+#include <memory>
+#include <utility>
+
+namespace GAME
+{
+	///*** Behaviour scripts ***///
+	// A script is a C++20 coroutine taking (entt::registry&, ...) that co_awaits time, arrival
+	// or player events. While it waits it costs nothing, the scheduler only resumes the scripts
+	// whose wait finished. Coroutine frames come from a per-registry pool, not the heap.
+
+	enum class PlayerEvent
+	{
+		Spawned,
+		Died,
+		Count
+	};
+
+
+	/// Fixed size-class free lists for coroutine frames. Each registry owns one,
+	/// so batch games on different threads never share it.
+	class BehaviourFramePool
+	{
+	public:
+		BehaviourFramePool() = default;
+		BehaviourFramePool(const BehaviourFramePool&) = delete;
+		BehaviourFramePool& operator=(const BehaviourFramePool&) = delete;
+
+		void* Allocate(size_t size);
+		void Free(void* block, size_t size);
+
+	private:
+		static constexpr size_t classSizes[] = { 128, 256, 512, 1024 };
+		static constexpr size_t classCount = sizeof(classSizes) / sizeof(classSizes[0]);
+		static constexpr size_t blocksPerChunk = 32;
+
+		static int SizeClass(size_t size);
+
+		std::vector<void*> freeBlocks[classCount];
+		std::vector<std::unique_ptr<std::byte[]>> chunks;
+	};
+
+
+	class BehaviourScheduler;
+
+	struct BehaviourPromise;
+
+	/// Return type of every script. Owns the frame until it is handed to StartBehaviour.
+	class BehaviourTask
+	{
+	public:
+		using promise_type = BehaviourPromise;
+
+		explicit BehaviourTask(std::coroutine_handle<BehaviourPromise> frame) : frame(frame) {}
+		BehaviourTask(BehaviourTask&& other) noexcept : frame(std::exchange(other.frame, nullptr)) {}
+		BehaviourTask& operator=(BehaviourTask&&) = delete;
+		BehaviourTask(const BehaviourTask&) = delete;
+		~BehaviourTask() { if (frame) frame.destroy(); }
+
+		std::coroutine_handle<BehaviourPromise> Release() { return std::exchange(frame, nullptr); }
+
+	private:
+		std::coroutine_handle<BehaviourPromise> frame;
+	};
+
+	struct BehaviourPromise
+	{
+		entt::registry* registry = nullptr;
+		BehaviourHandle self;
+
+		// scripts always take the registry first, it tells the frame which pool to come from
+		template<typename... Args>
+		BehaviourPromise(entt::registry& registry, Args&...) : registry(&registry) {}
+
+		template<typename... Args>
+		static void* operator new(size_t size, entt::registry& registry, Args&...);
+		static void operator delete(void* frame, size_t size);
+
+		BehaviourTask get_return_object() { return BehaviourTask(std::coroutine_handle<BehaviourPromise>::from_promise(*this)); }
+		std::suspend_always initial_suspend() noexcept { return {}; }
+		std::suspend_always final_suspend() noexcept { return {}; }
+		void return_void() {}
+		void unhandled_exception() { std::terminate(); }
+	};
+
+
+	/// Owns every running script of one registry (lives in the registry context)
+	class BehaviourScheduler
+	{
+	public:
+		BehaviourScheduler() : pool(std::make_unique<BehaviourFramePool>()) {}
+		~BehaviourScheduler();
+		BehaviourScheduler(const BehaviourScheduler&) = delete;
+		BehaviourScheduler& operator=(const BehaviourScheduler&) = delete;
+		BehaviourScheduler(BehaviourScheduler&&) = default;
+		BehaviourScheduler& operator=(BehaviourScheduler&&) = default;
+
+		/// Runs the script up to its first co_await
+		BehaviourHandle Start(BehaviourTask task);
+		/// Destroys the script's frame, stale handles are ignored
+		void Cancel(BehaviourHandle handle);
+		bool IsRunning(BehaviourHandle handle) const;
+
+		/// Advances script time and resumes every script whose wait is over
+		void Update(float deltaTime);
+
+		/// Called by the awaitables when a script suspends
+		void AddTimer(BehaviourHandle handle, float seconds);
+		void AddArrivalWaiter(BehaviourHandle handle, entt::entity entity);
+		void AddEventWaiter(BehaviourHandle handle, PlayerEvent event);
+
+		/// Wakes the script waiting on this entity, returns false when nobody waits on it
+		bool NotifyArrival(entt::entity entity);
+		/// Drops the script waiting on this entity and destroys its frame, for entities destroyed mid-path
+		void CancelArrivalWaiter(entt::entity entity);
+		void RaisePlayerEvent(PlayerEvent event);
+
+		BehaviourFramePool& Pool() { return *pool; }
+
+	private:
+		struct Slot
+		{
+			std::coroutine_handle<BehaviourPromise> frame;
+			uint32_t generation = 0;
+			bool running = false;
+			bool cancelRequested = false;
+			entt::entity arrivalEntity = entt::null; //what the suspended frame waits on, released frames drop the waiter
+		};
+		struct Timer
+		{
+			double wakeTime;
+			uint64_t order; //keeps scripts that wake on the same frame in the order they went to sleep
+			BehaviourHandle handle;
+			bool operator>(const Timer& other) const
+			{
+				return wakeTime != other.wakeTime ? wakeTime > other.wakeTime : order > other.order;
+			}
+		};
+
+		void Resume(BehaviourHandle handle);
+		void Release(uint32_t index);
+
+		//declared first so it outlives every frame destroyed below it
+		std::unique_ptr<BehaviourFramePool> pool;
+
+		std::vector<Slot> slots;
+		std::vector<uint32_t> freeSlots;
+
+		double now = 0.0;
+		uint64_t timerOrder = 0;
+		std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers;
+		std::unordered_map<entt::entity, BehaviourHandle> arrivalWaiters;
+		std::vector<BehaviourHandle> eventWaiters[static_cast<int>(PlayerEvent::Count)];
+		std::vector<BehaviourHandle> ready;
+		std::vector<BehaviourHandle> resuming;
+	};
+
+
+	template<typename... Args>
+	void* BehaviourPromise::operator new(size_t size, entt::registry& registry, Args&...)
+	{
+		//the pool pointer is kept in front of the frame, operator delete only gets the size
+		BehaviourFramePool* pool = &registry.ctx().get<BehaviourScheduler>().Pool();
+		void* block = pool->Allocate(size + alignof(std::max_align_t));
+		*static_cast<BehaviourFramePool**>(block) = pool;
+		return static_cast<std::byte*>(block) + alignof(std::max_align_t);
+	}
+
+
+	//*** Awaitables ***//
+	struct WaitSeconds
+	{
+		float seconds;
+
+		bool await_ready() const noexcept { return false; }
+		void await_suspend(std::coroutine_handle<BehaviourPromise> frame) const
+		{
+			frame.promise().registry->ctx().get<BehaviourScheduler>().AddTimer(frame.promise().self, seconds);
+		}
+		void await_resume() const noexcept {}
+	};
+
+	/// Resumes once the entity's PathFollower reaches the end of its path
+	struct WaitArrival
+	{
+		entt::entity entity;
+
+		bool await_ready() const noexcept { return false; }
+		void await_suspend(std::coroutine_handle<BehaviourPromise> frame) const
+		{
+			frame.promise().registry->ctx().get<BehaviourScheduler>().AddArrivalWaiter(frame.promise().self, entity);
+		}
+		void await_resume() const noexcept {}
+	};
+
+	struct WaitPlayerEvent
+	{
+		PlayerEvent event;
+
+		bool await_ready() const noexcept { return false; }
+		void await_suspend(std::coroutine_handle<BehaviourPromise> frame) const
+		{
+			frame.promise().registry->ctx().get<BehaviourScheduler>().AddEventWaiter(frame.promise().self, event);
+		}
+		void await_resume() const noexcept {}
+	};
+
+
+	//*** Helpers ***//
+	BehaviourHandle StartBehaviour(entt::registry& registry, BehaviourTask task);
+	/// Replaces whatever script was driving the enemy
+	void StartEnemyScript(entt::registry& registry, entt::entity enemy, BehaviourTask task);
+	/// Hands this frame's path arrivals to the scripts waiting on them, then resumes due scripts
+	void RunBehaviours(entt::registry& registry);
+
+} // namespace GAME
+#endif // !BEHAVIOUR_H_
@@ -0,0 +1,317 @@
+#include "../UTIL/Utilities.h"
+#include "../DRAW/DrawComponents.h"
+#include "GameComponents.h"
+#include "../CCL.h"
+
+namespace GAME
+{
+	///uniform Catmull-Rom point between p1 and p2
+	static float CatmullRom(float p0, float p1, float p2, float p3, float t)
+	{
+		float t2 = t * t;
+		float t3 = t2 * t;
+		return 0.5f * ((2.0f * p1)
+			+ (-p0 + p2) * t
+			+ (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2
+			+ (-p0 + 3.0f * p1 - 3.0f * p2 + p3) * t3);
+	}
+
+
+	///runs a Catmull-Rom spline through the control points and resamples it every `spacing` units of arc length
+	static FlightPath BuildPath(const std::vector<float>& controlX, const std::vector<float>& controlZ, float spacing)
+	{
+		const int stepsPerSegment = 16;
+		int count = static_cast<int>(controlX.size());
+
+		//dense polyline along the spline (end points repeated so the curve passes through them)
+		std::vector<float> denseX;
+		std::vector<float> denseZ;
+		std::vector<float> denseLength;
+		for (int segment = 0; segment + 1 < count; ++segment)
+		{
+			int i0 = (std::max)(segment - 1, 0);
+			int i3 = (std::min)(segment + 2, count - 1);
+			for (int step = 0; step < stepsPerSegment; ++step)
+			{
+				float t = step / float(stepsPerSegment);
+				denseX.push_back(CatmullRom(controlX[i0], controlX[segment], controlX[segment + 1], controlX[i3], t));
+				denseZ.push_back(CatmullRom(controlZ[i0], controlZ[segment], controlZ[segment + 1], controlZ[i3], t));
+			}
+		}
+		denseX.push_back(controlX.back());
+		denseZ.push_back(controlZ.back());
+
+		denseLength.push_back(0.0f);
+		for (size_t i = 1; i < denseX.size(); ++i)
+		{
+			float dx = denseX[i] - denseX[i - 1];
+			float dz = denseZ[i] - denseZ[i - 1];
+			denseLength.push_back(denseLength.back() + std::sqrt(dx * dx + dz * dz));
+		}
+
+		//equal arc length samples, the last one lands exactly on the final control point
+		FlightPath path;
+		path.length = denseLength.back();
+		int samples = (std::max)(int(std::ceil(path.length / spacing)), 1);
+		float actualSpacing = path.length / samples;
+		path.invSpacing = actualSpacing > 0.0f ? 1.0f / actualSpacing : 0.0f;
+
+		size_t dense = 1;
+		for (int i = 0; i <= samples; ++i)
+		{
+			float target = (std::min)(i * actualSpacing, path.length);
+			while (dense + 1 < denseLength.size() && denseLength[dense] < target)
+			{
+				++dense;
+			}
+			float segmentLength = denseLength[dense] - denseLength[dense - 1];
+			float t = segmentLength > 0.0f ? (target - denseLength[dense - 1]) / segmentLength : 0.0f;
+			path.x.push_back(denseX[dense - 1] + (denseX[dense] - denseX[dense - 1]) * t);
+			path.z.push_back(denseZ[dense - 1] + (denseZ[dense] - denseZ[dense - 1]) * t);
+		}
+
+		return path;
+	}
+
+
+	void BuildFlightPaths(entt::registry& registry)
+	{
+		std::shared_ptr<const GameConfig> config = registry.ctx().get<UTIL::Config>().gameConfig;
+
+		if (registry.ctx().find<GAME::FlightPathLibrary>())
+		{
+			registry.ctx().erase<GAME::FlightPathLibrary>();
+		}
+		GAME::FlightPathLibrary& library = registry.ctx().emplace<GAME::FlightPathLibrary>();
+
+		float midX = (*config).at("WaveInfo").at("MidPointX").as<float>();
+		float midZ = (*config).at("WaveInfo").at("MidPointZ").as<float>();
+		float radius = (*config).at("WaveInfo").at("MidPointRadius").as<float>();
+		int numOfSpawns = (*config).at("WaveInfo").at("numberOfSpawns").as<int>();
+
+		float spacing = 0.25f;
+		auto spacingSetting = (*config).at("WaveInfo").find("pathSampleSpacing");
+		if (spacingSetting != (*config).at("WaveInfo").end())
+		{
+			spacing = (std::max)(spacingSetting->second.as<float>(), 0.01f);
+		}
+
+		const int loopPoints = 8;
+		const float pi = 3.14159265f;
+
+		for (int spawn = 0; spawn < numOfSpawns; ++spawn)
+		{
+			float spawnX = (*config).at("WaveInfo").at(std::to_string(spawn) + "SpawnX").as<float>();
+			float spawnZ = (*config).at("WaveInfo").at(std::to_string(spawn) + "SpawnZ").as<float>();
+
+			//loop keeps going the way the enemy entered, around a circle sitting on top of the midpoint
+			float direction = (midX - spawnX) > 0.0f ? 1.0f : -1.0f;
+			float centerZ = midZ + radius;
+
+			std::vector<float> controlX = { spawnX, midX };
+			std::vector<float> controlZ = { spawnZ, midZ };
+			for (int i = 1; i <= loopPoints; ++i)
+			{
+				float angle = -0.5f * pi + (2.0f * pi * i) / loopPoints;
+				controlX.push_back(midX + direction * radius * std::cos(angle));
+				controlZ.push_back(centerZ + radius * std::sin(angle));
+			}
+			//last loop point is the midpoint again, snap away float error
+			controlX.back() = midX;
+			controlZ.back() = midZ;
+
+			library.paths.push_back(BuildPath(controlX, controlZ, spacing));
+		}
+	}
+
+
+	void StartEntryPath(entt::registry& registry, entt::entity entity, int spawnIndex, float destX, float destZ)
+	{
+		GAME::FlightPathLibrary* library = registry.ctx().find<GAME::FlightPathLibrary>();
+		if (!library || spawnIndex < 0 || spawnIndex >= static_cast<int>(library->paths.size()))
+		{
+			StartPathLeg(registry, entity, destX, destZ);
+			return;
+		}
+
+		const GAME::FlightPath& path = library->paths[spawnIndex];
+
+		GAME::PathFollower follower;
+		follower.pathIndex = spawnIndex;
+		follower.legStartX = path.x.back();
+		follower.legStartZ = path.z.back();
+		follower.legEndX = destX;
+		follower.legEndZ = destZ;
+		follower.legLength = std::sqrt((destX - follower.legStartX) * (destX - follower.legStartX)
+			+ (destZ - follower.legStartZ) * (destZ - follower.legStartZ));
+		follower.totalLength = path.length + follower.legLength;
+
+		GAME::Enemy* enemy = registry.try_get<GAME::Enemy>(entity);
+		follower.speed = enemy ? enemy->speed : 0.0f;
+
+		registry.emplace_or_replace<GAME::PathFollower>(entity, follower);
+	}
+
+
+	void StartPathLeg(entt::registry& registry, entt::entity entity, float destX, float destZ)
+	{
+		GAME::Transform* transform = registry.try_get<GAME::Transform>(entity);
+		if (!transform)
+		{
+			return;
+		}
+
+		GAME::PathFollower follower;
+		follower.pathIndex = -1;
+		follower.legStartX = transform->transformMatrix.row4.x;
+		follower.legStartZ = transform->transformMatrix.row4.z;
+		follower.legEndX = destX;
+		follower.legEndZ = destZ;
+		follower.legLength = std::sqrt((destX - follower.legStartX) * (destX - follower.legStartX)
+			+ (destZ - follower.legStartZ) * (destZ - follower.legStartZ));
+		follower.totalLength = follower.legLength;
+
+		GAME::Enemy* enemy = registry.try_get<GAME::Enemy>(entity);
+		follower.speed = enemy ? enemy->speed : 0.0f;
+
+		registry.emplace_or_replace<GAME::PathFollower>(entity, follower);
+	}
+
+
+	void UpdatePathFollowers(entt::registry& registry)
+	{
+		GAME::FlightPathLibrary* library = registry.ctx().find<GAME::FlightPathLibrary>();
+		UTIL::DeltaTime* deltaTimeComponent = registry.ctx().find<UTIL::DeltaTime>();
+		if (!library || !deltaTimeComponent)
+		{
+			return;
+		}
+		float deltaTime = static_cast<float>(deltaTimeComponent->dtSec);
+
+		library->arrivals.clear();
+
+		auto followerView = registry.view<GAME::PathFollower>();
+		size_t count = followerView.size();
+		if (count == 0)
+		{
+			return;
+		}
+
+		library->entities.resize(count);
+		library->distances.resize(count);
+		library->positionsX.resize(count);
+		library->positionsZ.resize(count);
+
+
+		///pass 1: advance, clamped to the end of the path so nothing overshoots
+		size_t n = 0;
+		for (auto [entity, follower] : followerView.each())
+		{
+			follower.distance = (std::min)(follower.distance + follower.speed * deltaTime, follower.totalLength);
+			library->entities[n] = entity;
+			library->distances[n] = follower.distance;
+			++n;
+		}
+
+
+		///pass 2: evaluate, a table lookup + lerp per follower regardless of the pattern
+		n = 0;
+		for (auto [entity, follower] : followerView.each())
+		{
+			float distance = library->distances[n];
+			float x;
+			float z;
+
+			const GAME::FlightPath* path = follower.pathIndex >= 0 ? &library->paths[follower.pathIndex] : nullptr;
+			if (path && distance < path->length)
+			{
+				float sample = distance * path->invSpacing;
+				size_t index = (std::min)(static_cast<size_t>(sample), path->x.size() - 2);
+				float t = sample - index;
+				x = path->x[index] + (path->x[index + 1] - path->x[index]) * t;
+				z = path->z[index] + (path->z[index + 1] - path->z[index]) * t;
+			}
+			else
+			{
+				float legDistance = distance - (path ? path->length : 0.0f);
+				float t = follower.legLength > 0.0f ? (std::min)(legDistance / follower.legLength, 1.0f) : 1.0f;
+				x = follower.legStartX + (follower.legEndX - follower.legStartX) * t;
+				z = follower.legStartZ + (follower.legEndZ - follower.legStartZ) * t;
+			}
+
+			library->positionsX[n] = x;
+			library->positionsZ[n] = z;
+			++n;
+		}
+
+
+		///pass 3: scatter to transforms and meshes
+		std::shared_ptr<const GameConfig> config = registry.ctx().get<UTIL::Config>().gameConfig;
+		float tilt = (*config).at("WaveInfo").at("enemyMovementRot").as<float>();
+		auto gpuInstanceView = registry.view<DRAW::GPUInstance>();
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			entt::entity entity = library->entities[i];
+			GAME::Transform* transform = registry.try_get<GAME::Transform>(entity);
+			if (!transform)
+			{
+				continue;
+			}
+
+			float x = library->positionsX[i];
+			float z = library->positionsZ[i];
+			bool arrived = library->distances[i] >= registry.get<GAME::PathFollower>(entity).totalLength;
+
+			//velocity is kept up to date for anything that reads heading (tilt, dives)
+			GW::MATH::GVECTORF velocity = { 0.0f, 0.0f, 0.0f, 0.0f };
+			if (!arrived && deltaTime > 0.0f)
+			{
+				velocity.x = (x - transform->transformMatrix.row4.x) / deltaTime;
+				velocity.z = (z - transform->transformMatrix.row4.z) / deltaTime;
+			}
+			if (GAME::EntityDirectionalMovement* movement = registry.try_get<GAME::EntityDirectionalMovement>(entity))
+			{
+				movement->velocity = velocity;
+			}
+
+			transform->transformMatrix.row4.x = x;
+			transform->transformMatrix.row4.z = z;
+
+			//rotate ship model in direction ship is moving (level once it arrives)
+			float rot = tilt;
+			if (velocity.x > 0)
+			{
+				rot *= -1;
+			}
+			else if (velocity.x == 0)
+			{
+				rot = 0;
+			}
+
+			if (DRAW::MeshCollection* meshCollection = registry.try_get<DRAW::MeshCollection>(entity))
+			{
+				for (const entt::entity& meshEntity : meshCollection->entities)
+				{
+					if (!gpuInstanceView.contains(meshEntity))
+					{
+						continue;
+					}
+
+					DRAW::GPUInstance& gpuInstance = registry.get<DRAW::GPUInstance>(meshEntity);
+					gpuInstance.transform = transform->transformMatrix;
+					if (rot != 0)
+					{
+						GW::MATH::GMatrix::RotateXLocalF(gpuInstance.transform, G2D_DEGREE_TO_RADIAN_F(rot), gpuInstance.transform);
+					}
+				}
+			}
+
+			if (arrived)
+			{
+				library->arrivals.push_back(entity);
+			}
+		}
+	}
+
+}
@@ -31,4 +31,13 @@ private:
     std::map<std::string, GW::AUDIO::GSound> m_soundLibrary;
 
     std::map<std::string, GW::AUDIO::GMusic> m_musicLibrary;
-};
\ No newline at end of file
+};
+
+// Plays a sound through the registry's GameAudio if it has one
+// (headless registries such as batch simulations run without audio)
+inline void PlayGameSound(entt::registry& registry, std::string soundName)
+{
+    if (GameAudio* audio = registry.ctx().find<GameAudio>()) {
+        audio->Play(soundName);
+    }
+}
\ No newline at end of file
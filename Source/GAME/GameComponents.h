@@ -6,12 +6,23 @@
 #include <chrono>
 #include <string>
 #include <array>
+#include <bit>
 #include "../DRAW/DrawComponents.h"
 
 namespace GAME
 {
 	void CleanupGameplayEntities(entt::registry& registry);
 
+	// Flight paths (FlightPaths.cpp)
+	void BuildFlightPaths(entt::registry& registry);
+	void StartEntryPath(entt::registry& registry, entt::entity entity, int spawnIndex, float destX, float destZ);
+	void StartPathLeg(entt::registry& registry, entt::entity entity, float destX, float destZ);
+	void UpdatePathFollowers(entt::registry& registry);
+
+	// Behaviour scripts (Behaviour.cpp)
+	struct BehaviourHandle;
+	void CancelBehaviour(entt::registry& registry, BehaviourHandle handle);
+
 	static void ApplyPowerUps(
 		entt::registry& registry,
 		std::string enemyConfigPath,
@@ -20,7 +31,6 @@ namespace GAME
 
 	///*** Tags ***///
 	struct StartScreen { bool active = true;; };
-	struct GameOverScreen {};
 	struct RequestReset {};
 	struct RequestMainMenu {};
 	struct GameOver {};
@@ -29,9 +39,24 @@ namespace GAME
 	struct SettingsScreen{};
 	struct SettingsFromPause {};
 	
+	struct GameOverScreen
+	{
+		//console prompts are printed once per game over screen
+		bool messageShown = false;
+		bool quitMessageShown = false;
+	};
+
 	struct InitialsEntryScreen
 	{
 		int score = 0;
+
+		//key states from the previous frame, only react on the press edge
+		bool leftWas = false;
+		bool rightWas = false;
+		bool upWas = false;
+		bool downWas = false;
+		bool enterWas = false;
+		bool backWas = false;
 	};
 
 	struct PlayerTotalScore
@@ -87,6 +112,14 @@ namespace GAME
 
 	///*** Components ***///
 	struct Player {};
+
+	// What the player wants to do this frame. Read from the keyboard unless a
+	// PlayerIntent lives in the registry context (bots / batch simulation write it)
+	struct PlayerIntent
+	{
+		float moveX = 0.0f; // -1 left, +1 right
+		bool fire = false;
+	};
 	
 	struct Enemy
 	{
@@ -109,6 +142,13 @@ namespace GAME
 		bool entryComplete = false; // set to true when the player confirms the name
 	};
 
+	// typed name for the free-text high score prompt, reset with the rest of the game state
+	struct NameInputState
+	{
+		std::string currentName;
+		bool nameComplete = false;
+	};
+
 
 	// Track player lives
 	struct Lives
@@ -141,6 +181,10 @@ namespace GAME
 	struct EntityMovement
 	{
 		GW::MATH::GVECTORF velocity;
+		// set once HandleMovement hands an xz mover to the GPU, from then on its position is
+		// origin + velocity * MotionClock and nothing is written to its meshes
+		GW::MATH::GVECTORF origin;
+		bool analytic = false;
 	};
 
 	struct Collidable {};
@@ -166,7 +210,7 @@ namespace GAME
 
 	struct FlashRed
 	{
-		H2B::VECTOR originalColor;
+		unsigned int originalTint;
 		double timeLeft;
 	};
 
@@ -264,6 +308,12 @@ namespace GAME
 	};
 
 	///wave stuff///
+	//refers to a running behaviour script, goes stale (and is ignored) once the script finishes or is cancelled
+	struct BehaviourHandle
+	{
+		uint32_t index = UINT32_MAX;
+		uint32_t generation = 0;
+	};
 	struct Lane
 	{
 		GW::MATH::GMATRIXF location = GW::MATH::GMATRIXF{ {
@@ -272,25 +322,40 @@ namespace GAME
 				0.0f, 0.0f, 1.0f, 0.0f,
 				0.0f, 0.0f, 0.0f, 1.0f
 			} };
-		bool isOccupied = false;
-		std::vector<entt::entity> enemiesInLane;
-
-		//time lane became occupied
-		float timeSpentInLane;
-
-		//time between enemy dives from lane
-		float timeSinceLastEnemyDive;
+		//enemies sitting in this lane form an intrusive list through their LaneMember components,
+		//joining/leaving is O(1) and needs no per-lane allocation
+		entt::entity firstEnemy = entt::null;
+		int enemyCount = 0;
 
 		//how long enemies can stay in lane before leaving
 		int duration;
+
+		//dwell + dive script running while the lane is occupied
+		BehaviourHandle script;
+	};
+	//lives on an enemy while it belongs to a lane, removing it (or destroying the enemy) unlinks it
+	struct LaneMember
+	{
+		entt::entity waveEntity = entt::null;
+		int laneIndex = -1;
+		//members from before a stage reset are ignored instead of being unlinked one by one
+		unsigned int laneEpoch = 0;
+		entt::entity prev = entt::null;
+		entt::entity next = entt::null;
 	};
 	struct WaveInfo
 	{
 		std::vector<Lane> lanesContainer;
+		//one bit per lane, set while the lane is occupied
+		std::vector<uint64_t> laneOccupancy;
+		unsigned int laneEpoch = 0;
 		float timeSinceLastWaveStart = 0.0f;
 		float timeLastEnemySpawned = 0.0f;
 		GW::MATH::GMATRIXF SpawnLocation;
-		Lane* SelectedLane;
+		//which spawn point (and so which entry flight path) the current wave uses
+		int spawnIndex = 0;
+		//index into lanesContainer, a pointer would dangle once the container is copied on stage reset
+		int selectedLane = -1;
 		int EnemiesToSpawn;
 		int EnemiesAlreadySpawned = 0;
 		bool waveInProgress = false;
@@ -303,7 +368,6 @@ namespace GAME
 		int StageNumber = 0;
 		int enemiesEscaped = 0;
 		int enemiesKilled = 0; //need to change this in collision check?
-		float timeSinceLastEnemyShoot = 0.0f;
 	};
 	struct EntityDirectionalMovement
 	{
@@ -320,18 +384,62 @@ namespace GAME
 	{
 		WaveInfo waveInfo;
 		StageInfo stageInfo;
+		//sends an enemy out to shoot every timeBetweenEnemyShooting seconds, restarted every stage
+		BehaviourHandle shootingScript;
+	};
+	// totals for the whole run, StageInfo's counters start over every stage
+	struct RunStats
+	{
+		int enemiesKilled = 0;
+		int enemiesEscaped = 0;
+		int highestStage = 1;
 	};
 	struct PauseWave {};	
+
+	//*** LANE OCCUPANCY ***//
+	static bool IsLaneOccupied(const WaveInfo& waveInfo, int laneIndex)
+	{
+		return (waveInfo.laneOccupancy[laneIndex / 64] >> (laneIndex % 64)) & 1u;
+	}
+
+	static void SetLaneOccupied(WaveInfo& waveInfo, int laneIndex, bool occupied)
+	{
+		uint64_t bit = uint64_t(1) << (laneIndex % 64);
+		if (occupied) {
+			waveInfo.laneOccupancy[laneIndex / 64] |= bit;
+		}
+		else {
+			waveInfo.laneOccupancy[laneIndex / 64] &= ~bit;
+		}
+	}
+
+	//returns the first free lane or -1, scans 64 lanes per step
+	static int FindFreeLane(const WaveInfo& waveInfo)
+	{
+		int laneCount = static_cast<int>(waveInfo.lanesContainer.size());
+		for (int word = 0; word < static_cast<int>(waveInfo.laneOccupancy.size()); ++word) {
+			uint64_t freeLanes = ~waveInfo.laneOccupancy[word];
+			if (freeLanes == 0) {
+				continue;
+			}
+			int laneIndex = word * 64 + std::countr_zero(freeLanes);
+			return laneIndex < laneCount ? laneIndex : -1;
+		}
+		return -1;
+	}
+
+	//call after lanesContainer changes size
+	static void ResetLaneOccupancy(WaveInfo& waveInfo)
+	{
+		waveInfo.laneOccupancy.assign((waveInfo.lanesContainer.size() + 63) / 64, 0);
+	}
+
 	struct enemyState
 	{
 		enum states
 		{
 			Spawn,
-			MovingToMidPoint,
-			Looping1,
-			Looping2,
-			Looping3,
-			Looping4,
+			EntryPath, //flying the spawn -> midpoint -> loop curve, then on to its lane slot
 			MovingToLane,
 			InLane,
 			Shooting,
@@ -341,6 +449,52 @@ namespace GAME
 
 		states currentState = states::Spawn;
 	};
+
+	///flight paths///
+	//a precomputed curve resampled at equal arc length, so sampling by distance is one lerp
+	//no matter how complex the pattern is
+	struct FlightPath
+	{
+		std::vector<float> x;
+		std::vector<float> z;
+		float length = 0.0f;
+		float invSpacing = 0.0f;
+	};
+	//one entry path per spawn point, built from the WaveInfo config when WaveLogic is constructed
+	struct FlightPathLibrary
+	{
+		std::vector<FlightPath> paths;
+
+		//per frame scratch (kept to avoid reallocating)
+		std::vector<entt::entity> entities;
+		std::vector<float> distances;
+		std::vector<float> positionsX;
+		std::vector<float> positionsZ;
+
+		//followers that reached the end of their path this frame
+		std::vector<entt::entity> arrivals;
+	};
+	//moves an enemy along a shared curve (pathIndex >= 0) and then a straight leg of its own,
+	//or along the leg alone (pathIndex == -1). Distance is clamped to totalLength so it can't overshoot
+	struct PathFollower
+	{
+		int pathIndex = -1;
+		float distance = 0.0f;
+		float speed = 0.0f;
+		float legStartX = 0.0f;
+		float legStartZ = 0.0f;
+		float legEndX = 0.0f;
+		float legEndZ = 0.0f;
+		float legLength = 0.0f;
+		float totalLength = 0.0f;
+	};
+	//sitting in its lane with nothing to do, skipped by movement until a script sends it somewhere
+	struct AtRest {};
+	//the script currently driving this enemy, cancelled when it is replaced or the enemy is destroyed
+	struct EnemyScript
+	{
+		BehaviourHandle handle;
+	};
 	///***///
 
 	///*** Nuke ***///
@@ -372,7 +526,7 @@ namespace GAME
 			return;
 		}
 
-		gpuInstance->matData.Kd = color;
+		gpuInstance->tint = DRAW::PackTint(color);
 	}
 
 	static GW::MATH::GOBBF GetCollider(entt::registry& registry, const entt::entity& entity)
@@ -491,9 +645,10 @@ namespace GAME
 			return;
 		}
 
+		//draw from the registry's generator so every game is reproducible from its seed
 		long score = 0;
-		UTIL::Random random(minScore, maxScore);
-		score = random.next() * 10;
+		UTIL::Random& random = registry.ctx().get<UTIL::Random>();
+		score = std::uniform_int_distribution<>(minScore, maxScore)(random.generator) * 10;
 
 		scoreComponent.score = score;
 	}
@@ -596,20 +751,32 @@ namespace GAME
 
 				//carry over new stage number, lane data, and midPoint data
 				newStage.StageNumber = (stageNumber - 1);
-				newWave.lanesContainer = logic->waveInfo.lanesContainer;
+				newWave.lanesContainer = std::move(logic->waveInfo.lanesContainer);
 				
-				for (auto laneVector : newWave.lanesContainer)
+				for (auto& lane : newWave.lanesContainer)
 				{
+					GAME::CancelBehaviour(registry, lane.script);
+
 					//reset these lane values
-					laneVector.enemiesInLane.clear();
-					laneVector.isOccupied = false;
+					lane.firstEnemy = entt::null;
+					lane.enemyCount = 0;
 				}
+				GAME::ResetLaneOccupancy(newWave);
+
+				//enemies still linked into the old lanes are being destroyed, bumping the epoch
+				//lets their LaneMember cleanup skip the lanes that were just reset
+				newWave.laneEpoch = logic->waveInfo.laneEpoch + 1;
 
 				//update WaveLogic component
 				logic->waveInfo = newWave;
 				logic->stageInfo = newStage;
 
 
+				if (GAME::RunStats* stats = registry.ctx().find<GAME::RunStats>())
+				{
+					stats->highestStage = (std::max)(stats->highestStage, (int)stageNumber);
+				}
+
 				//emplace an intermission tag
 				std::shared_ptr<const GameConfig> config = registry.ctx().get<UTIL::Config>().gameConfig;
 				float time = (*config).at("StageInfo").at("timeBetweenStages").as<float>();
@@ -634,6 +801,35 @@ namespace GAME
 				GAME::WaveLogic* logic = &registry.get<GAME::WaveLogic>(entity);
 				return logic->stageInfo.StageNumber + 1;
 			}
+			return 0;
+		}
+
+
+		//enemy was shot down or caught in a nuke
+		static void recordEnemyKilled(entt::registry& registry)
+		{
+			for (auto entity : registry.view<GAME::WaveLogic>())
+			{
+				++registry.get<GAME::WaveLogic>(entity).stageInfo.enemiesKilled;
+			}
+			if (GAME::RunStats* stats = registry.ctx().find<GAME::RunStats>())
+			{
+				++stats->enemiesKilled;
+			}
+		}
+
+
+		//enemy left the board without being shot
+		static void recordEnemyEscaped(entt::registry& registry)
+		{
+			for (auto entity : registry.view<GAME::WaveLogic>())
+			{
+				++registry.get<GAME::WaveLogic>(entity).stageInfo.enemiesEscaped;
+			}
+			if (GAME::RunStats* stats = registry.ctx().find<GAME::RunStats>())
+			{
+				++stats->enemiesEscaped;
+			}
 		}
 
 
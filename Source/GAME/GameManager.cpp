@@ -119,15 +119,8 @@ namespace GAME
     {
         std::cout << "Restarting game\n";
 
-        // Wait for Vulkan to finish all rendering before destroying entities
-        auto displayView = registry.view<DRAW::VulkanRenderer>();
-        if (!displayView.empty()) {
-            auto displayEntity = displayView.front();
-            auto& vulkanRenderer = registry.get<DRAW::VulkanRenderer>(displayEntity);
-            if (vulkanRenderer.device != nullptr) {
-                vkDeviceWaitIdle(vulkanRenderer.device);
-            }
-        }
+        // No GPU wait: gameplay entities hold no GPU resources, and the renderer's buffers
+        // are retired through its frame timeline rather than destroyed under the GPU
 
         if (registry.ctx().find<GAME::GameOver>())
             registry.ctx().erase<GAME::GameOver>();
@@ -214,6 +207,11 @@ namespace GAME
             registry.ctx().erase<GAME::Lives>();
         }
 
+        // Start the next name prompt empty
+        if (registry.ctx().find<GAME::NameInputState>()) {
+            registry.ctx().erase<GAME::NameInputState>();
+        }
+
         Score& globalScore = GetGlobalScore(registry);
         globalScore.score = 0;
 
@@ -239,8 +237,7 @@ namespace GAME
 
         // Play GameOver audio (if available)
         try {
-            auto& audio = registry.ctx().get<GameAudio>();
-            audio.Play("GameOver");
+            PlayGameSound(registry, "GameOver");
         }
         catch (...) {
             std::cerr << "[GameOver] Could not play GameOver sound.\n";
@@ -269,6 +266,53 @@ namespace GAME
         std::cout << "InitialsEntryScreen entity spawned id=" << (int)initialsEntity << std::endl;
     }
 
+    // Hands a straight xz mover to the GPU: its meshes get the position it would have had at
+    // MotionClock 0 plus its velocity, the vertex shader works out the rest from SceneData.
+    // Tagging them AnchoredInstance moves them to the anchored region, which is only re-uploaded when this runs.
+    static void AnchorLinearMotion(entt::registry& registry, const DRAW::MeshCollection& meshCollection,
+        const GAME::Transform& transform, GAME::EntityMovement& movement, double now)
+    {
+        movement.origin = transform.transformMatrix.row4;
+        movement.origin.x -= static_cast<float>(movement.velocity.x * now);
+        movement.origin.z -= static_cast<float>(movement.velocity.z * now);
+        movement.analytic = true;
+
+        for (const entt::entity& meshEntity : meshCollection.entities) {
+            DRAW::GPUInstance* gpuInstance = registry.valid(meshEntity) ? registry.try_get<DRAW::GPUInstance>(meshEntity) : nullptr;
+            if (!gpuInstance) {
+                continue;
+            }
+            gpuInstance->transform = transform.transformMatrix;
+            gpuInstance->transform.row4.x = movement.origin.x;
+            gpuInstance->transform.row4.z = movement.origin.z;
+            gpuInstance->velocity[0] = movement.velocity.x;
+            gpuInstance->velocity[1] = movement.velocity.z;
+
+            if (registry.all_of<DRAW::AnchoredInstance>(meshEntity)) {
+                registry.patch<DRAW::AnchoredInstance>(meshEntity);
+            }
+            else {
+                registry.emplace<DRAW::AnchoredInstance>(meshEntity);
+            }
+        }
+    }
+
+    // Moves the clock back to 0 before the shader's float motionTime loses precision,
+    // re-anchoring every mover where it stands now so none of them jumps
+    static void RebaseMotionClock(entt::registry& registry, DRAW::MotionClock& clock)
+    {
+        auto moverView = registry.view<GAME::Transform, DRAW::MeshCollection, GAME::EntityMovement>();
+        for (auto [entity, transform, meshCollection, movement] : moverView.each()) {
+            if (!movement.analytic) {
+                continue;
+            }
+            transform.transformMatrix.row4.x = static_cast<float>(movement.origin.x + movement.velocity.x * clock.seconds);
+            transform.transformMatrix.row4.z = static_cast<float>(movement.origin.z + movement.velocity.z * clock.seconds);
+            AnchorLinearMotion(registry, meshCollection, transform, movement, 0.0);
+        }
+        clock.seconds = 0.0;
+    }
+
     void HandleMovement(entt::registry& registry)
     {
         auto view = registry.view<GAME::Transform, DRAW::MeshCollection>();
@@ -276,6 +320,17 @@ namespace GAME
         auto movementView = registry.view<GAME::EntityMovement>();
         auto toDestroyView = registry.view<GAME::ToDestroy>();
 
+        UTIL::DeltaTime* deltaTimeComponent = registry.ctx().find<UTIL::DeltaTime>();
+        double deltaTime = deltaTimeComponent ? deltaTimeComponent->dtSec : 0.0;
+        DRAW::MotionClock* clock = registry.ctx().find<DRAW::MotionClock>();
+        if (!clock) {
+            clock = &registry.ctx().emplace<DRAW::MotionClock>();
+        }
+        if (clock->seconds >= DRAW::MotionClock::rebaseSeconds) {
+            RebaseMotionClock(registry, *clock);
+        }
+        clock->seconds += deltaTime;
+
         for (const entt::entity& viewEntity : view) {
             // Skip entities marked for destruction
             if (toDestroyView.contains(viewEntity)) {
@@ -285,15 +340,23 @@ namespace GAME
             DRAW::MeshCollection& meshCollection = view.get<DRAW::MeshCollection>(viewEntity);
 
             if (movementView.contains(viewEntity)) {
-                GW::MATH::GMATRIXF transformMatrix = transform.transformMatrix;
                 GAME::EntityMovement& entityMovement = movementView.get<GAME::EntityMovement>(viewEntity);
-                GW::MATH::GVECTORF deltaPosition;
 
-                UTIL::DeltaTime* deltaTimeComponent = registry.ctx().find<UTIL::DeltaTime>();
-                if (deltaTimeComponent) {
-                    GW::MATH::GVector::ScaleF(entityMovement.velocity, deltaTimeComponent->dtSec, deltaPosition);
+                // anchored where it stood last frame, so its first step is the same as before
+                if (!entityMovement.analytic && entityMovement.velocity.y == 0.0f) {
+                    AnchorLinearMotion(registry, meshCollection, transform, entityMovement, clock->seconds - deltaTime);
+                }
+
+                if (entityMovement.analytic) {
+                    // only collision needs the position on the CPU, the meshes are left alone
+                    transform.transformMatrix.row4.x = static_cast<float>(entityMovement.origin.x + entityMovement.velocity.x * clock->seconds);
+                    transform.transformMatrix.row4.z = static_cast<float>(entityMovement.origin.z + entityMovement.velocity.z * clock->seconds);
+                    continue;
                 }
 
+                GW::MATH::GMATRIXF transformMatrix = transform.transformMatrix;
+                GW::MATH::GVECTORF deltaPosition;
+                GW::MATH::GVector::ScaleF(entityMovement.velocity, deltaTime, deltaPosition);
                 GW::MATH::GMatrix::TranslateGlobalF(transformMatrix, deltaPosition, transform.transformMatrix);
             }
 
@@ -337,6 +400,10 @@ namespace GAME
 
                 if (collisionCheck == GW::MATH::GCollision::GCollisionCheck::COLLISION) {
                     HandleCollision(registry, entityA, entityB, colliderA, colliderB);
+                    // A is gone after this hit, later pairs must not count it as killed or escaped again
+                    if (toDestroyView.contains(entityA)) {
+                        break;
+                    }
                 }
             }
         }
@@ -369,6 +436,7 @@ namespace GAME
         if (enemyHitObstacle) {
             entt::entity enemyEntity = aIsEnemy ? entityA : entityB;
             std::cout << "Destroyed enemy!" << std::endl;
+            GAME::WaveStageFunctions::recordEnemyEscaped(registry);
             MarkForDestroy(registry, enemyEntity);
             return;
         }
@@ -396,9 +464,9 @@ namespace GAME
                     }
 
                     flashRed = &registry.emplace<GAME::FlashRed>(meshEntity);
-                    flashRed->originalColor = gpuInstance->matData.Kd;
+                    flashRed->originalTint = gpuInstance->tint;
                     flashRed->timeLeft = 0.05;
-                    gpuInstance->matData.Kd = { 1.0f, 0.0f, 0.0f };
+                    gpuInstance->tint = DRAW::PackTint({ 1.0f, 0.0f, 0.0f });
                 }
             }
 
@@ -409,10 +477,10 @@ namespace GAME
 
             enemyHealth->hitPoints -= 1;
             // --- Play Enemy Hit Audio ---
-            auto& audio = registry.ctx().get<GameAudio>();
-            audio.Play("EnemyHit");
+            PlayGameSound(registry, "EnemyHit");
 
             if (enemyHealth->hitPoints <= 0) {
+                GAME::WaveStageFunctions::recordEnemyKilled(registry);
                 HandlePowerUpSpawns(registry, enemyEntity);
 
                 Score* enemyScore = registry.try_get<Score>(enemyEntity);
@@ -444,8 +512,7 @@ namespace GAME
                     HandleExplosion(registry, enemyEntity);
 
                     // --- Play Enemy Hit Audio ---
-                    auto& audio = registry.ctx().get<GameAudio>();
-                    audio.Play("EnemyExplosion");
+                    PlayGameSound(registry, "EnemyExplosion");
 
                     return;
                 }
@@ -486,17 +553,16 @@ namespace GAME
                         }
 
                         flashRed = &registry.emplace<GAME::FlashRed>(meshEntity);
-                        flashRed->originalColor = gpuInstance->matData.Kd;
+                        flashRed->originalTint = gpuInstance->tint;
                         flashRed->timeLeft = 0.05;
-                        gpuInstance->matData.Kd = { 1.0f, 0.0f, 0.0f };
+                        gpuInstance->tint = DRAW::PackTint({ 1.0f, 0.0f, 0.0f });
                     }
                 }
 
                 std::cout << "Player was hit! " << health->hitPoints << " HP remaining!" << std::endl;
 
                 // --- Play PlayerHit Audio ---
-                auto& audio = registry.ctx().get<GameAudio>();
-                audio.Play("PlayerHit");
+                PlayGameSound(registry, "PlayerHit");
 
                 if (health->hitPoints <= 0) {
                     // Player HP reached 0, check lives
@@ -560,8 +626,7 @@ namespace GAME
             MarkForDestroy(registry, powerUpEntity);
 
             // --- Play PowerUp Audio ---
-            auto& audio = registry.ctx().get<GameAudio>();
-            audio.Play("PowerUp");
+            PlayGameSound(registry, "PowerUp");
 
             Score* powerUpScore = registry.try_get<Score>(powerUpEntity);
             if (powerUpScore) {
@@ -650,17 +715,16 @@ namespace GAME
                         }
 
                         flashRed = &registry.emplace<GAME::FlashRed>(meshEntity);
-                        flashRed->originalColor = gpuInstance->matData.Kd;
+                        flashRed->originalTint = gpuInstance->tint;
                         flashRed->timeLeft = 0.05;
-                        gpuInstance->matData.Kd = { 1.0f, 0.0f, 0.0f };
+                        gpuInstance->tint = DRAW::PackTint({ 1.0f, 0.0f, 0.0f });
                     }
                 }
 
                 std::cout << "Player was hit! " << health->hitPoints << " HP remaining!" << std::endl;
 
                 // --- Play PlayerHit Audio ---
-                auto& audio = registry.ctx().get<GameAudio>();
-                audio.Play("PlayerHit");
+                PlayGameSound(registry, "PlayerHit");
 
                 if (health->hitPoints <= 0) {
                     // Player HP reached 0, check lives
@@ -798,8 +862,7 @@ namespace GAME
 
         // Play Nuke Audio
         try {
-            auto& audio = registry.ctx().get<GameAudio>();
-            audio.Play("NukeExplosion"); // Placeholder. Replace with your "nuke_sound"
+            PlayGameSound(registry, "NukeExplosion"); // Placeholder. Replace with your "nuke_sound"
             std::cout << "BOOM! Nuke activated." << std::endl;
         }
         catch (...) {
@@ -866,6 +929,7 @@ namespace GAME
                             << "!\tTotal: " << globalScore.score << std::endl;
                     }
 
+                    GAME::WaveStageFunctions::recordEnemyKilled(registry);
                     MarkForDestroy(registry, entity);
                 }
             }
@@ -931,6 +995,7 @@ namespace GAME
         int maxDepth = (*config).at("SpaceBackground").at("maxDepth").as<int>();
         int resetHeight = (*config).at("SpaceBackground").at("resetHeight").as<int>();
 
+        DRAW::MotionClock* clock = registry.ctx().find<DRAW::MotionClock>();
         auto starView = registry.view<GAME::Star, GAME::Transform>();
         for (auto& star : starView)
         {
@@ -939,6 +1004,14 @@ namespace GAME
             if (starTransform.transformMatrix.row4.z <= maxDepth)
             {
                 starTransform.transformMatrix.row4.z = resetHeight;
+
+                // the GPU draws it from its anchor, move that too
+                GAME::EntityMovement* movement = registry.try_get<GAME::EntityMovement>(star);
+                DRAW::MeshCollection* meshCollection = registry.try_get<DRAW::MeshCollection>(star);
+                if (clock && movement && movement->analytic && meshCollection)
+                {
+                    AnchorLinearMotion(registry, *meshCollection, starTransform, *movement, clock->seconds);
+                }
             }
         }
     }
@@ -967,7 +1040,7 @@ namespace GAME
 
             flashRed->timeLeft -= deltaTimeComponent->dtSec;
             if (flashRed->timeLeft <= 0) {
-                gpuInstance->matData.Kd = flashRed->originalColor;
+                gpuInstance->tint = flashRed->originalTint;
                 registry.remove<GAME::FlashRed>(entity);
             }
         }
@@ -1004,17 +1077,8 @@ namespace GAME
 
     void DestroyMarkedEntities(entt::registry& registry)
     {
-        // Wait for GPU to finish before destroying anything
-        auto displayView = registry.view<DRAW::VulkanRenderer>();
-        if (!displayView.empty()) {
-            auto displayEntity = displayView.front();
-            if (registry.all_of<DRAW::VulkanRenderer>(displayEntity)) {
-                auto& vulkanRenderer = registry.get<DRAW::VulkanRenderer>(displayEntity);
-                if (vulkanRenderer.device != nullptr) {
-                    vkDeviceWaitIdle(vulkanRenderer.device);
-                }
-            }
-        }
+        // No GPU wait needed: mesh entities only hold CPU copies of their instance data, the
+        // per-frame instance buffers the GPU reads from belong to the renderer's frame contexts
         auto toDestroyView = registry.view<GAME::ToDestroy>();
         std::vector<entt::entity> entitiesToDestroy(toDestroyView.begin(), toDestroyView.end());
 
@@ -6,8 +6,6 @@
 #include "HighScoresManager.h"
 #include "APP/Window.hpp"
 
-bool quitMessageShown = false;
-
 namespace GAME
 {
     // Signal tag to reset the game
@@ -18,6 +16,8 @@ namespace GAME
             return;
         }
 
+        GAME::GameOverScreen& screen = registry.get<GAME::GameOverScreen>(entity);
+
         GW::INPUT::GInput& input = inputComponent->immediateInput;
 		float rKey = 0.0f, hKey = 0.0f, qKey = 0.0f, mKey = 0.0f;
         input.GetState(G_KEY_R, rKey);
@@ -25,20 +25,19 @@ namespace GAME
 		input.GetState(G_KEY_Q, qKey);
 		input.GetState(G_KEY_M, mKey);
 
-        static bool messageShown = false;
-        if (!messageShown)
+        if (!screen.messageShown)
         {
             std::cout << "GAME OVER\n"
                 << "Press R to Restart\n"
                 << "Press H to View High Scores\n"
 				<< "Press Q to Quit\n"
 				<< "Press M to return to Main Menu\n";
-            messageShown = true;
+            screen.messageShown = true;
         }
 
         if (rKey > 0.5f)
         {
-            messageShown = false;
+            screen.messageShown = false;
 
             // Set a flag to request reset instead of calling ResetGame directly
             // This prevents destroying the entity while its update callback is running
@@ -66,10 +65,10 @@ namespace GAME
 
 		if (qKey > 0.5f)
 		{
-			if (quitMessageShown == false)
+			if (screen.quitMessageShown == false)
 			{
                 std::cout << "Quitting the game...\n";
-				quitMessageShown = true;
+				screen.quitMessageShown = true;
 			}
 			auto winView = registry.view<APP::Window>();
 			for (auto entity : winView) {
@@ -84,7 +83,7 @@ namespace GAME
 
         if (mKey > 0.5f)
         {
-            messageShown = false;
+            screen.messageShown = false;
 
             // Flag to request main menu
             registry.ctx().emplace<RequestMainMenu>();
@@ -50,12 +50,14 @@ namespace GAME
         bool enterPressed = (enterVal > 0.5f);
         bool backPressed = (backVal > 0.5f);
 
-        static bool leftWas = false;
-        static bool rightWas = false;
-        static bool upWas = false;
-        static bool downWas = false;
-        static bool enterWas = false;
-        static bool backWas = false;
+        // edge detection state lives on the screen entity so each registry tracks its own keys
+        GAME::InitialsEntryScreen& screen = registry.get<GAME::InitialsEntryScreen>(entity);
+        bool& leftWas = screen.leftWas;
+        bool& rightWas = screen.rightWas;
+        bool& upWas = screen.upWas;
+        bool& downWas = screen.downWas;
+        bool& enterWas = screen.enterWas;
+        bool& backWas = screen.backWas;
 
         int maxIndex = nameInput.maxLength - 1;
 
@@ -4,15 +4,18 @@
 #include "../UTIL/Utilities.h" 
 #include "../../gateware-main/Gateware.h"
 #include "../../entt-3.13.1/single_include/entt/entt.hpp"
+#include "GameComponents.h"
 
 namespace GAME
 {
     void UpdateNameInput(entt::registry& registry, GW::INPUT::GInput& input, int playerScore)
     {
-        static std::string currentName;
-        static bool nameComplete = false;
+        GAME::NameInputState* state = registry.ctx().find<GAME::NameInputState>();
+        if (!state)
+            state = &registry.ctx().emplace<GAME::NameInputState>();
+        std::string& currentName = state->currentName;
 
-        if (nameComplete) return;
+        if (state->nameComplete) return;
 
         // Input AZ
         for (int key = G_KEY_A; key <= G_KEY_Z; ++key)
@@ -36,7 +39,7 @@ namespace GAME
         {
             auto& mgr = registry.ctx().get<GAME::HighScoreManager>();
             AddHighScore(mgr, currentName.empty() ? "PLAYER" : currentName, playerScore);
-            nameComplete = true;
+            state->nameComplete = true;
         }
 
         // Render text
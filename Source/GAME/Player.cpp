@@ -6,8 +6,10 @@
 
 namespace GAME {
 
+	GAME::PlayerIntent ReadPlayerIntent(GW::INPUT::GInput& input);
+
 	void Movement(
-		GW::INPUT::GInput& input,
+		const GAME::PlayerIntent& intent,
 		GAME::Transform* transform,
 		const float& speed,
 		const float& deltaTime,
@@ -19,7 +21,7 @@ namespace GAME {
 		std::shared_ptr<const GameConfig>& config,
 		entt::entity& playerEntity,
 		GAME::Transform* playerTransform,
-		GW::INPUT::GInput& input,
+		const GAME::PlayerIntent& intent,
 		const float& deltaTime
 	);
 
@@ -34,9 +36,17 @@ namespace GAME {
 	void Update_Player(entt::registry& registry, entt::entity entity)
 	{
 		// Get Components
-		UTIL::Input* inputComponent = registry.ctx().find<UTIL::Input>();
-		if (!inputComponent) {
-			return;
+		// a PlayerIntent in the context means something other than the keyboard drives the player
+		GAME::PlayerIntent intent;
+		if (GAME::PlayerIntent* scriptedIntent = registry.ctx().find<GAME::PlayerIntent>()) {
+			intent = *scriptedIntent;
+		}
+		else {
+			UTIL::Input* inputComponent = registry.ctx().find<UTIL::Input>();
+			if (!inputComponent) {
+				return;
+			}
+			intent = ReadPlayerIntent(inputComponent->immediateInput);
 		}
 
 		UTIL::DeltaTime* deltaTimeComponent = registry.ctx().find<UTIL::DeltaTime>();
@@ -55,12 +65,10 @@ namespace GAME {
 		std::shared_ptr<const GameConfig> config = registry.ctx().get<UTIL::Config>().gameConfig;
 		float speed = (*config).at("Player").at("speed").as<float>();
 
-		GW::INPUT::GInput& input = inputComponent->immediateInput;
-
 		// Handle Different Updates
 		GAME::Transform* transform = registry.try_get<GAME::Transform>(entity);
 		if (transform) {
-			Movement(input, transform, speed, deltaTime, registry);
+			Movement(intent, transform, speed, deltaTime, registry);
 		}
 
 		//// Debug: Press 'k' to reduce player health by 1
@@ -170,17 +178,12 @@ namespace GAME {
 		}
 
 		GAME::FireState* fireState = registry.try_get<GAME::FireState>(entity);
-		Fire(registry, config, entity, transform, input, deltaTime);
+		Fire(registry, config, entity, transform, intent, deltaTime);
 	}
 
-	void Movement(
-		GW::INPUT::GInput& input,
-		GAME::Transform* transform,
-		const float& speed,
-		const float& deltaTime,
-		entt::registry& registry
-	) {
-		GW::MATH::GVECTORF moveVector = { 0.0f, 0.0f, 0.0f, 0.0f };
+	GAME::PlayerIntent ReadPlayerIntent(GW::INPUT::GInput& input)
+	{
+		GAME::PlayerIntent intent;
 
 		// Inputs
 		float keyState = 0.0f;
@@ -192,7 +195,7 @@ namespace GAME {
 
 		input.GetState(G_KEY_A, keyState);
 		if (keyState > 0.5f) {
-			moveVector.x -= 1.0f;
+			intent.moveX -= 1.0f;
 		}
 
 		/*input.GetState(G_KEY_S, keyState);
@@ -202,9 +205,25 @@ namespace GAME {
 
 		input.GetState(G_KEY_D, keyState);
 		if (keyState > 0.5f) {
-			moveVector.x += 1.0f;
+			intent.moveX += 1.0f;
 		}
 
+		float up = 0.0f;
+		input.GetState(G_KEY_UP, up);
+		intent.fire = up > 0.0f;
+
+		return intent;
+	}
+
+	void Movement(
+		const GAME::PlayerIntent& intent,
+		GAME::Transform* transform,
+		const float& speed,
+		const float& deltaTime,
+		entt::registry& registry
+	) {
+		GW::MATH::GVECTORF moveVector = { intent.moveX, 0.0f, 0.0f, 0.0f };
+
 
 		//tilt player ship in direction of movement
 		auto& playerView = registry.view<GAME::Player, DRAW::MeshCollection>();
@@ -264,7 +283,7 @@ namespace GAME {
 		std::shared_ptr<const GameConfig>& config,
 		entt::entity& playerEntity,
 		GAME::Transform* playerTransform,
-		GW::INPUT::GInput& input,
+		const GAME::PlayerIntent& intent,
 		const float& deltaTime
 	) {
 		FireState* fireState = registry.try_get<GAME::FireState>(playerEntity);
@@ -278,8 +297,7 @@ namespace GAME {
 			registry.remove<FireState>(playerEntity);
 		}
 
-		float up;
-		input.GetState(G_KEY_UP, up);
+		float up = intent.fire ? 1.0f : 0.0f;
 
 		GW::MATH::GVECTORF direction = { 0.0f, 0.0f, up, 0.0f };
 
@@ -312,8 +330,7 @@ namespace GAME {
 		}
 
 		// --- Play Blaster Audio ---
-		auto& audio = registry.ctx().get<GameAudio>();
-		audio.Play("blaster");
+		PlayGameSound(registry, "blaster");
 
 
 		FireState& newFireState = registry.emplace<FireState>(playerEntity);
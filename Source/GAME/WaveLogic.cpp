@@ -3,33 +3,43 @@
 #include "GameComponents.h"
 #include "../CCL.h"
 #include "GameAudio.h"
+#include "Behaviour.h"
 
 
 
 namespace GAME
 {
 
-	bool shouldSpawnWave(entt::registry& registry);
-	void spawnWave(entt::registry& registry);
-	int randomNumber(int min, int max, bool includeMax = false);
-	GW::MATH::GMATRIXF selectSpawnLocation(int index);
-	void spawnDefaultAlien(entt::registry& registry, GW::MATH::GMATRIXF spawnLocation, GW::MATH::GMATRIXF destinationLocation);
-	void moveAliensToDestination(entt::registry& registry);
+	// all wave state lives on the WaveLogic component and the config lives in the registry context,
+	// so every function below works on the registry it is handed (no globals shared between registries)
+	bool shouldSpawnWave(entt::registry& registry, entt::entity waveEntity, GAME::WaveLogic& waveLogic);
+	void spawnWave(entt::registry& registry, entt::entity waveEntity, GAME::WaveLogic& waveLogic);
+	int randomNumber(entt::registry& registry, int min, int max, bool includeMax = false);
+	GW::MATH::GMATRIXF selectSpawnLocation(entt::registry& registry, int index);
+	void spawnDefaultAlien(entt::registry& registry, entt::entity waveEntity, GAME::WaveLogic& waveLogic, GW::MATH::GMATRIXF spawnLocation, GW::MATH::GMATRIXF destinationLocation);
+	void addEnemyToLane(entt::registry& registry, entt::entity waveEntity, GAME::WaveLogic& waveLogic, int laneIndex, entt::entity enemy);
+	void moveAliensToDestination(entt::registry& registry, GAME::WaveLogic& waveLogic);
 	void setDestination(entt::registry& registry, entt::entity alien, float destX, float destZ);
-	void checkLanesForClearing(entt::registry& registry);
+	void checkLanesForClearing(entt::registry& registry, GAME::WaveLogic& waveLogic);
 	bool noEnemiesRemain(entt::registry& registry);
-	void applyStageModifiers(entt::registry& registry);
-	void checkForEnemyShoot(entt::registry& registry);
+	void applyStageModifiers(entt::registry& registry, GAME::WaveLogic& waveLogic);
+	bool diveFromLane(entt::registry& registry, entt::entity waveEntity, int laneIndex);
+	bool sendEnemyToShoot(entt::registry& registry);
+	void settleInLane(entt::registry& registry, entt::entity enemy);
 	void spawnEnemyBullet(entt::registry& registry, entt::entity theShooter);
 
+	// behaviour scripts, each one sleeps in the scheduler between the moments it has something to do
+	GAME::BehaviourTask enemyEntryScript(entt::registry& registry, entt::entity self);
+	GAME::BehaviourTask enemyShootScript(entt::registry& registry, entt::entity self, float targetX, float targetZ);
+	GAME::BehaviourTask laneScript(entt::registry& registry, entt::entity waveEntity, int laneIndex);
+	GAME::BehaviourTask shootingScript(entt::registry& registry);
 
-	std::shared_ptr<const GameConfig> config;
-	GAME::WaveLogic* waveLogic;
-	
 
 
 	void Update_WaveLogic(entt::registry& registry, entt::entity entity)
 	{
+		GAME::WaveLogic& waveLogic = registry.get<GAME::WaveLogic>(entity);
+
 		UTIL::DeltaTime* deltaTimeComponent = registry.ctx().find<UTIL::DeltaTime>();
 		GAME::SpecialCooldown * specialCooldown = registry.ctx().find<GAME::SpecialCooldown>();
 		if (deltaTimeComponent && specialCooldown)
@@ -60,9 +70,8 @@ namespace GAME
 			if (intermission->time <= 0.0f) 
 			{
 				registry.ctx().erase<GAME::StageIntermission>();
-				waveLogic->stageInfo.EnemiesAlreadySpawned = 0;
-				waveLogic->stageInfo.timeSinceLastEnemyShoot = 0.0f;
-				applyStageModifiers(registry);
+				waveLogic.stageInfo.EnemiesAlreadySpawned = 0;
+				applyStageModifiers(registry, waveLogic);
 
 				///TODO:: stop displaying previous stage's info on screen
 			}
@@ -70,36 +79,42 @@ namespace GAME
 		}
 		
 		
-		checkLanesForClearing(registry);
+		checkLanesForClearing(registry, waveLogic);
 
 	
 
 		//if not currently in a wave, see if it's time to spawn a new wave
-		if (!waveLogic->waveInfo.waveInProgress)
+		if (!waveLogic.waveInfo.waveInProgress)
 		{
-			waveLogic->waveInfo.waveInProgress = shouldSpawnWave(registry);
+			waveLogic.waveInfo.waveInProgress = shouldSpawnWave(registry, entity, waveLogic);
 		}
 		
-		if (waveLogic->waveInfo.waveInProgress)
+		if (waveLogic.waveInfo.waveInProgress)
 		{
 			//spawn enemies in wave at set intervals
-			spawnWave(registry);
+			spawnWave(registry, entity, waveLogic);
 		}
 
 
-		checkForEnemyShoot(registry);
-		
+		moveAliensToDestination(registry, waveLogic);
+
 
-		moveAliensToDestination(registry);
+		//wake the scripts whose timer ran out, whose enemy arrived or whose player event fired
+		GAME::RunBehaviours(registry);
 	}
 
 
 	void Construct_WaveLogic(entt::registry& registry, entt::entity entity)
 	{
-		config = registry.ctx().get<UTIL::Config>().gameConfig;
+		std::shared_ptr<const GameConfig> config = registry.ctx().get<UTIL::Config>().gameConfig;
 
-		waveLogic = &registry.get<GAME::WaveLogic>(entity);
-	
+		GAME::WaveLogic& waveLogic = registry.get<GAME::WaveLogic>(entity);
+
+		//lane, shooting and enemy scripts all run on this registry's scheduler
+		if (!registry.ctx().find<GAME::BehaviourScheduler>())
+		{
+			registry.ctx().emplace<GAME::BehaviourScheduler>();
+		}
 
 		
 		//lanes
@@ -120,15 +135,22 @@ namespace GAME
 				laneX, 0, laneZ, 1.0f
 			} };
 
-			waveLogic->waveInfo.lanesContainer.push_back(newLane);
+			waveLogic.waveInfo.lanesContainer.push_back(newLane);
 		}
+		GAME::ResetLaneOccupancy(waveLogic.waveInfo);
+
+		//entry curves only depend on config, build them once up front
+		GAME::BuildFlightPaths(registry);
 	}
 
 
-	bool shouldSpawnWave(entt::registry& registry)
+	bool shouldSpawnWave(entt::registry& registry, entt::entity waveEntity, GAME::WaveLogic& waveLogic)
 	{
+		std::shared_ptr<const GameConfig> config = registry.ctx().get<UTIL::Config>().gameConfig;
+
+
 		//see if we have exceeded max spawn for this stage
-		if (waveLogic->stageInfo.EnemiesAlreadySpawned >= waveLogic->stageInfo.EnemiesToSpawn)
+		if (waveLogic.stageInfo.EnemiesAlreadySpawned >= waveLogic.stageInfo.EnemiesToSpawn)
 		{
 			//see if enemies are still on board
 			if (!noEnemiesRemain(registry))
@@ -140,7 +162,7 @@ namespace GAME
 			
 
 			//start next stage
-			GAME::WaveStageFunctions::playStage(registry, waveLogic->stageInfo.StageNumber + 2);
+			GAME::WaveStageFunctions::playStage(registry, waveLogic.stageInfo.StageNumber + 2);
 
 			return false;
 		}
@@ -149,45 +171,39 @@ namespace GAME
 
 		//try to spawn new wave every x seconds
 		float deltaTime = registry.ctx().find<UTIL::DeltaTime>()->dtSec;
-		waveLogic->waveInfo.timeSinceLastWaveStart += deltaTime;
+		waveLogic.waveInfo.timeSinceLastWaveStart += deltaTime;
 
-		if (waveLogic->waveInfo.timeSinceLastWaveStart >= (*config).at("WaveInfo").at("timeBetweenWaves").as<int>())
+		if (waveLogic.waveInfo.timeSinceLastWaveStart >= (*config).at("WaveInfo").at("timeBetweenWaves").as<int>())
 		{
 			//see if there is an open lane
-			for (int i = 0; i < waveLogic->waveInfo.lanesContainer.size(); ++i)
+			int i = GAME::FindFreeLane(waveLogic.waveInfo);
+			if (i >= 0)
 			{
-				if (waveLogic->waveInfo.lanesContainer[i].isOccupied)
-				{
-					continue;
-				}
-				
 				//found an open lane, set it as occupied and setup wave parameters
 
-				waveLogic->waveInfo.lanesContainer[i].isOccupied = true;
+				GAME::SetLaneOccupied(waveLogic.waveInfo, i, true);
 
-				//wave stays on board for x seconds
-				waveLogic->waveInfo.lanesContainer[i].timeSpentInLane = 0.0f;
+				//wave stays on board for x seconds, then starts diving out
 				int minTime = (*config).at("WaveInfo").at("minTimeBeforeWaveLeaves").as<int>();
 				int maxTime = (*config).at("WaveInfo").at("maxTimeBeforeWaveLeaves").as<int>();
-				waveLogic->waveInfo.lanesContainer[i].duration = randomNumber(minTime, maxTime, true);
-
-				//initialize dive timer
-				waveLogic->waveInfo.lanesContainer[i].timeSinceLastEnemyDive = 0.0f;
+				waveLogic.waveInfo.lanesContainer[i].duration = randomNumber(registry, minTime, maxTime, true);
+				waveLogic.waveInfo.lanesContainer[i].script = GAME::StartBehaviour(registry, laneScript(registry, waveEntity, i));
 
 				//set a random spawn location
 				int numOfSpawns = (*config).at("WaveInfo").at("numberOfSpawns").as<int>();
-				waveLogic->waveInfo.SpawnLocation = selectSpawnLocation(randomNumber(0, numOfSpawns));
+				waveLogic.waveInfo.spawnIndex = randomNumber(registry, 0, numOfSpawns);
+				waveLogic.waveInfo.SpawnLocation = selectSpawnLocation(registry, waveLogic.waveInfo.spawnIndex);
 
-				//set the open lane as selected lane
-				waveLogic->waveInfo.SelectedLane = &waveLogic->waveInfo.lanesContainer[i];
+				//set the open lane as selected lane (an index, lanesContainer may be copied or reallocated)
+				waveLogic.waveInfo.selectedLane = i;
 
 				//get random number of enemies to spawn in wave
 				int maxNumberOfEnemiesToSpawn = (*config).at("WaveInfo").at("maxNumberOfEnemiesToSpawn").as<int>();
 				int minNumberOfEnemiesToSpawn = (*config).at("WaveInfo").at("minNumberOfEnemiesToSpawn").as<int>();
-				waveLogic->waveInfo.EnemiesToSpawn = randomNumber(minNumberOfEnemiesToSpawn, maxNumberOfEnemiesToSpawn, true);
+				waveLogic.waveInfo.EnemiesToSpawn = randomNumber(registry, minNumberOfEnemiesToSpawn, maxNumberOfEnemiesToSpawn, true);
 				//don't let number of enemies to spawn exceed stage's count cap
-				int countRemaining = waveLogic->stageInfo.EnemiesToSpawn - waveLogic->stageInfo.EnemiesAlreadySpawned;
-				waveLogic->waveInfo.EnemiesToSpawn = std::clamp(waveLogic->waveInfo.EnemiesToSpawn, waveLogic->waveInfo.EnemiesToSpawn, countRemaining);
+				int countRemaining = waveLogic.stageInfo.EnemiesToSpawn - waveLogic.stageInfo.EnemiesAlreadySpawned;
+				waveLogic.waveInfo.EnemiesToSpawn = (std::min)(waveLogic.waveInfo.EnemiesToSpawn, countRemaining);
 
 
 				return true;				
@@ -197,15 +213,17 @@ namespace GAME
 	}
 
 
-	void spawnWave(entt::registry& registry)
+	void spawnWave(entt::registry& registry, entt::entity waveEntity, GAME::WaveLogic& waveLogic)
 	{	
+		std::shared_ptr<const GameConfig> config = registry.ctx().get<UTIL::Config>().gameConfig;
+
 		//check to see if all enemies for wave have been spawned
-		if (waveLogic->waveInfo.EnemiesAlreadySpawned == waveLogic->waveInfo.EnemiesToSpawn)
+		if (waveLogic.waveInfo.EnemiesAlreadySpawned == waveLogic.waveInfo.EnemiesToSpawn)
 		{
 			//reset wave bool and reset timer
-			waveLogic->waveInfo.waveInProgress = false;
-			waveLogic->waveInfo.EnemiesAlreadySpawned = 0;
-			waveLogic->waveInfo.timeSinceLastWaveStart = 0.0f;
+			waveLogic.waveInfo.waveInProgress = false;
+			waveLogic.waveInfo.EnemiesAlreadySpawned = 0;
+			waveLogic.waveInfo.timeSinceLastWaveStart = 0.0f;
 			return;
 		}
 
@@ -213,26 +231,26 @@ namespace GAME
 		//check to see if enough time has passed since last enemy spawned
 		float delay = (*config).at("WaveInfo").at("timeBetweenIndividualSpawns").as<float>();
 		float deltaTime = registry.ctx().find<UTIL::DeltaTime>()->dtSec;
-		waveLogic->waveInfo.timeLastEnemySpawned += deltaTime;
+		waveLogic.waveInfo.timeLastEnemySpawned += deltaTime;
 
 
 		///lanes were being cleared before enemies spawned, counter confirms at least 1 enemy spawns before checking if lane is clear
-		if (waveLogic->waveInfo.EnemiesAlreadySpawned == 0 || waveLogic->waveInfo.timeLastEnemySpawned >= delay)
+		if (waveLogic.waveInfo.EnemiesAlreadySpawned == 0 || waveLogic.waveInfo.timeLastEnemySpawned >= delay)
 		{
 			//get position in lane enemy will be in
-			GW::MATH::GMATRIXF finalDestination = waveLogic->waveInfo.SelectedLane->location;
-			finalDestination.row4.x += waveLogic->waveInfo.EnemiesAlreadySpawned * ((*config).at("WaveInfo").at("paddingBetweenShips").as<float>());
+			GW::MATH::GMATRIXF finalDestination = waveLogic.waveInfo.lanesContainer[waveLogic.waveInfo.selectedLane].location;
+			finalDestination.row4.x += waveLogic.waveInfo.EnemiesAlreadySpawned * ((*config).at("WaveInfo").at("paddingBetweenShips").as<float>());
 
-			spawnDefaultAlien(registry, waveLogic->waveInfo.SpawnLocation, finalDestination);
+			spawnDefaultAlien(registry, waveEntity, waveLogic, waveLogic.waveInfo.SpawnLocation, finalDestination);
 			
-			waveLogic->waveInfo.timeLastEnemySpawned = 0.0f;
-			++waveLogic->waveInfo.EnemiesAlreadySpawned;
-			++waveLogic->stageInfo.EnemiesAlreadySpawned;
+			waveLogic.waveInfo.timeLastEnemySpawned = 0.0f;
+			++waveLogic.waveInfo.EnemiesAlreadySpawned;
+			++waveLogic.stageInfo.EnemiesAlreadySpawned;
 		}
 	}
 
 
-	int randomNumber(int min, int max, bool includeMax)
+	int randomNumber(entt::registry& registry, int min, int max, bool includeMax)
 	{
 		//when searching for a random number to use an index
 		//leave includeMax as false
@@ -240,13 +258,23 @@ namespace GAME
 		
 		//if max = 20, min = 19, and includeMax = true
 		int newMax = max - min; //20 - 19 = 1
-		int num = rand() % (newMax + includeMax); // turn newMax into 2, return = 0 - 1
+		int range = newMax + includeMax; // turn newMax into 2, return = 0 - 1
+		if (range <= 0)
+		{
+			return min;
+		}
+
+		//draw from this registry's generator so simulations never share random state
+		UTIL::Random& random = registry.ctx().get<UTIL::Random>();
+		int num = std::uniform_int_distribution<>(0, range - 1)(random.generator);
 		return num + min; //if 0 return 19, if 1 return 20
 	}
 
 
-	GW::MATH::GMATRIXF selectSpawnLocation(int index)
+	GW::MATH::GMATRIXF selectSpawnLocation(entt::registry& registry, int index)
 	{
+		std::shared_ptr<const GameConfig> config = registry.ctx().get<UTIL::Config>().gameConfig;
+
 		///select the side of the screen to spawn wave based on index		
 		///if index == 0, get x and z in .ini file for left side of screen
 		///take x and z and place them into a matrix
@@ -271,8 +299,9 @@ namespace GAME
 	}
 
 	
-	void spawnDefaultAlien(entt::registry& registry, GW::MATH::GMATRIXF spawnLocation, GW::MATH::GMATRIXF finalDestination)
+	void spawnDefaultAlien(entt::registry& registry, entt::entity waveEntity, GAME::WaveLogic& waveLogic, GW::MATH::GMATRIXF spawnLocation, GW::MATH::GMATRIXF finalDestination)
 	{
+		std::shared_ptr<const GameConfig> config = registry.ctx().get<UTIL::Config>().gameConfig;
 		DRAW::ModelManager* modelManager = registry.ctx().find<DRAW::ModelManager>();
 		if (!modelManager) {
 			return;
@@ -316,7 +345,7 @@ namespace GAME
 		}
 
 		float speed = (*config).at(enemyPath).at("speed").as<float>();
-		speed += waveLogic->stageInfo.SpeedModifier;
+		speed += waveLogic.stageInfo.SpeedModifier;
 		int hitPoints = (*config).at(enemyPath).at("hitpoints").as<int>();
 
 		entt::entity enemyEntity = registry.create();
@@ -354,24 +383,87 @@ namespace GAME
 
 		//state
 		GAME::enemyState& enemyStateComponent = registry.emplace<GAME::enemyState>(enemyEntity);
-		enemyStateComponent.currentState = enemyStateComponent.Spawn;
+		enemyStateComponent.currentState = enemyStateComponent.EntryPath;
+
+		//fly the spawn point's entry curve, then straight to this enemy's slot in the lane
+		GAME::StartEntryPath(registry, enemyEntity, waveLogic.waveInfo.spawnIndex, finalDestination.row4.x, finalDestination.row4.z);
+		GAME::StartEnemyScript(registry, enemyEntity, enemyEntryScript(registry, enemyEntity));
 
 		//add power-up
 		GAME::ApplyPowerUps(registry, enemyPath, enemyEntity);
 
-		//pushback this eneity into the current wave's lane container
-		waveLogic->waveInfo.SelectedLane->enemiesInLane.push_back(enemyEntity);
+		//link this entity into the current wave's lane
+		addEnemyToLane(registry, waveEntity, waveLogic, waveLogic.waveInfo.selectedLane, enemyEntity);
+	}
+
+
+	void addEnemyToLane(entt::registry& registry, entt::entity waveEntity, GAME::WaveLogic& waveLogic, int laneIndex, entt::entity enemy)
+	{
+		GAME::Lane& lane = waveLogic.waveInfo.lanesContainer[laneIndex];
+
+		//push front, order inside a lane doesn't matter
+		GAME::LaneMember& member = registry.emplace<GAME::LaneMember>(enemy);
+		member.waveEntity = waveEntity;
+		member.laneIndex = laneIndex;
+		member.laneEpoch = waveLogic.waveInfo.laneEpoch;
+		member.next = lane.firstEnemy;
+
+		if (lane.firstEnemy != entt::null)
+		{
+			registry.get<GAME::LaneMember>(lane.firstEnemy).prev = enemy;
+		}
+		lane.firstEnemy = enemy;
+		++lane.enemyCount;
+	}
+
+
+	///unlinks an enemy from its lane when it dives, dies or is destroyed
+	void Destroy_LaneMember(entt::registry& registry, entt::entity entity)
+	{
+		GAME::LaneMember& member = registry.get<GAME::LaneMember>(entity);
+
+		GAME::WaveLogic* waveLogic = registry.valid(member.waveEntity) ? registry.try_get<GAME::WaveLogic>(member.waveEntity) : nullptr;
+		if (!waveLogic || member.laneEpoch != waveLogic->waveInfo.laneEpoch)
+		{
+			return; //lanes were reset since this enemy joined
+		}
+
+		GAME::Lane& lane = waveLogic->waveInfo.lanesContainer[member.laneIndex];
+
+		if (member.prev != entt::null)
+		{
+			registry.get<GAME::LaneMember>(member.prev).next = member.next;
+		}
+		else
+		{
+			lane.firstEnemy = member.next;
+		}
+
+		if (member.next != entt::null)
+		{
+			registry.get<GAME::LaneMember>(member.next).prev = member.prev;
+		}
+
+		--lane.enemyCount;
 	}
 
 
-	void moveAliensToDestination(entt::registry& registry)
+	void moveAliensToDestination(entt::registry& registry, GAME::WaveLogic& waveLogic)
 	{
-		///enemies stop moving once they reach their destination
-		///IMPORTANT, if enemy is moving too fast then they overshoot their destination and keep moving
+		std::shared_ptr<const GameConfig> config = registry.ctx().get<UTIL::Config>().gameConfig;
 
 
+		///everything on a path (entry loop, trip to lane, trip to shooting spot) moves in one batch,
+		///followers are clamped to the end of their path so they can't overshoot their destination,
+		///arrivals are handed to the scripts waiting on them in RunBehaviours
+		GAME::UpdatePathFollowers(registry);
+
+
+		///diving/leaving enemies keep moving along their velocity until they are destroyed,
+		///enemies resting in their lane aren't visited at all
 		auto gpuInstanceView = registry.view<DRAW::GPUInstance>();
-		auto movementView = registry.view<GAME::Enemy, GAME::Transform, DRAW::MeshCollection, GAME::EntityDirectionalMovement, GAME::enemyState>();
+		///enemies already destroyed this frame (shot, crashed) have been counted, they can't escape as well
+		auto movementView = registry.view<GAME::Enemy, GAME::Transform, DRAW::MeshCollection, GAME::EntityDirectionalMovement, GAME::enemyState>(entt::exclude<GAME::PathFollower, GAME::AtRest, GAME::ToDestroy>);
 
 
 		for (auto& viewEntity : movementView) 
@@ -382,26 +474,15 @@ namespace GAME
 			DRAW::MeshCollection& meshCollection = movementView.get<DRAW::MeshCollection>(viewEntity);
 
 
-			///check if enemy just spawned in, set destination to midpoint
-			if (state.currentState == state.Spawn)
-			{
-				state.currentState = state.MovingToMidPoint;
-
-				float xDest = (*config).at("WaveInfo").at("MidPointX").as<float>();
-				float zDest = (*config).at("WaveInfo").at("MidPointZ").as<float>();
-				setDestination(registry, viewEntity, xDest, zDest);
-			}
-
 			///destroy enemy if too low
-			else if (state.currentState == state.Leaving)
+			if (state.currentState == state.Leaving)
 			{
 				///wall beneath player doesn't always destroy enemies????????
 				int maxDepth = (*config).at("WaveInfo").at("zLevelToDestroyEnemy").as<int>();
-				if (state.currentState == state.Leaving
-					&& transform.transformMatrix.row4.z <= maxDepth)
+				if (transform.transformMatrix.row4.z <= maxDepth)
 				{
 					//too low, destroy
-					++waveLogic->stageInfo.enemiesEscaped;
+					GAME::WaveStageFunctions::recordEnemyEscaped(registry);
 					registry.emplace_or_replace<GAME::ToDestroy>(viewEntity);
 					continue;
 				}
@@ -438,133 +519,11 @@ namespace GAME
 					}
 				}
 			}
-			
-			///check to see if entity has reached destination
-			else if (transform.transformMatrix.row4.x == directionalMovement.destinationX &&
-					 transform.transformMatrix.row4.z == directionalMovement.destinationZ)
-			{
-
-				///see what state they WERE in
-				if (state.currentState == state.InLane)
-				{
-					//skip
-					continue;
-				}
-				else if (state.currentState == state.MovingToLane)
-				{
-					//set InLane + skip
-					state.currentState = state.InLane;
-					continue;
-				}
-				else if (state.currentState == state.MovingToMidPoint)
-				{
-					state.currentState = state.Looping1;
-					float radius = (*config).at("WaveInfo").at("MidPointRadius").as<float>();
-								
-					//need to get current direction of enemy, so they continue in loop in that direction
-					int direction = (directionalMovement.velocity.x > 0 ? 1 : -1);
-
-					float xDest = transform.transformMatrix.row4.x + (radius * direction);
-					float zDest = transform.transformMatrix.row4.z + radius;
-					
-					
-
-					setDestination(registry, viewEntity, xDest, zDest);
-				}
-				else if (state.currentState == state.Looping1)
-				{
-					state.currentState = state.Looping2;
-					float radius = (*config).at("WaveInfo").at("MidPointRadius").as<float>();
-					
-					//need to get reverse direction of enemy
-					int direction = (directionalMovement.velocity.x > 0 ? -1 : 1);
-
-					
-					float xDest = transform.transformMatrix.row4.x + radius * direction;
-					float zDest = transform.transformMatrix.row4.z + radius;
-					setDestination(registry, viewEntity, xDest, zDest);
-				}	
-				else if (state.currentState == state.Looping2)
-				{
-					state.currentState = state.Looping3;
-					float radius = (*config).at("WaveInfo").at("MidPointRadius").as<float>();
-					
-					//need to get current direction of enemy
-					int direction = (directionalMovement.velocity.x > 0 ? 1 : -1);
-					
-					float xDest = transform.transformMatrix.row4.x + radius * direction;
-					float zDest = transform.transformMatrix.row4.z - radius;
-
-					setDestination(registry, viewEntity, xDest, zDest);
-				}
-				else if (state.currentState == state.Looping3)
-				{
-					state.currentState = state.Looping4;
-					float radius = (*config).at("WaveInfo").at("MidPointRadius").as<float>();
-					
-					//need to get reverse direction of enemy
-					int direction = (directionalMovement.velocity.x > 0 ? -1 : 1);
-					
-					float xDest = transform.transformMatrix.row4.x + radius * direction;
-					float zDest = transform.transformMatrix.row4.z - radius;
-					setDestination(registry, viewEntity, xDest, zDest);
-				}
-				else if (state.currentState == state.Looping4)
-				{
-					state.currentState = state.MovingToLane;
-					setDestination(registry, viewEntity, directionalMovement.finalDestination.row4.x, directionalMovement.finalDestination.row4.z);
-				}
-				else if (state.currentState == state.Shooting)
-				{
-					//have enemy shoot down
-					spawnEnemyBullet(registry, viewEntity);
-
-					//move back to lane
-					state.currentState = state.MovingToLane;
-					setDestination(registry, viewEntity, directionalMovement.finalDestination.row4.x, directionalMovement.finalDestination.row4.z);
-				}
-			}
-			
-
-			
-
 
-
-
-			///stop enemy if near destination, ignore destination for leaving/diving enemies
-			if (state.currentState != state.Leaving && state.currentState != state.Diving)
+			else
 			{
-				float distance = sqrt(
-					pow(directionalMovement.destinationX - transform.transformMatrix.row4.x, 2)
-					+
-					pow(directionalMovement.destinationZ - transform.transformMatrix.row4.z, 2)
-				);
-				//have enemy keep moving in current direction if leaving/diving
-				if (distance <= 0.25f)
-				{
-					//entity has reached destination
-					transform.transformMatrix.row4.x = directionalMovement.destinationX;
-					transform.transformMatrix.row4.z = directionalMovement.destinationZ;
-
-
-					//adjust mesh to position + set rotation rot to 0
-					for (const entt::entity& meshEntity : meshCollection.entities)
-					{
-						if (!gpuInstanceView.contains(meshEntity))
-						{
-							continue;
-						}
-
-						DRAW::GPUInstance& gpuInstance = registry.get<DRAW::GPUInstance>(meshEntity);
-						gpuInstance.transform = transform.transformMatrix;
-					}
-
-					continue;
-				}
+				continue; //resting in lane
 			}
-			
-
-
 
 
 
@@ -613,6 +572,8 @@ namespace GAME
 
 	void setDestination(entt::registry& registry, entt::entity alien, float destX, float destZ)
 	{		
+		std::shared_ptr<const GameConfig> config = registry.ctx().get<UTIL::Config>().gameConfig;
+
 		if (registry.valid(alien) && registry.all_of<GAME::EntityDirectionalMovement>(alien) && registry.all_of<GAME::Transform>(alien))
 		{
 			GAME::EntityDirectionalMovement& directionalMovement = registry.get<GAME::EntityDirectionalMovement>(alien);
@@ -648,131 +609,101 @@ namespace GAME
 	}
 
 
-	void checkLanesForClearing(entt::registry& registry)
+	void checkLanesForClearing(entt::registry& registry, GAME::WaveLogic& waveLogic)
 	{
-		
-		for (int i = 0; i < waveLogic->waveInfo.lanesContainer.size(); ++i)
+		for (int i = 0; i < waveLogic.waveInfo.lanesContainer.size(); ++i)
 		{
-
-
-
-			if (!waveLogic->waveInfo.lanesContainer[i].isOccupied)
+			if (!GAME::IsLaneOccupied(waveLogic.waveInfo, i))
 			{
 				continue; //lane not occupied, skip
 			}
 
+			GAME::Lane& lane = waveLogic.waveInfo.lanesContainer[i];
 
 
-			///this checks if enemies left screen
-			if (waveLogic->waveInfo.lanesContainer[i].enemiesInLane.empty())
-			{
-				waveLogic->waveInfo.lanesContainer[i].isOccupied = false;
-				waveLogic->waveInfo.lanesContainer[i].enemiesInLane.clear();
-			}
-			else
+
+			///enemies unlink themselves when they dive, die or leave, so an empty list means the lane is clear
+			///(the lane still being filled by the current wave stays reserved)
+			if (lane.enemyCount <= 0)
 			{
-				///this checks if they were killed
-				for (auto entity : waveLogic->waveInfo.lanesContainer[i].enemiesInLane)
+				bool stillSpawning = waveLogic.waveInfo.waveInProgress && waveLogic.waveInfo.selectedLane == i;
+				if (!stillSpawning)
 				{
-					if (registry.valid(entity))
-					{
-						break; //at least 1 ship is still alive, now check time left
-					}
-					else if (entity == waveLogic->waveInfo.lanesContainer[i].enemiesInLane.back())
-					{
-						waveLogic->waveInfo.lanesContainer[i].isOccupied = false;
-						waveLogic->waveInfo.lanesContainer[i].enemiesInLane.clear();
-					}
+					GAME::SetLaneOccupied(waveLogic.waveInfo, i, false);
+					GAME::CancelBehaviour(registry, lane.script);
 				}
 			}
+		}
+	}
 
-			
 
+	///Have enemies dive offscreen, returns false if every enemy in the lane stayed put
+	bool diveFromLane(entt::registry& registry, entt::entity waveEntity, int laneIndex)
+	{
+		std::shared_ptr<const GameConfig> config = registry.ctx().get<UTIL::Config>().gameConfig;
 
+		GAME::Lane& lane = registry.get<GAME::WaveLogic>(waveEntity).waveInfo.lanesContainer[laneIndex];
+		if (lane.firstEnemy == entt::null)
+		{
+			return true; //nobody left, lane gets freed by checkLanesForClearing
+		}
+
+		bool anyDove = false;
+		for (entt::entity entity = lane.firstEnemy; entity != entt::null;)
+		{
+			//read the link before this enemy possibly leaves the lane
+			entt::entity next = registry.get<GAME::LaneMember>(entity).next;
 
-			if (!waveLogic->waveInfo.lanesContainer[i].isOccupied)
+			if (!registry.all_of<GAME::EntityDirectionalMovement, GAME::enemyState>(entity))
 			{
-				continue; //lane was freed, skip time/dive check
+				entity = next;
+				continue; //no entity found with movement
 			}
+			
 
-
-
-			//check to see if time in lane has exceeded threshold
-			float deltaTime = registry.ctx().find<UTIL::DeltaTime>()->dtSec;
-			waveLogic->waveInfo.lanesContainer[i].timeSpentInLane += deltaTime;
-
-			if (waveLogic->waveInfo.lanesContainer[i].timeSpentInLane < waveLogic->waveInfo.lanesContainer[i].duration)
+			///flip a coin, see if this enemy should dive now
+			if (randomNumber(registry, 0, 1, true))
 			{
-				continue; //not time to clear lane yet
+				entity = next;
+				continue;
 			}
 
 
-
-			///Have enemies dive offscreen
-
-			//check to see if dive cooldown has finished
-			float delay = (*config).at("WaveInfo").at("timeBetweenDives").as<float>();
-			waveLogic->waveInfo.lanesContainer[i].timeSinceLastEnemyDive += deltaTime;
+			//set vector to straight down
+			GAME::EntityDirectionalMovement& directionalMovement = registry.get<GAME::EntityDirectionalMovement>(entity);
+			GW::MATH::GVECTORF directionVector = GW::MATH::GVECTORF{ {
+			0.0f,
+			0.0f,
+			-1,
+			0.0f
+			} };
+			GW::MATH::GVector::NormalizeF(directionVector, directionVector);
 			
-			if (waveLogic->waveInfo.lanesContainer[i].timeSinceLastEnemyDive < delay)
-			{
-				continue; //not time to dive yet
+			float speed;
+			GAME::Enemy* enemyComponent = registry.try_get<GAME::Enemy>(entity);
+			if (enemyComponent) {
+				speed = enemyComponent->speed;
+			}
+			else {
+				speed = (*config).at("EnemyGreen").at("speed").as<float>();
 			}
 
+			GW::MATH::GVector::ScaleF(directionVector, speed, directionalMovement.velocity);
 
-			std::vector<entt::entity>& temp = waveLogic->waveInfo.lanesContainer[i].enemiesInLane;
-			for (auto it = temp.begin(); it != temp.end();)
-			{
-
-				entt::entity& entity = *it;
-
-				if (!registry.valid(entity) && !registry.all_of<GAME::EntityDirectionalMovement>(entity))
-				{
-					++it;
-					continue; //no entity found with movement
-				}
-				
-
-				///flip a coin, see if this enemy should dive now
-				if (randomNumber(0, 1, true))
-				{
-					++it;
-					continue;
-				}
-
-
-				//set vector to straight down
-				GAME::EntityDirectionalMovement& directionalMovement = registry.get<GAME::EntityDirectionalMovement>(entity);
-				GW::MATH::GVECTORF directionVector = GW::MATH::GVECTORF{ {
-				0.0f,
-				0.0f,
-				-1,
-				0.0f
-				} };
-				GW::MATH::GVector::NormalizeF(directionVector, directionVector);
-				
-				float speed;
-				GAME::Enemy* enemyComponent = registry.try_get<GAME::Enemy>(entity);
-				if (enemyComponent) {
-					speed = enemyComponent->speed;
-				}
-				else {
-					speed = (*config).at("EnemyGreen").at("speed").as<float>();
-				}
-
-				GW::MATH::GVector::ScaleF(directionVector, speed, directionalMovement.velocity);
-
-				//set state to dive
-				GAME::enemyState& state = *registry.try_get<GAME::enemyState>(entity);
-				state.currentState = state.Diving;
+			//set state to dive
+			GAME::enemyState& state = registry.get<GAME::enemyState>(entity);
+			state.currentState = state.Diving;
 
-				//remove from vector
-				temp.erase(it);
+			//leave the lane, O(1) unlink through Destroy_LaneMember
+			registry.remove<GAME::LaneMember>(entity);
+			//may be resting or on its way back from shooting, the dive takes over
+			registry.remove<GAME::EnemyScript, GAME::PathFollower, GAME::AtRest>(entity);
 
-				//reset dive cooldown
-				waveLogic->waveInfo.lanesContainer[i].timeSinceLastEnemyDive = 0.0f;
-			}
+			anyDove = true;
+			entity = next;
 		}
+
+		return anyDove;
 	}
 
 
@@ -783,84 +714,148 @@ namespace GAME
 	}
 
 
-	void applyStageModifiers(entt::registry& registry)
+	void applyStageModifiers(entt::registry& registry, GAME::WaveLogic& waveLogic)
 	{
+		std::shared_ptr<const GameConfig> config = registry.ctx().get<UTIL::Config>().gameConfig;
+
 		//enemy count for this stage
 		int defaultEnemyCount = (*config).at("StageInfo").at("numberOfEnemiesInStage").as<int>();
 		int modifierBonus = (*config).at("StageInfo").at("stageCountModifier").as<int>();
-		int newCount = defaultEnemyCount + (waveLogic->stageInfo.StageNumber * modifierBonus);
+		int newCount = defaultEnemyCount + (waveLogic.stageInfo.StageNumber * modifierBonus);
 		//clamp value againt max count
 		int maxCount = (*config).at("StageInfo").at("stageCountCap").as<int>();
-		waveLogic->stageInfo.EnemiesToSpawn = std::clamp(newCount, defaultEnemyCount, maxCount);
+		waveLogic.stageInfo.EnemiesToSpawn = std::clamp(newCount, defaultEnemyCount, maxCount);
 
 
 		//enemy speed boost for this stage
-		float newSpeed = (*config).at("StageInfo").at("stageSpeedModifier").as<float>() * waveLogic->stageInfo.StageNumber;
+		float newSpeed = (*config).at("StageInfo").at("stageSpeedModifier").as<float>() * waveLogic.stageInfo.StageNumber;
 		//clamp value againt max speed
 		float maxSpeed = (*config).at("StageInfo").at("stageSpeedCap").as<float>();
-		waveLogic->stageInfo.SpeedModifier = std::clamp(newSpeed, 0.0f, maxSpeed);
+		waveLogic.stageInfo.SpeedModifier = std::clamp(newSpeed, 0.0f, maxSpeed);
+
+
+		//shooting timer starts over with the stage
+		GAME::CancelBehaviour(registry, waveLogic.shootingScript);
+		waveLogic.shootingScript = GAME::StartBehaviour(registry, shootingScript(registry));
 	}
 
 
-	void checkForEnemyShoot(entt::registry& registry)
+	///send a random enemy resting in its lane to shoot from above the player, false if nobody can go
+	bool sendEnemyToShoot(entt::registry& registry)
 	{
-		///see if it is time to have an alien break formation to shoot
+		std::shared_ptr<const GameConfig> config = registry.ctx().get<UTIL::Config>().gameConfig;
 
-		float deltaTime = registry.ctx().find<UTIL::DeltaTime>()->dtSec;
-		waveLogic->stageInfo.timeSinceLastEnemyShoot += deltaTime;
+		auto playerView = registry.view<GAME::Player, GAME::Transform>();
+		if (playerView.begin() == playerView.end())
+		{
+			return false; // No player exists (respawning)
+		}
 
-		if (waveLogic->stageInfo.timeSinceLastEnemyShoot >= (*config).at("StageInfo").at("timeBetweenEnemyShooting").as<int>())
+		//only aliens resting in lane are selected for shooting
+		auto restingView = registry.view<GAME::Enemy, GAME::AtRest>();
+		std::vector<entt::entity> entityVector(restingView.begin(), restingView.end());
+		if (entityVector.empty())
 		{
-			auto View = registry.view<GAME::Enemy, GAME::EntityDirectionalMovement, GAME::enemyState>();
+			return false;
+		}
 
-			std::vector<entt::entity> entityVector;
+		//select a random enemy in vector
+		entt::entity shooter = entityVector[randomNumber(registry, 0, entityVector.size())];
 
+		// Player exists, target them (add extra height to z value so ship is above player
+		GAME::Transform& playerTransform = playerView.get<GAME::Transform>(*playerView.begin());
+		float xPos = playerTransform.transformMatrix.row4.x;
+		float zPos = playerTransform.transformMatrix.row4.z + (*config).at("StageInfo").at("shooterDistanceFromPlayer").as<int>();
 
-			for (auto& viewEntity : View)
-			{
-				GAME::enemyState& state = View.get<GAME::enemyState>(viewEntity);
+		GAME::StartEnemyScript(registry, shooter, enemyShootScript(registry, shooter, xPos, zPos));
+		return true;
+	}
 
-				//only select aliens that are in lane for shooting
-				if (state.currentState != state.InLane)
-				{
-					continue;
-				}
 
-				entityVector.push_back(viewEntity);
-			}
+	void settleInLane(entt::registry& registry, entt::entity enemy)
+	{
+		GAME::enemyState& state = registry.get<GAME::enemyState>(enemy);
+		state.currentState = state.InLane;
+		registry.remove<GAME::PathFollower>(enemy);
+		registry.emplace_or_replace<GAME::AtRest>(enemy);
+	}
+
+
+	//*** SCRIPTS ***//
+
+	GAME::BehaviourTask enemyEntryScript(entt::registry& registry, entt::entity self)
+	{
+		//entry loop, then on to its slot in the lane
+		co_await GAME::WaitArrival{ self };
+		settleInLane(registry, self);
+	}
+
+
+	GAME::BehaviourTask enemyShootScript(entt::registry& registry, entt::entity self, float targetX, float targetZ)
+	{
+		registry.remove<GAME::AtRest>(self);
+		registry.get<GAME::enemyState>(self).currentState = GAME::enemyState::Shooting;
+
+		//fly straight to the spot above the player
+		GAME::StartPathLeg(registry, self, targetX, targetZ);
+		co_await GAME::WaitArrival{ self };
+
+		//have enemy shoot down
+		spawnEnemyBullet(registry, self);
+
+		//move back to lane
+		registry.get<GAME::enemyState>(self).currentState = GAME::enemyState::MovingToLane;
+		const GW::MATH::GMATRIXF& laneSlot = registry.get<GAME::EntityDirectionalMovement>(self).finalDestination;
+		GAME::StartPathLeg(registry, self, laneSlot.row4.x, laneSlot.row4.z);
+		co_await GAME::WaitArrival{ self };
 
-			if (!entityVector.empty())
+		settleInLane(registry, self);
+	}
+
+
+	GAME::BehaviourTask laneScript(entt::registry& registry, entt::entity waveEntity, int laneIndex)
+	{
+		std::shared_ptr<const GameConfig> config = registry.ctx().get<UTIL::Config>().gameConfig;
+		float delay = (*config).at("WaveInfo").at("timeBetweenDives").as<float>();
+
+		//wave stays in the lane for the lane's duration
+		co_await GAME::WaitSeconds{ static_cast<float>(registry.get<GAME::WaveLogic>(waveEntity).waveInfo.lanesContainer[laneIndex].duration) };
+
+		//then enemies dive out one cooldown at a time until checkLanesForClearing frees the lane (and cancels this)
+		while (true)
+		{
+			co_await GAME::WaitSeconds{ delay };
+
+			//every enemy can lose the coin flip, try again next frame until one goes
+			while (!diveFromLane(registry, waveEntity, laneIndex))
 			{
-				//select a random enemy in vector
-				int index = randomNumber(0, entityVector.size());
+				co_await GAME::WaitSeconds{ 0.0f };
+			}
+		}
+	}
 
-				auto& shooter = entityVector[index];
-				
 
-				//set destination to above player
-				auto playerView = registry.view<GAME::Player, GAME::Transform>();
+	GAME::BehaviourTask shootingScript(entt::registry& registry)
+	{
+		std::shared_ptr<const GameConfig> config = registry.ctx().get<UTIL::Config>().gameConfig;
+		float interval = static_cast<float>((*config).at("StageInfo").at("timeBetweenEnemyShooting").as<int>());
 
+		while (true)
+		{
+			co_await GAME::WaitSeconds{ interval };
+
+			while (!sendEnemyToShoot(registry))
+			{
+				auto playerView = registry.view<GAME::Player>();
 				if (playerView.begin() == playerView.end())
 				{
-					// No player exists (respawning), do nothing
+					//sleep through the respawn delay
+					co_await GAME::WaitPlayerEvent{ GAME::PlayerEvent::Spawned };
 				}
 				else
 				{
-					// Player exists, target them (add extra height to z value so ship is above player
-										
-					GAME::enemyState& state = View.get<GAME::enemyState>(shooter);
-					state.currentState = state.Shooting;
-					
-					GAME::Transform& playerTransform = playerView.get<GAME::Transform>(*playerView.begin());
-
-					float xPos = playerTransform.transformMatrix.row4.x;
-					float zPos = playerTransform.transformMatrix.row4.z + (*config).at("StageInfo").at("shooterDistanceFromPlayer").as<int>();
-
-					//set direction towards player
-					setDestination(registry, shooter, xPos, zPos);
-
-					//reset timer
-					waveLogic->stageInfo.timeSinceLastEnemyShoot = 0.0f;
+					//nobody resting in a lane yet, check again next frame
+					co_await GAME::WaitSeconds{ 0.0f };
 				}
 			}
 		}
@@ -869,6 +864,7 @@ namespace GAME
 
 	void spawnEnemyBullet(entt::registry& registry, entt::entity theShooter)
 	{
+		std::shared_ptr<const GameConfig> config = registry.ctx().get<UTIL::Config>().gameConfig;
 
 		if (!registry.valid(theShooter))
 		{
@@ -931,8 +927,20 @@ namespace GAME
 
 
 		//play shooting noise
-		auto& audio = registry.ctx().get<GameAudio>();
-		audio.Play("blaster");
+		PlayGameSound(registry, "blaster");
+	}
+
+
+	void Destroy_WaveLogic(entt::registry& registry, entt::entity entity)
+	{
+		GAME::WaveLogic& waveLogic = registry.get<GAME::WaveLogic>(entity);
+
+		//scripts hold on to this entity, they can't outlive it
+		GAME::CancelBehaviour(registry, waveLogic.shootingScript);
+		for (GAME::Lane& lane : waveLogic.waveInfo.lanesContainer)
+		{
+			GAME::CancelBehaviour(registry, lane.script);
+		}
 	}
 
 
@@ -940,6 +948,8 @@ namespace GAME
 	{
 		registry.on_construct<GAME::WaveLogic>().connect<Construct_WaveLogic>();
 		registry.on_update<GAME::WaveLogic>().connect<Update_WaveLogic>();
+		registry.on_destroy<GAME::WaveLogic>().connect<Destroy_WaveLogic>();
+		registry.on_destroy<GAME::LaneMember>().connect<Destroy_LaneMember>();
 	}
 
 }
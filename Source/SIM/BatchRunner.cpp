@@ -0,0 +1,447 @@
+#include "BatchRunner.h"
+#include "RunnerUtilities.h"
+#include "../UTIL/Utilities.h"
+#include "../UTIL/JobSystem.h"
+#include "../DRAW/DrawComponents.h"
+#include "../GAME/GameComponents.h"
+#include "../CCL.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+
+namespace SIM
+{
+	//*** HELPERS ***//
+
+	// Swallows the gameplay code's console chatter while thousands of games run at once
+	class NullBuffer : public std::streambuf
+	{
+	protected:
+		int overflow(int c) override { return traits_type::not_eof(c); }
+	};
+
+	// Log-scale histogram of frame costs, 16 buckets per power of two (about 4% resolution)
+	struct FrameCostHistogram
+	{
+		static constexpr int subBuckets = 16;
+		static constexpr int bucketCount = 32 * subBuckets;
+		static constexpr double minMicroseconds = 0.125;
+
+		std::array<uint64_t, bucketCount> buckets = {};
+		uint64_t frames = 0;
+		double maxMicroseconds = 0.0;
+
+		void Add(double microseconds)
+		{
+			int bucket = 0;
+			if (microseconds > minMicroseconds) {
+				bucket = (std::min)(int(std::log2(microseconds / minMicroseconds) * subBuckets), bucketCount - 1);
+			}
+			++buckets[bucket];
+			++frames;
+			maxMicroseconds = (std::max)(maxMicroseconds, microseconds);
+		}
+
+		void Merge(const FrameCostHistogram& other)
+		{
+			for (int i = 0; i < bucketCount; ++i) {
+				buckets[i] += other.buckets[i];
+			}
+			frames += other.frames;
+			maxMicroseconds = (std::max)(maxMicroseconds, other.maxMicroseconds);
+		}
+
+		// upper bound of the bucket holding the requested percentile
+		double Percentile(double percent) const
+		{
+			if (frames == 0) {
+				return 0.0;
+			}
+			uint64_t target = uint64_t(std::ceil(frames * percent / 100.0));
+			uint64_t seen = 0;
+			for (int i = 0; i < bucketCount; ++i) {
+				seen += buckets[i];
+				if (seen >= target && seen > 0) {
+					return (std::min)(minMicroseconds * std::exp2((i + 1) / double(subBuckets)), maxMicroseconds);
+				}
+			}
+			return maxMicroseconds;
+		}
+	};
+
+	struct GameResult
+	{
+		int stageReached = 1;
+		int enemiesKilled = 0;
+		int enemiesEscaped = 0;
+		long score = 0;
+		double simulatedSeconds = 0.0;
+		uint64_t frames = 0;
+		bool gameOver = false;
+	};
+
+	// Simple scripted player: dodge whatever is falling onto it, otherwise line up under the
+	// closest enemy and shoot. Good enough to push games deep into the stages for balance numbers.
+	GAME::PlayerIntent ThinkBot(entt::registry& registry)
+	{
+		constexpr float dodgeRange = 20.0f;    // how far above the player a threat is noticed
+		constexpr float dodgeWidth = 4.0f;     // horizontal half width of the player's danger column
+		constexpr float aimTolerance = 0.5f;
+		constexpr float fireTolerance = 3.0f;
+		constexpr float arenaHalfWidth = 40.0f; // player movement is clamped just outside this
+
+		GAME::PlayerIntent intent;
+
+		auto playerView = registry.view<GAME::Player, GAME::Transform>(entt::exclude<GAME::ToDestroy>);
+		if (playerView.begin() == playerView.end()) {
+			return intent;
+		}
+		const GW::MATH::GMATRIXF& playerMatrix = playerView.get<GAME::Transform>(*playerView.begin()).transformMatrix;
+		float playerX = playerMatrix.row4.x;
+		float playerZ = playerMatrix.row4.z;
+
+		// dodge the closest threat dropping into the player's column
+		float dodge = 0.0f;
+		float closestThreat = dodgeRange;
+		auto considerThreat = [&](const GW::MATH::GMATRIXF& threat) {
+			float dx = threat.row4.x - playerX;
+			float dz = threat.row4.z - playerZ;
+			if (dz > 0.0f && dz < closestThreat && std::fabs(dx) < dodgeWidth) {
+				closestThreat = dz;
+				dodge = dx > 0.0f ? -1.0f : 1.0f;
+			}
+		};
+
+		auto bulletView = registry.view<GAME::EnemyBullet, GAME::Transform>();
+		for (auto entity : bulletView) {
+			considerThreat(bulletView.get<GAME::Transform>(entity).transformMatrix);
+		}
+
+		auto enemyView = registry.view<GAME::Enemy, GAME::Transform, GAME::enemyState>(entt::exclude<GAME::ToDestroy>);
+		for (auto entity : enemyView) {
+			const GAME::enemyState& state = enemyView.get<GAME::enemyState>(entity);
+			if (state.currentState == state.Diving || state.currentState == state.Leaving) {
+				considerThreat(enemyView.get<GAME::Transform>(entity).transformMatrix);
+			}
+		}
+
+		if (dodge != 0.0f) {
+			// do not dodge into the wall
+			if (std::fabs(playerX) > arenaHalfWidth && (playerX > 0.0f) == (dodge > 0.0f)) {
+				dodge = -dodge;
+			}
+			intent.moveX = dodge;
+			intent.fire = true;
+			return intent;
+		}
+
+		// line up under the closest enemy
+		bool foundTarget = false;
+		float bestDx = 0.0f;
+		for (auto entity : enemyView) {
+			float dx = enemyView.get<GAME::Transform>(entity).transformMatrix.row4.x - playerX;
+			if (!foundTarget || std::fabs(dx) < std::fabs(bestDx)) {
+				bestDx = dx;
+				foundTarget = true;
+			}
+		}
+
+		if (foundTarget) {
+			if (bestDx > aimTolerance) {
+				intent.moveX = 1.0f;
+			}
+			else if (bestDx < -aimTolerance) {
+				intent.moveX = -1.0f;
+			}
+			intent.fire = std::fabs(bestDx) < fireTolerance;
+		}
+
+		return intent;
+	}
+
+	GameResult RunGame(
+		const BatchSettings& settings,
+		const std::shared_ptr<GameConfig>& config,
+		const DRAW::CPULevel& level,
+		unsigned int seed,
+		FrameCostHistogram& frameCosts)
+	{
+		entt::registry registry;
+		CCL::InitializeComponentLogic(registry);
+
+		// shared, read-only config; aggregate init skips Config's default (which would reload the ini)
+		registry.ctx().emplace<UTIL::Config>(UTIL::Config{ config });
+		registry.ctx().emplace<UTIL::Random>(UTIL::Random(1, 100, seed));
+		registry.ctx().emplace<UTIL::DeltaTime>(UTIL::DeltaTime{ settings.fixedDeltaTime });
+		registry.ctx().emplace<GAME::SpecialCooldown>();
+		registry.ctx().emplace<GAME::PlayerTotalScore>(GAME::PlayerTotalScore{ 0 });
+		registry.ctx().emplace<GAME::HUDData>();
+		registry.ctx().emplace<GAME::RunStats>();
+		registry.ctx().emplace<GAME::PlayerIntent>();
+
+		// no VulkanRenderer on this entity, so GPULevel only builds mesh entities and colliders
+		entt::entity levelEntity = registry.create();
+		registry.emplace<DRAW::CPULevel>(levelEntity, level);
+		registry.emplace<DRAW::GPULevel>(levelEntity);
+
+		entt::entity gameManagerEntity = registry.create();
+		registry.emplace<GAME::GameManager>(gameManagerEntity);
+		registry.ctx().emplace<entt::entity>(gameManagerEntity);
+
+		entt::entity waveLogicEntity = registry.create();
+		registry.emplace<GAME::WaveLogic>(waveLogicEntity);
+
+		GAME::SpawnPlayer(registry);
+		GAME::WaveStageFunctions::playStage(registry, 1);
+
+		GameResult result;
+		uint64_t maxFrames = uint64_t(settings.maxGameSeconds / settings.fixedDeltaTime);
+		while (result.frames < maxFrames && !registry.ctx().find<GAME::GameOver>()) {
+			auto frameStart = std::chrono::steady_clock::now();
+
+			// context entries are looked up every frame, gameplay code adds and erases its own as it runs
+			registry.ctx().get<UTIL::DeltaTime>().dtSec = settings.fixedDeltaTime;
+			registry.ctx().get<GAME::PlayerIntent>() = ThinkBot(registry);
+			registry.patch<GAME::GameManager>(gameManagerEntity);
+
+			frameCosts.Add(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - frameStart).count());
+			++result.frames;
+		}
+
+		result.gameOver = registry.ctx().find<GAME::GameOver>() != nullptr;
+		result.simulatedSeconds = result.frames * settings.fixedDeltaTime;
+		const GAME::RunStats& runStats = registry.ctx().get<GAME::RunStats>();
+		result.stageReached = runStats.highestStage;
+		result.enemiesKilled = runStats.enemiesKilled;
+		result.enemiesEscaped = runStats.enemiesEscaped;
+		if (GAME::Score* score = registry.ctx().find<GAME::Score>()) {
+			result.score = score->score;
+		}
+
+		return result;
+	}
+
+	std::string BuildReport(
+		const BatchSettings& settings,
+		unsigned int threadCount,
+		const std::vector<GameResult>& results,
+		const FrameCostHistogram& frameCosts,
+		double wallSeconds)
+	{
+		std::vector<int> stages;
+		std::vector<long> scores;
+		std::vector<int> kills;
+		std::vector<int> escapes;
+		std::map<int, int> stageCounts;
+		int gameOvers = 0;
+		double simulatedSeconds = 0.0;
+		uint64_t totalKills = 0;
+		uint64_t totalEscapes = 0;
+
+		for (const GameResult& result : results) {
+			stages.push_back(result.stageReached);
+			scores.push_back(result.score);
+			kills.push_back(result.enemiesKilled);
+			escapes.push_back(result.enemiesEscaped);
+			++stageCounts[result.stageReached];
+			gameOvers += result.gameOver ? 1 : 0;
+			simulatedSeconds += result.simulatedSeconds;
+			totalKills += result.enemiesKilled;
+			totalEscapes += result.enemiesEscaped;
+		}
+		std::sort(stages.begin(), stages.end());
+		std::sort(scores.begin(), scores.end());
+		std::sort(kills.begin(), kills.end());
+		std::sort(escapes.begin(), escapes.end());
+
+		double games = double((std::max)(results.size(), size_t(1)));
+
+		std::ostringstream report;
+		report << std::fixed << std::setprecision(2);
+		report << "=== Batch simulation report ===\n";
+		report << "games: " << results.size() << "   threads: " << threadCount << "   seed: " << settings.seed
+			<< "   dt: " << settings.fixedDeltaTime << "s   time limit: " << settings.maxGameSeconds << "s\n";
+		report << "wall time: " << wallSeconds << "s\n";
+		report << "throughput: " << results.size() / wallSeconds << " games/s   "
+			<< frameCosts.frames / wallSeconds << " frames/s   "
+			<< simulatedSeconds / wallSeconds << "x real time\n";
+		report << "outcome: " << gameOvers << " game over, " << (results.size() - gameOvers) << " hit the time limit\n";
+
+		report << "\nstage reached   mean " << std::accumulate(stages.begin(), stages.end(), 0.0) / games
+			<< "   p10 " << SortedPercentile(stages, 10) << "   p50 " << SortedPercentile(stages, 50)
+			<< "   p90 " << SortedPercentile(stages, 90) << "   max " << (stages.empty() ? 0 : stages.back()) << "\n";
+		for (const auto& [stage, count] : stageCounts) {
+			report << "  stage " << std::setw(3) << stage << ": " << std::setw(7) << count
+				<< " (" << 100.0 * count / games << "%)\n";
+		}
+
+		report << "\nenemies killed  mean " << totalKills / games
+			<< "   p10 " << SortedPercentile(kills, 10) << "   p50 " << SortedPercentile(kills, 50)
+			<< "   p90 " << SortedPercentile(kills, 90) << "\n";
+		report << "enemies escaped mean " << totalEscapes / games
+			<< "   p10 " << SortedPercentile(escapes, 10) << "   p50 " << SortedPercentile(escapes, 50)
+			<< "   p90 " << SortedPercentile(escapes, 90) << "\n";
+		report << "kill ratio      " << (totalKills + totalEscapes > 0 ? 100.0 * totalKills / (totalKills + totalEscapes) : 0.0) << "%\n";
+
+		report << "\nscore           mean " << std::accumulate(scores.begin(), scores.end(), 0.0) / games
+			<< "   p10 " << SortedPercentile(scores, 10) << "   p50 " << SortedPercentile(scores, 50)
+			<< "   p90 " << SortedPercentile(scores, 90) << "   max " << (scores.empty() ? 0 : scores.back()) << "\n";
+
+		report << "\nframe cost (us) p50 " << frameCosts.Percentile(50) << "   p90 " << frameCosts.Percentile(90)
+			<< "   p99 " << frameCosts.Percentile(99) << "   p99.9 " << frameCosts.Percentile(99.9)
+			<< "   max " << frameCosts.maxMicroseconds << "\n";
+
+		return report.str();
+	}
+
+	//*** BATCH ***//
+
+	bool ParseBatchSettings(int argc, char** argv, BatchSettings& settings)
+	{
+		bool batchRequested = false;
+		std::string badArgument;
+		for (int i = 1; i < argc; ++i) {
+			std::string arg = argv[i];
+			bool hasValue = i + 1 < argc;
+			std::string value = hasValue ? argv[i + 1] : "";
+			bool valid = true;
+			if (arg == "--batch") {
+				valid = ReadUnsigned(value, settings.gameCount) && settings.gameCount > 0;
+				batchRequested = true;
+			}
+			else if (arg == "--threads") {
+				valid = ReadUnsigned(value, settings.threadCount);
+			}
+			else if (arg == "--seed") {
+				valid = ReadUnsigned(value, settings.seed);
+			}
+			else if (arg == "--dt") {
+				valid = ReadSeconds(value, settings.fixedDeltaTime);
+			}
+			else if (arg == "--max-seconds") {
+				valid = ReadSeconds(value, settings.maxGameSeconds);
+			}
+			else if (arg == "--report") {
+				settings.reportPath = value;
+			}
+			else {
+				continue;
+			}
+			// a trailing option has nothing to read, it must not fall back to its default
+			if (!hasValue && badArgument.empty()) {
+				badArgument = arg + " <missing value>";
+			}
+			else if (!valid && badArgument.empty()) {
+				badArgument = arg + " " + value;
+			}
+			++i;
+		}
+
+		// --dt and --report are shared with the render benchmark, only complain when the batch is what was asked for
+		if (batchRequested && !badArgument.empty()) {
+			std::cerr << "Batch: could not read \"" << badArgument << "\"\n"
+				<< "usage: --batch <games> [--threads n] [--seed n] [--dt seconds] [--max-seconds seconds] [--report file]"
+				<< std::endl;
+			settings.argumentsValid = false;
+		}
+		return batchRequested;
+	}
+
+	int RunBatch(const BatchSettings& settings)
+	{
+		std::shared_ptr<GameConfig> config = std::make_shared<GameConfig>();
+
+		// load the level once, every game copies the parsed data (minus the vertex/index data only the GPU needs)
+		DRAW::CPULevel level = {};
+		level.levelFile = (*config).at("Level1").at("levelFile").as<std::string>();
+		level.modelPath = (*config).at("Level1").at("modelPath").as<std::string>();
+		GW::SYSTEM::GLog log;
+		log.EnableConsoleLogging(true);
+		if (!level.levelData.LoadLevel(level.levelFile.c_str(), level.modelPath.c_str(), log)) {
+			std::cerr << "Batch: could not load level from " << level.levelFile << std::endl;
+			return -1;
+		}
+		level.levelData.levelVertices.clear();
+		level.levelData.levelVertices.shrink_to_fit();
+		level.levelData.levelIndices.clear();
+		level.levelData.levelIndices.shrink_to_fit();
+
+		// --threads 1 runs on the calling thread only, JobSystem(0) would mean every hardware thread
+		std::unique_ptr<UTIL::JobSystem> jobs;
+		if (settings.threadCount != 1) {
+			jobs = std::make_unique<UTIL::JobSystem>(settings.threadCount > 1 ? settings.threadCount - 1 : 0);
+		}
+		unsigned int threadCount = jobs ? jobs->ThreadCount() : 1;
+
+		std::vector<GameResult> results(settings.gameCount);
+		FrameCostHistogram frameCosts;
+		std::mutex mergeMutex;
+
+		std::ostream console(std::cout.rdbuf());
+		NullBuffer nullBuffer;
+		std::streambuf* coutBuffer = std::cout.rdbuf(&nullBuffer);
+		std::streambuf* cerrBuffer = std::cerr.rdbuf(&nullBuffer);
+
+		console << "Batch: running " << settings.gameCount << " games on " << threadCount << " threads..." << std::endl;
+		auto batchStart = std::chrono::steady_clock::now();
+
+		std::atomic<unsigned int> gamesDone = 0;
+		unsigned int progressStep = (std::max)(settings.gameCount / 10, 1u);
+		auto runGames = [&](size_t begin, size_t end) {
+			FrameCostHistogram localCosts;
+			for (size_t game = begin; game < end; ++game) {
+				results[game] = RunGame(settings, config, level, settings.seed + unsigned(game), localCosts);
+			}
+
+			std::lock_guard<std::mutex> lock(mergeMutex);
+			frameCosts.Merge(localCosts);
+			unsigned int done = gamesDone += unsigned(end - begin);
+			if (done % progressStep < end - begin || done == settings.gameCount) {
+				console << "  " << done << " / " << settings.gameCount << std::endl;
+			}
+		};
+
+		if (!jobs) {
+			for (size_t game = 0; game < settings.gameCount; ++game) {
+				runGames(game, game + 1);
+			}
+		}
+		else {
+			// one game per batch, games run for very different lengths
+			jobs->ParallelFor(settings.gameCount, 1, runGames);
+		}
+
+		double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - batchStart).count();
+
+		std::cout.rdbuf(coutBuffer);
+		std::cerr.rdbuf(cerrBuffer);
+
+		std::string report = BuildReport(settings, threadCount, results, frameCosts, wallSeconds);
+		std::cout << report;
+
+		if (!settings.reportPath.empty()) {
+			std::ofstream file(settings.reportPath);
+			if (!file) {
+				std::cerr << "Batch: could not write report to " << settings.reportPath << std::endl;
+				return -1;
+			}
+			file << report;
+		}
+
+		return 0;
+	}
+
+} // namespace SIM
@@ -0,0 +1,29 @@
+#ifndef BATCH_RUNNER_H_
+#define BATCH_RUNNER_H_
+
+#include <string>
+
+namespace SIM
+{
+	/// Settings for a headless batch of games, filled from the command line (--batch N ...)
+	struct BatchSettings
+	{
+		unsigned int gameCount = 1000;
+		unsigned int threadCount = 0;      // 0 = every hardware thread
+		unsigned int seed = 1;             // game i is seeded with seed + i, so any single game can be replayed
+		double fixedDeltaTime = 1.0 / 60.0;
+		double maxGameSeconds = 600.0;     // games the bot never loses are cut off here
+		std::string reportPath;            // optional, report is always printed to the console
+		bool argumentsValid = true;        // false when a value could not be read, the usage has been printed
+	};
+
+	/// Reads --batch / --threads / --seed / --dt / --max-seconds / --report.
+	/// Returns false when --batch is not on the command line.
+	bool ParseBatchSettings(int argc, char** argv, BatchSettings& settings);
+
+	/// Plays settings.gameCount independent games across all cores with a bot player and
+	/// prints stage/kill/escape/score distributions, frame cost percentiles and games per second
+	int RunBatch(const BatchSettings& settings);
+
+} // namespace SIM
+#endif // !BATCH_RUNNER_H_
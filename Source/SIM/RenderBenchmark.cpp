@@ -0,0 +1,276 @@
+#include "RenderBenchmark.h"
+#include "RunnerUtilities.h"
+#include "../UTIL/Utilities.h"
+#include "../DRAW/DrawComponents.h"
+#include "../CCL.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace SIM
+{
+	//*** HELPERS ***//
+
+	static void AppendDistribution(std::ostringstream& out, const char* name, std::vector<double> milliseconds)
+	{
+		std::sort(milliseconds.begin(), milliseconds.end());
+		double total = 0.0;
+		for (double value : milliseconds) {
+			total += value;
+		}
+		double mean = milliseconds.empty() ? 0.0 : total / milliseconds.size();
+		out << "  " << std::left << std::setw(8) << name << std::right << std::fixed << std::setprecision(3)
+			<< " mean " << mean << "  p50 " << SortedPercentile(milliseconds, 50.0)
+			<< "  p95 " << SortedPercentile(milliseconds, 95.0) << "  p99 " << SortedPercentile(milliseconds, 99.0)
+			<< "  max " << (milliseconds.empty() ? 0.0 : milliseconds.back()) << " ms\n";
+	}
+
+	// Level geometry streams in and the pipelines build on worker threads; until both are there a frame is only a clear
+	static bool SceneReady(entt::registry& registry, entt::entity display)
+	{
+		if (registry.get<DRAW::VulkanRenderer>(display).pipeline == VK_NULL_HANDLE) {
+			return false;
+		}
+		auto* vertices = registry.try_get<DRAW::VulkanVertexBuffer>(display);
+		auto* indices = registry.try_get<DRAW::VulkanIndexBuffer>(display);
+		auto* statics = registry.try_get<DRAW::VulkanStaticInstanceBuffer>(display);
+		return vertices && indices &&
+			DRAW::IsUploadComplete(registry, display, vertices->uploadId) &&
+			DRAW::IsUploadComplete(registry, display, indices->uploadId) &&
+			(!statics || DRAW::IsUploadComplete(registry, display, statics->uploadId));
+	}
+
+	// GPULevel only loads the level's dynamic models as DoNotRender templates. Scatter copies of them over and
+	// around the view, each drifting across the xz plane, so culling, LOD selection, the draw sort and the
+	// MotionClock have work every frame
+	static unsigned int SpawnMovingInstances(entt::registry& registry, unsigned int count, unsigned int seed)
+	{
+		DRAW::ModelManager* modelManager = registry.ctx().find<DRAW::ModelManager>();
+		if (!modelManager) {
+			return 0;
+		}
+		std::vector<const DRAW::MeshCollection*> templates;
+		for (const auto& [name, meshCollection] : modelManager->meshCollections) {
+			if (!meshCollection.entities.empty()) {
+				templates.push_back(&meshCollection);
+			}
+		}
+		if (templates.empty()) {
+			return 0;
+		}
+
+		std::mt19937 generator(seed);
+		std::uniform_int_distribution<size_t> pickTemplate(0, templates.size() - 1);
+		std::uniform_real_distribution<float> spread(-60.0f, 60.0f); // wider than the view, some start outside it
+		std::uniform_real_distribution<float> height(-30.0f, 20.0f); // spread in depth too, for the LODs and depth buckets
+		std::uniform_real_distribution<float> speed(-6.0f, 6.0f);
+		for (unsigned int i = 0; i < count; ++i) {
+			DRAW::MeshCollection copies;
+			DRAW::CopyComponents(registry, templates[pickTemplate(generator)]->entities, copies);
+			float x = spread(generator);
+			float y = height(generator);
+			float z = spread(generator);
+			float velocityX = speed(generator);
+			float velocityZ = speed(generator);
+
+			// transform is the position at MotionClock 0, the vertex shader adds velocity * motionTime
+			for (const entt::entity& meshEntity : copies.entities) {
+				DRAW::GPUInstance& gpuInstance = registry.get<DRAW::GPUInstance>(meshEntity);
+				gpuInstance.transform.row4.x = x;
+				gpuInstance.transform.row4.y = y;
+				gpuInstance.transform.row4.z = z;
+				gpuInstance.velocity[0] = velocityX;
+				gpuInstance.velocity[1] = velocityZ;
+			}
+		}
+		return count;
+	}
+
+	//*** API ***//
+
+	bool ParseRenderBenchmarkSettings(int argc, char** argv, RenderBenchmarkSettings& settings)
+	{
+		bool benchmarkRequested = false;
+		std::string badArgument;
+		for (int i = 1; i < argc; ++i) {
+			std::string arg = argv[i];
+			bool hasValue = i + 1 < argc;
+			std::string value = hasValue ? argv[i + 1] : "";
+			bool valid = true;
+			if (arg == "--render-benchmark") {
+				valid = ReadUnsigned(value, settings.frameCount) && settings.frameCount > 0;
+				benchmarkRequested = true;
+			}
+			else if (arg == "--size") {
+				size_t separator = value.find('x');
+				valid = separator != std::string::npos &&
+					ReadUnsigned(value.substr(0, separator), settings.width) && settings.width > 0 &&
+					ReadUnsigned(value.substr(separator + 1), settings.height) && settings.height > 0;
+			}
+			else if (arg == "--instances") {
+				valid = ReadUnsigned(value, settings.instanceCount);
+			}
+			else if (arg == "--seed") {
+				valid = ReadUnsigned(value, settings.seed);
+			}
+			else if (arg == "--dump-frames") {
+				settings.dumpFolder = value;
+			}
+			else if (arg == "--dt") {
+				valid = ReadSeconds(value, settings.fixedDeltaTime);
+			}
+			else if (arg == "--report") {
+				settings.reportPath = value;
+			}
+			else {
+				continue;
+			}
+			if (!hasValue && badArgument.empty()) {
+				badArgument = arg + " <missing value>";
+			}
+			else if (!valid && badArgument.empty()) {
+				badArgument = arg + " " + value;
+			}
+			++i;
+		}
+
+		// --seed, --dt and --report are shared with the batch runner, only complain when the benchmark is what was asked for
+		if (benchmarkRequested && !badArgument.empty()) {
+			std::cerr << "Render benchmark: could not read \"" << badArgument << "\"\n"
+				<< "usage: --render-benchmark <frames> [--size WxH] [--instances n] [--seed n] [--dump-frames folder] [--dt seconds] [--report file]"
+				<< std::endl;
+			settings.argumentsValid = false;
+		}
+		return benchmarkRequested;
+	}
+
+	int RunRenderBenchmark(const RenderBenchmarkSettings& settings)
+	{
+		std::shared_ptr<GameConfig> config = std::make_shared<GameConfig>();
+
+		entt::registry registry;
+		CCL::InitializeComponentLogic(registry);
+		registry.ctx().emplace<UTIL::Config>(UTIL::Config{ config });
+		DRAW::MotionClock& clock = registry.ctx().emplace<DRAW::MotionClock>();
+
+		// the same display entity GraphicsBehavior builds, with an offscreen target where the window would be
+		entt::entity display = registry.create();
+		DRAW::CPULevel level = {};
+		level.levelFile = (*config).at("Level1").at("levelFile").as<std::string>();
+		level.modelPath = (*config).at("Level1").at("modelPath").as<std::string>();
+		auto packedSetting = (*config).at("Level1").find("packedVertices");
+		if (packedSetting != (*config).at("Level1").end()) {
+			level.packedVertices = packedSetting->second.as<bool>();
+		}
+		registry.emplace<DRAW::CPULevel>(display, level);
+
+		DRAW::VulkanOffscreenTarget target;
+		target.width = (std::max)(settings.width, 1u);
+		target.height = (std::max)(settings.height, 1u);
+		registry.emplace<DRAW::VulkanOffscreenTarget>(display, target);
+
+		std::string vertShader = (*config).at("Shaders").at("vertex").as<std::string>();
+		std::string pixelShader = (*config).at("Shaders").at("pixel").as<std::string>();
+		registry.emplace<DRAW::VulkanRendererInitialization>(display,
+			DRAW::VulkanRendererInitialization{
+				vertShader, pixelShader,
+				{ {0.2f, 0.2f, 0.25f, 1} } , { 1.0f, 0u }, 75.f, 0.1f, 100.0f });
+		registry.emplace<DRAW::VulkanRenderer>(display);
+		registry.emplace<DRAW::GPULevel>(display);
+
+		// the game's opening camera, fixed so every run draws the same frames
+		GW::MATH::GMATRIXF camera;
+		GW::MATH::GVECTORF eye = { 0.0f, 45.0f, -5.0f };
+		GW::MATH::GVECTORF lookat = { 0.0f, 0.0f, 0.0f };
+		GW::MATH::GVECTORF up = { 0.0f, 1.0f, 0.0f };
+		GW::MATH::GMatrix::LookAtLHF(eye, lookat, up, camera);
+		GW::MATH::GMatrix::InverseF(camera, camera);
+		registry.emplace<DRAW::Camera>(display, DRAW::Camera{ camera });
+
+		unsigned int spawnedInstances = SpawnMovingInstances(registry, settings.instanceCount, settings.seed);
+
+		// warm-up frames are drawn but neither measured nor dumped
+		const double warmupLimitSeconds = 120.0;
+		auto warmupStart = std::chrono::steady_clock::now();
+		unsigned int warmupFrames = 0;
+		while (!SceneReady(registry, display)) {
+			if (std::chrono::duration<double>(std::chrono::steady_clock::now() - warmupStart).count() > warmupLimitSeconds) {
+				std::cerr << "Render benchmark: the scene was not ready after " << warmupLimitSeconds << " s" << std::endl;
+				registry.clear();
+				return -1;
+			}
+			registry.patch<DRAW::VulkanRenderer>(display);
+			++warmupFrames;
+		}
+
+		auto& renderer = registry.get<DRAW::VulkanRenderer>(display);
+		auto& offscreen = registry.get<DRAW::VulkanOffscreenTarget>(display);
+		DRAW::FinishOffscreenFrames(renderer, offscreen);
+		// numbered from 1 again, dumps of two runs line up file for file
+		offscreen.timings.clear();
+		offscreen.submittedFrames = 0;
+		offscreen.dumpFolder = settings.dumpFolder;
+		std::cout << "Render benchmark: ready after " << warmupFrames << " warm-up frames, rendering "
+			<< settings.frameCount << " frames with " << spawnedInstances << " moving instances..." << std::endl;
+
+		auto benchmarkStart = std::chrono::steady_clock::now();
+		for (unsigned int frame = 0; frame < settings.frameCount; ++frame) {
+			clock.seconds += settings.fixedDeltaTime;
+			registry.patch<DRAW::VulkanRenderer>(display);
+		}
+		DRAW::FinishOffscreenFrames(renderer, offscreen);
+		double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - benchmarkStart).count();
+
+		std::vector<double> recordMilliseconds, gpuMilliseconds;
+		for (const DRAW::VulkanOffscreenTarget::FrameTiming& timing : offscreen.timings) {
+			recordMilliseconds.push_back(timing.recordMilliseconds);
+			gpuMilliseconds.push_back(timing.gpuMilliseconds);
+		}
+
+		std::ostringstream report;
+		report << "Render benchmark: " << offscreen.timings.size() << " frames at " << offscreen.width << "x" << offscreen.height
+			<< " in " << std::fixed << std::setprecision(2) << wallSeconds << " s ("
+			<< (wallSeconds > 0.0 ? offscreen.timings.size() / wallSeconds : 0.0) << " frames/s)\n";
+		AppendDistribution(report, "record", recordMilliseconds);
+		if (offscreen.timestamps != VK_NULL_HANDLE) {
+			AppendDistribution(report, "gpu", gpuMilliseconds);
+		}
+		else {
+			report << "  gpu      no timestamp support on this queue\n";
+		}
+		if (!settings.dumpFolder.empty()) {
+			report << "  frames written to " << settings.dumpFolder << "\n";
+		}
+		std::cout << report.str();
+
+		int result = 0;
+		if (!settings.reportPath.empty()) {
+			std::ofstream file(settings.reportPath);
+			if (file) {
+				file << "frame,record_ms,gpu_ms\n";
+				for (const DRAW::VulkanOffscreenTarget::FrameTiming& timing : offscreen.timings) {
+					file << timing.frameNumber << "," << timing.recordMilliseconds << "," << timing.gpuMilliseconds << "\n";
+				}
+			}
+			else {
+				std::cerr << "Render benchmark: could not write report to " << settings.reportPath << std::endl;
+				result = -1;
+			}
+		}
+
+		// everything on the renderer entity goes through its on_destroy, the device last
+		registry.clear();
+		return result;
+	}
+
+} // namespace SIM
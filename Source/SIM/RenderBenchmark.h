@@ -0,0 +1,32 @@
+#ifndef RENDER_BENCHMARK_H_
+#define RENDER_BENCHMARK_H_
+
+#include <string>
+
+namespace SIM
+{
+	/// Settings for a headless render benchmark, filled from the command line (--render-benchmark N ...)
+	struct RenderBenchmarkSettings
+	{
+		unsigned int frameCount = 600;
+		unsigned int width = 1280, height = 720;
+		unsigned int instanceCount = 2000;  // moving copies of the level's dynamic models, 0 draws the static region only
+		unsigned int seed = 1;              // where the copies start and how they move, the same seed draws the same frames
+		double fixedDeltaTime = 1.0 / 60.0; // MotionClock step per frame, the frames do not depend on wall time
+		std::string dumpFolder;             // optional, every measured frame is written there as a PPM
+		std::string reportPath;             // optional, per-frame CSV; the summary is always printed to the console
+		bool argumentsValid = true;         // false when a value could not be read, the usage has been printed
+	};
+
+	/// Reads --render-benchmark / --size WxH / --instances / --seed / --dump-frames / --dt / --report.
+	/// Returns false when --render-benchmark is not on the command line.
+	bool ParseRenderBenchmarkSettings(int argc, char** argv, RenderBenchmarkSettings& settings);
+
+	/// Draws Level1 through the normal Update_VulkanRenderer path into offscreen images, with no window or
+	/// swapchain, so it runs on a software ICD (lavapipe). Spawns settings.instanceCount moving instances, waits
+	/// until the pipelines and level uploads are ready, then renders settings.frameCount frames and prints CPU
+	/// record and GPU time per frame.
+	int RunRenderBenchmark(const RenderBenchmarkSettings& settings);
+
+} // namespace SIM
+#endif // !RENDER_BENCHMARK_H_
@@ -0,0 +1,51 @@
+#include "RunnerUtilities.h"
+#include <cctype>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace SIM
+{
+	// std::stoul alone accepts "12x" and wraps "-1"
+	bool ReadUnsigned(const std::string& value, unsigned int& result)
+	{
+		if (value.empty() || !std::isdigit(static_cast<unsigned char>(value[0]))) {
+			return false;
+		}
+		try {
+			size_t used = 0;
+			unsigned long parsed = std::stoul(value, &used);
+			if (used != value.size() || parsed > (std::numeric_limits<unsigned int>::max)()) {
+				return false;
+			}
+			result = static_cast<unsigned int>(parsed);
+			return true;
+		}
+		catch (const std::invalid_argument&) {
+			return false;
+		}
+		catch (const std::out_of_range&) {
+			return false;
+		}
+	}
+
+	bool ReadSeconds(const std::string& value, double& result)
+	{
+		try {
+			size_t used = 0;
+			double parsed = std::stod(value, &used);
+			if (used != value.size() || !std::isfinite(parsed) || parsed <= 0.0) {
+				return false;
+			}
+			result = parsed;
+			return true;
+		}
+		catch (const std::invalid_argument&) {
+			return false;
+		}
+		catch (const std::out_of_range&) {
+			return false;
+		}
+	}
+
+} // namespace SIM
@@ -0,0 +1,32 @@
+#ifndef RUNNER_UTILITIES_H_
+#define RUNNER_UTILITIES_H_
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace SIM
+{
+	/// Nearest-rank percentile of an already sorted sample, T{} when the sample is empty.
+	template <typename T>
+	T SortedPercentile(const std::vector<T>& sorted, double percent)
+	{
+		if (sorted.empty()) {
+			return T{};
+		}
+		size_t rank = size_t(std::ceil(sorted.size() * percent / 100.0));
+		rank = (std::max)(rank, size_t(1));
+		return sorted[(std::min)(rank, sorted.size()) - 1];
+	}
+
+	/// Reads a command line value that has to be a whole unsigned number ("12x" and "-1" are rejected).
+	/// Leaves result untouched and returns false when it is not.
+	bool ReadUnsigned(const std::string& value, unsigned int& result);
+
+	/// Reads a command line value that has to be a positive, finite number of seconds.
+	/// Leaves result untouched and returns false when it is not.
+	bool ReadSeconds(const std::string& value, double& result);
+
+} // namespace SIM
+#endif // !RUNNER_UTILITIES_H_
@@ -0,0 +1,129 @@
+#include "JobSystem.h"
+#include <memory>
+
+namespace UTIL
+{
+	JobSystem::JobSystem(unsigned int threadCount)
+	{
+		if (threadCount == 0) {
+			unsigned int hardwareThreads = std::thread::hardware_concurrency();
+			threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+		}
+
+		workers.reserve(threadCount);
+		for (unsigned int i = 0; i < threadCount; ++i) {
+			workers.emplace_back(&JobSystem::WorkerLoop, this);
+		}
+	}
+
+	JobSystem::~JobSystem()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wakeWorkers.notify_all();
+
+		for (std::thread& worker : workers) {
+			worker.join();
+		}
+	}
+
+	void JobSystem::Submit(std::function<void()> job)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			jobs.push_back(std::move(job));
+			++unfinishedJobs;
+		}
+		wakeWorkers.notify_one();
+	}
+
+	void JobSystem::ParallelFor(size_t count, size_t batchSize, const std::function<void(size_t begin, size_t end)>& job)
+	{
+		if (count == 0) {
+			return;
+		}
+		if (batchSize == 0) {
+			batchSize = 1;
+		}
+
+		// shared so a helper that only starts after every batch is done can still look at it safely,
+		// that way the caller never waits on queued helpers and nested ParallelFor calls cannot deadlock
+		struct ParallelForState
+		{
+			std::function<void(size_t, size_t)> job;
+			size_t count;
+			size_t batchSize;
+			size_t batchCount;
+			std::atomic<size_t> nextBatch = 0;
+			std::atomic<size_t> batchesLeft = 0;
+			std::mutex doneMutex;
+			std::condition_variable done;
+		};
+		auto state = std::make_shared<ParallelForState>();
+		state->job = job;
+		state->count = count;
+		state->batchSize = batchSize;
+		state->batchCount = (count + batchSize - 1) / batchSize;
+		state->batchesLeft = state->batchCount;
+
+		// batches are claimed from a shared counter so fast threads pick up the slack of slow ones
+		auto runBatches = [state]() {
+			for (size_t batch = state->nextBatch++; batch < state->batchCount; batch = state->nextBatch++) {
+				size_t begin = batch * state->batchSize;
+				size_t end = begin + state->batchSize < state->count ? begin + state->batchSize : state->count;
+				state->job(begin, end);
+
+				if (--state->batchesLeft == 0) {
+					std::lock_guard<std::mutex> lock(state->doneMutex);
+					state->done.notify_all();
+				}
+			}
+		};
+
+		// no point waking more workers than there are batches for them to take
+		size_t helpers = state->batchCount - 1 < workers.size() ? state->batchCount - 1 : workers.size();
+		for (size_t i = 0; i < helpers; ++i) {
+			Submit(runBatches);
+		}
+
+		runBatches();
+
+		std::unique_lock<std::mutex> lock(state->doneMutex);
+		state->done.wait(lock, [&]() { return state->batchesLeft == 0; });
+	}
+
+	void JobSystem::Wait()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		jobsFinished.wait(lock, [this]() { return unfinishedJobs == 0; });
+	}
+
+	void JobSystem::WorkerLoop()
+	{
+		while (true) {
+			std::function<void()> job;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wakeWorkers.wait(lock, [this]() { return stopping || !jobs.empty(); });
+				if (stopping && jobs.empty()) {
+					return;
+				}
+				job = std::move(jobs.front());
+				jobs.pop_front();
+			}
+
+			job();
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				--unfinishedJobs;
+				if (unfinishedJobs == 0) {
+					jobsFinished.notify_all();
+				}
+			}
+		}
+	}
+
+} // namespace UTIL
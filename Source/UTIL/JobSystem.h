@@ -0,0 +1,52 @@
+#ifndef JOBSYSTEM_H_
+#define JOBSYSTEM_H_
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <vector>
+#include <atomic>
+
+namespace UTIL
+{
+	/// Fixed pool of worker threads for fanning work out across all cores.
+	/// Workers sleep when there is nothing queued, so an idle pool costs nothing per frame.
+	class JobSystem
+	{
+	public:
+		/// threadCount of 0 uses one worker per hardware thread (minus the caller)
+		explicit JobSystem(unsigned int threadCount = 0);
+		~JobSystem();
+
+		JobSystem(const JobSystem&) = delete;
+		JobSystem& operator=(const JobSystem&) = delete;
+
+		/// Queues a job, returns immediately
+		void Submit(std::function<void()> job);
+
+		/// Splits [0, count) into batches of batchSize and runs job(begin, end) on each.
+		/// The calling thread works too and the call returns once every batch is finished.
+		void ParallelFor(size_t count, size_t batchSize, const std::function<void(size_t begin, size_t end)>& job);
+
+		/// Blocks until every submitted job has finished
+		void Wait();
+
+		/// Number of threads that execute jobs, including the one calling ParallelFor
+		unsigned int ThreadCount() const { return static_cast<unsigned int>(workers.size()) + 1; }
+
+	private:
+		void WorkerLoop();
+
+		std::vector<std::thread> workers;
+		std::deque<std::function<void()>> jobs;
+		std::mutex mutex;
+		std::condition_variable wakeWorkers;
+		std::condition_variable jobsFinished;
+		size_t unfinishedJobs = 0;
+		bool stopping = false;
+	};
+
+} // namespace UTIL
+#endif // !JOBSYSTEM_H_
@@ -0,0 +1,51 @@
+#include "RadixSort.h"
+
+namespace UTIL
+{
+	void RadixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch)
+	{
+		const size_t count = entries.size();
+		if (count < 2) {
+			return;
+		}
+		scratch.resize(count);
+
+		// every byte's histogram in one read over the keys
+		uint32_t histograms[8][256] = {};
+		for (const SortEntry& entry : entries) {
+			for (int digit = 0; digit < 8; ++digit) {
+				++histograms[digit][(entry.key >> (digit * 8)) & 0xFF];
+			}
+		}
+
+		SortEntry* source = entries.data();
+		SortEntry* destination = scratch.data();
+		for (int digit = 0; digit < 8; ++digit) {
+			uint32_t* histogram = histograms[digit];
+			// all keys share this byte, the order would not change
+			if (histogram[(source[0].key >> (digit * 8)) & 0xFF] == count) {
+				continue;
+			}
+
+			uint32_t offset = 0;
+			for (int bucket = 0; bucket < 256; ++bucket) {
+				uint32_t bucketCount = histogram[bucket];
+				histogram[bucket] = offset;
+				offset += bucketCount;
+			}
+			for (size_t i = 0; i < count; ++i) {
+				destination[histogram[(source[i].key >> (digit * 8)) & 0xFF]++] = source[i];
+			}
+
+			SortEntry* swap = source;
+			source = destination;
+			destination = swap;
+		}
+
+		// an odd number of passes left the result in scratch
+		if (source != entries.data()) {
+			entries.swap(scratch);
+		}
+	}
+
+} // namespace UTIL
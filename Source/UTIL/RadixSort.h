@@ -0,0 +1,23 @@
+#ifndef RADIXSORT_H_
+#define RADIXSORT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace UTIL
+{
+	/// A 64-bit key and whatever it sorts, usually an index into the caller's own array
+	struct SortEntry
+	{
+		uint64_t key;
+		uint32_t value;
+	};
+
+	/// Stable LSD radix sort by key, one byte per pass. Bytes that are the same in every key
+	/// (pass and pipeline bits of draw keys, mostly) cost a histogram pass and nothing else.
+	/// scratch is only there so the caller can keep its allocation from frame to frame.
+	void RadixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch);
+
+} // namespace UTIL
+#endif // !RADIXSORT_H_
@@ -29,6 +29,8 @@ namespace UTIL
 
 		Random() : generator(std::random_device{}()), distribution(1, 100) {}
 		Random(int min, int max) : generator(std::random_device{}()), distribution(min, max) {}
+		/// Seeded variant, one generator per registry keeps a game reproducible and independent of other games
+		Random(int min, int max, unsigned int seed) : generator(seed), distribution(min, max) {}
 
 		int next() {
 			return distribution(generator);
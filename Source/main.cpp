@@ -8,6 +8,9 @@
 #include "GAME/HighScoresManager.h"
 #include "GAME/GameAudio.h"
 #include "APP/Window.hpp"
+#include "SIM/BatchRunner.h"
+#include "SIM/RenderBenchmark.h"
+#include "DRAW/Utility/ShaderCache.h"
 #include <filesystem>
 #include <random>
 
@@ -1340,8 +1343,31 @@ void GameplayBehavior(entt::registry& registry);
 void MainLoopBehavior(entt::registry& registry);
 
 // Architecture is based on components/entities pushing updates to other components/entities (via "patch" function)
-int main()
+int main(int argc, char** argv)
 {
+	// offline shader build: --build-shaders compiles the [Shaders] HLSL (and the text shaders) to cached SPIR-V
+	if (DRAW::ShaderBuildRequested(argc, argv)) {
+		GameConfig config;
+		std::string vertexShader = config.at("Shaders").at("vertex").as<std::string>();
+		std::string pixelShader = config.at("Shaders").at("pixel").as<std::string>();
+		std::vector<DRAW::ShaderSource> sources = DRAW::RendererShaderSources(vertexShader, pixelShader);
+		// the PACKED_VERTEX variant too, whichever vertex format a level picks is then already cached
+		sources.push_back(DRAW::RendererShaderSources(vertexShader, pixelShader, true).front());
+		return DRAW::BuildShaderCache(sources);
+	}
+
+	// headless balance/load testing: --batch <games> [--threads n] [--seed n] [--dt s] [--max-seconds s] [--report file]
+	SIM::BatchSettings batchSettings;
+	if (SIM::ParseBatchSettings(argc, argv, batchSettings)) {
+		return batchSettings.argumentsValid ? SIM::RunBatch(batchSettings) : -1;
+	}
+
+	// headless rendering, no window or swapchain (lavapipe on CI):
+	// --render-benchmark <frames> [--size WxH] [--instances n] [--seed n] [--dump-frames folder] [--dt s] [--report file]
+	SIM::RenderBenchmarkSettings benchmarkSettings;
+	if (SIM::ParseRenderBenchmarkSettings(argc, argv, benchmarkSettings)) {
+		return benchmarkSettings.argumentsValid ? SIM::RunRenderBenchmark(benchmarkSettings) : -1;
+	}
 
 	// All components, tags, and systems are stored in a single registry
 	entt::registry registry;
@@ -1382,6 +1408,14 @@ int main()
 
 	GameplayBehavior(registry); // create entities and components for gameplay
 
+	// --render-thread: the renderer draws each tick's snapshot on its own thread while the next tick runs
+	if (DRAW::RenderThreadRequested(argc, argv)) {
+		auto renderers = registry.view<DRAW::VulkanRenderer>();
+		if (!renderers.empty()) {
+			DRAW::StartRenderThread(registry, renderers.front());
+		}
+	}
+
 	MainLoopBehavior(registry); // update windows and input
 
 
@@ -1393,6 +1427,9 @@ int main()
 		if (registry.all_of<DRAW::VulkanRenderer>(displayEntity)) {
 			auto& vulkanRenderer = registry.get<DRAW::VulkanRenderer>(displayEntity);
 
+			// nothing below may run under a frame the render thread is still presenting
+			DRAW::StopRenderThread(registry, displayEntity);
+
 			// Wait for all GPU work to complete
 			if (vulkanRenderer.device != nullptr) {
 				vkDeviceWaitIdle(vulkanRenderer.device);
@@ -1435,9 +1472,24 @@ int main()
 			if (registry.all_of<DRAW::VulkanGPUInstanceBuffer>(displayEntity)) {
 				registry.remove<DRAW::VulkanGPUInstanceBuffer>(displayEntity);
 			}
+			if (registry.all_of<DRAW::VulkanIndirectBuffer>(displayEntity)) {
+				registry.remove<DRAW::VulkanIndirectBuffer>(displayEntity);
+			}
+			if (registry.all_of<DRAW::VulkanMaterialBuffer>(displayEntity)) {
+				registry.remove<DRAW::VulkanMaterialBuffer>(displayEntity);
+			}
+			if (registry.all_of<DRAW::VulkanStaticInstanceBuffer>(displayEntity)) {
+				registry.remove<DRAW::VulkanStaticInstanceBuffer>(displayEntity);
+			}
+			if (registry.all_of<DRAW::VulkanAnchoredInstanceBuffer>(displayEntity)) {
+				registry.remove<DRAW::VulkanAnchoredInstanceBuffer>(displayEntity);
+			}
 			if (registry.all_of<DRAW::VulkanUniformBuffer>(displayEntity)) {
 				registry.remove<DRAW::VulkanUniformBuffer>(displayEntity);
 			}
+			if (registry.all_of<DRAW::VulkanTransferQueue>(displayEntity)) {
+				registry.remove<DRAW::VulkanTransferQueue>(displayEntity);
+			}
 		}
 	}
 
@@ -1465,6 +1517,11 @@ void GraphicsBehavior(entt::registry& registry)
 	DRAW::CPULevel cpuLevel = {};
 	cpuLevel.levelFile = (*config).at("Level1").at("levelFile").as<std::string>();
 	cpuLevel.modelPath = (*config).at("Level1").at("modelPath").as<std::string>();
+	// optional, packedVertices = true uploads 20 byte DRAW::PackedVertex instead of the 36 byte H2B::VERTEX
+	auto packedSetting = (*config).at("Level1").find("packedVertices");
+	if (packedSetting != (*config).at("Level1").end()) {
+		cpuLevel.packedVertices = packedSetting->second.as<bool>();
+	}
 	registry.emplace<DRAW::CPULevel>(display, cpuLevel);
 
 	// Emplace and initialize Window component
@@ -1551,6 +1608,28 @@ void GameplayBehavior(entt::registry& registry)
 	registry.emplace<GAME::WaveLogic>(waveLogicEntity);
 }
 
+// Menu navigation/debounce state for the main loop, kept in the registry context
+// instead of function-local statics so every registry owns its own copy
+struct MainLoopState
+{
+	std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point navClockStart = std::chrono::steady_clock::now();
+
+	double menuLastMoveTime = 0;
+	double settingsLastNavTime = 0;
+	double pauseLastNavTime = 0;
+
+	bool settingsWaitForReleaseBack = true;
+	bool howToPlayWaitForReleaseBack = true;
+	bool creditsWaitForRelease = true;
+	bool highScoresWaitForRelease = true;
+
+	bool mouseDownLastHTP = false;
+	bool escWasDown = false;
+	bool mouseDownLastPauseButtons = false;
+	bool mouseDownLastPauseYN = false;
+};
+
 // This function will be called by the main loop to update the main loop
 // It will be responsible for updating any created windows and handling any input
 void MainLoopBehavior(entt::registry& registry)
@@ -1558,9 +1637,10 @@ void MainLoopBehavior(entt::registry& registry)
 	int closedCount;
 	auto winView = registry.view<APP::Window>();
 	auto& deltaTime = registry.ctx().emplace<UTIL::DeltaTime>().dtSec;
+	MainLoopState& loopState = registry.ctx().emplace<MainLoopState>();
 
 	do {
-		static auto start = std::chrono::steady_clock::now();
+		auto& start = loopState.frameStart;
 		double elapsed = std::chrono::duration<double>(
 			std::chrono::steady_clock::now() - start).count();
 		start = std::chrono::steady_clock::now();
@@ -1583,6 +1663,7 @@ void MainLoopBehavior(entt::registry& registry)
 					++closedCount;
 				else {
 					auto& gw = registry.get<GW::SYSTEM::GWindow>(entity);
+					DRAW::WaitForRenderThread(registry, entity);
 					gw.ProcessWindowEvents();
 				}
 			}
@@ -1605,8 +1686,8 @@ void MainLoopBehavior(entt::registry& registry)
 				in->immediateInput.GetState(G_KEY_DOWN, down);
 				in->immediateInput.GetState(G_KEY_ENTER, enter);
 
-				static double lastMoveTime = 0;
-				static auto navClockStart = std::chrono::steady_clock::now();
+				double& lastMoveTime = loopState.menuLastMoveTime;
+				auto& navClockStart = loopState.navClockStart;
 				auto now = std::chrono::steady_clock::now();
 				double t = std::chrono::duration<double>(now - navClockStart).count();
 
@@ -1735,15 +1816,16 @@ void MainLoopBehavior(entt::registry& registry)
 						++closedCount;
 					else {
 						auto& gw = registry.get<GW::SYSTEM::GWindow>(entity);
+						DRAW::WaitForRenderThread(registry, entity);
 						gw.ProcessWindowEvents();
 						DrawSettingsOverlay(gw, registry, *settings);
 					}
 				}
 
 				if (auto* in = registry.ctx().find<UTIL::Input>()) {
-					static bool waitForReleaseBack = true;
-					static double lastNavTime = 0;
-					static auto navClockStart = std::chrono::steady_clock::now();
+					bool& waitForReleaseBack = loopState.settingsWaitForReleaseBack;
+					double& lastNavTime = loopState.settingsLastNavTime;
+					auto& navClockStart = loopState.navClockStart;
 
 					auto now = std::chrono::steady_clock::now();
 					double t = std::chrono::duration<double>(now - navClockStart).count();
@@ -1857,13 +1939,14 @@ void MainLoopBehavior(entt::registry& registry)
 						++closedCount;
 					else {
 						auto& gw = registry.get<GW::SYSTEM::GWindow>(entity);
+						DRAW::WaitForRenderThread(registry, entity);
 						gw.ProcessWindowEvents();
 						DrawHowToPlayOverlay(gw, registry);
 					}
 				}
 
 				if (auto* in = registry.ctx().find<UTIL::Input>()) {
-					static bool waitForReleaseBack = true;
+					bool& waitForReleaseBack = loopState.howToPlayWaitForReleaseBack;
 
 					float back = 0;
 					in->immediateInput.GetState(G_KEY_BACKSPACE, back);
@@ -1893,7 +1976,7 @@ void MainLoopBehavior(entt::registry& registry)
 						HWND hwnd2 = reinterpret_cast<HWND>(uwh2.window);
 						POINT mp; GetCursorPos(&mp); ScreenToClient(hwnd2, &mp);
 						bool mouseDown = (GetAsyncKeyState(VK_LBUTTON) & 0x8000) != 0;
-						static bool mouseDownLastHTP = false;
+						bool& mouseDownLastHTP = loopState.mouseDownLastHTP;
 
 						if (mouseDown && !mouseDownLastHTP) {
 							if (PtInRect(&g_htpUI.nextRect, mp)) {
@@ -1934,6 +2017,7 @@ void MainLoopBehavior(entt::registry& registry)
 						++closedCount;
 					else {
 						auto& gw = registry.get<GW::SYSTEM::GWindow>(entity);
+						DRAW::WaitForRenderThread(registry, entity);
 						gw.ProcessWindowEvents();
 						DrawEndCreditsOverlay(gw, registry);
 					}
@@ -1941,7 +2025,7 @@ void MainLoopBehavior(entt::registry& registry)
 
 				// allow BACKSPACE to leave early
 				if (auto* in = registry.ctx().find<UTIL::Input>()) {
-					static bool waitForRelease = true;
+					bool& waitForRelease = loopState.creditsWaitForRelease;
 					float back = 0;
 					in->immediateInput.GetState(G_KEY_BACKSPACE, back);
 
@@ -1984,6 +2068,7 @@ void MainLoopBehavior(entt::registry& registry)
 						++closedCount;
 					else {
 						auto& gw = registry.get<GW::SYSTEM::GWindow>(entity);
+						DRAW::WaitForRenderThread(registry, entity);
 						gw.ProcessWindowEvents();
 					}
 				}
@@ -1992,7 +2077,7 @@ void MainLoopBehavior(entt::registry& registry)
 				GAME::DrawHighScores(registry);
 
 				if (auto* in = registry.ctx().find<UTIL::Input>()) {
-					static bool waitForRelease = true;
+					bool& waitForRelease = loopState.highScoresWaitForRelease;
 
 					float back = 0;
 					in->immediateInput.GetState(G_KEY_BACKSPACE, back);
@@ -2029,7 +2114,7 @@ void MainLoopBehavior(entt::registry& registry)
 					if (auto* in = registry.ctx().find<UTIL::Input>()) {
 						float esc = 0;
 						in->immediateInput.GetState(G_KEY_ESCAPE, esc);
-						static bool escWasDown = false;
+						bool& escWasDown = loopState.escWasDown;
 						bool escDown = esc > 0.5f;
 
 						if (escDown && !escWasDown) {
@@ -2106,6 +2191,7 @@ void MainLoopBehavior(entt::registry& registry)
 							++closedCount;
 						else {
 							auto& gw = registry.get<GW::SYSTEM::GWindow>(winEntity);
+							DRAW::WaitForRenderThread(registry, winEntity);
 							gw.ProcessWindowEvents();
 							DrawInitialsOverlay(gw, registry);
 						}
@@ -2131,6 +2217,7 @@ void MainLoopBehavior(entt::registry& registry)
 						++closedCount;
 					else {
 						auto& gw = registry.get<GW::SYSTEM::GWindow>(entity);
+						DRAW::WaitForRenderThread(registry, entity);
 						gw.ProcessWindowEvents();
 						DrawGameOverOverlay(gw, registry);
 					}
@@ -2153,13 +2240,14 @@ void MainLoopBehavior(entt::registry& registry)
 						++closedCount;
 					else {
 						auto& gw = registry.get<GW::SYSTEM::GWindow>(entity);
+						DRAW::WaitForRenderThread(registry, entity);
 						gw.ProcessWindowEvents();
 						DrawPauseOverlay(gw, registry);
 					}
 				}
 				if (auto* in = registry.ctx().find<UTIL::Input>()) {
-					static double lastNavTime = 0;
-					static auto navClockStart = std::chrono::steady_clock::now();
+					double& lastNavTime = loopState.pauseLastNavTime;
+					auto& navClockStart = loopState.navClockStart;
 					auto now = std::chrono::steady_clock::now();
 					double t = std::chrono::duration<double>(now - navClockStart).count();
 
@@ -2189,7 +2277,7 @@ void MainLoopBehavior(entt::registry& registry)
 							HWND hwnd2 = reinterpret_cast<HWND>(uwh2.window);
 							POINT mp; GetCursorPos(&mp); ScreenToClient(hwnd2, &mp);
 							bool mouseDown = (GetAsyncKeyState(VK_LBUTTON) & 0x8000) != 0;
-							static bool mouseDownLastPauseButtons = false;
+							bool& mouseDownLastPauseButtons = loopState.mouseDownLastPauseButtons;
 
 							if (mouseDown && !mouseDownLastPauseButtons) {
 								for (int i = 0; i < 5; ++i) {
@@ -2267,7 +2355,7 @@ void MainLoopBehavior(entt::registry& registry)
 							HWND hwnd2 = reinterpret_cast<HWND>(uwh2.window);
 							POINT mp; GetCursorPos(&mp); ScreenToClient(hwnd2, &mp);
 							bool mouseDown = (GetAsyncKeyState(VK_LBUTTON) & 0x8000) != 0;
-							static bool mouseDownLastPauseYN = false;
+							bool& mouseDownLastPauseYN = loopState.mouseDownLastPauseYN;
 
 							if (mouseDown && !mouseDownLastPauseYN) {
 								if (PtInRect(&g_pauseUI.yesRect, mp)) {